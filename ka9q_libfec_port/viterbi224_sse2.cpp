@@ -6,7 +6,9 @@
 #include <stdint.h>
 #include <assert.h>
 #include "./viterbi224_sse2.h"
-#include "../src/parity.h"
+#include "../src/branch_table.h"
+#include "../src/decision_store.h"
+#include "../src/argmin.h"
 
 constexpr size_t K = 24;
 constexpr size_t R = 2;
@@ -15,9 +17,8 @@ union decision_t { uint32_t w[1<<18]; uint16_t s[1<<19];};
 union metric_t { int16_t s[1<<23]; __m128i v[1<<20];};
 union branchtab224 { uint16_t s[1<<22]; __m128i v[1<<19];};
 
-branchtab224* Branchtab224 = []() {
-    return (branchtab224*)malloc(2*sizeof(branchtab224));
-} ();
+// At 16MB this table is too large to generate at compile time
+// Instead each decoder builds its own on create so decoders with different codes can be used together
 
 // State info for instance of Viterbi decoder
 struct v224 {
@@ -26,6 +27,8 @@ struct v224 {
   void *dp;          // Pointer to current decision
   metric_t *old_metrics,*new_metrics; // Pointers to path metrics, swapped on every bit
   void *decisions;   // Beginning of decisions for block
+  DecisionStorePolicy decision_store; // How decisions are written during update
+  BranchTable<uint16_t, K, R> *branchtab; // Branch table of this decoder's code
 };
 
 // Initialize Viterbi decoder for start of new frame
@@ -50,7 +53,6 @@ int init_viterbi224_sse2(struct v224 *p,int starting_state){
 struct v224 *create_viterbi224_sse2(const int *poly, int len){
   struct v224 *p;
   struct v224 *vp;
-  int state;
 
   // Ordinary malloc() only returns 8-byte alignment, we need 16
   // i = posix_memalign(&p, sizeof(__m128i),sizeof(struct v224));
@@ -58,19 +60,15 @@ struct v224 *create_viterbi224_sse2(const int *poly, int len){
   p = (struct v224*)malloc(sizeof(struct v224));
 
   vp = (struct v224 *)p;
-  p = (struct v224*)malloc(len*sizeof(decision_t));
+  p = (struct v224*)decision_store_malloc(len*sizeof(decision_t));
   assert(p != NULL);
   //    free(vp);
   //    return NULL;
 
   vp->decisions = (decision_t *)p;
 
-  const auto& parity = ParityTable::get();
-  for(state=0;state < (1<<(K-2));state++){
-    for (int i = 0; i < 2; i++) { 
-        Branchtab224[i].s[state] = parity.parse((2*state) & poly[i]) ? 255 : 0;
-    }
-  }
+  vp->branchtab = create_branch_table<uint16_t, K, R>(poly, 255, 0);
+  vp->decision_store = DecisionStorePolicy::CACHED;
   init_viterbi224_sse2(vp,0);
   return vp;
 }
@@ -88,6 +86,11 @@ int chainback_viterbi224_sse2(
     return -1;
 
   endstate &= (1<<(K-1))-1;
+  // Walk back through the tail to the state after the last data bit
+  for(int i=K-2;i>=0;i--){
+    int bit = (d[nbits+i].w[endstate>>5] >> (endstate & 31)) & 1;
+    endstate = (bit << (K-2)) | (endstate >> 1);
+  }
 
 #if 1
   {
@@ -120,21 +123,37 @@ int chainback_viterbi224_sse2(
 
 }
 
+// Find state with the best path metric for chainback of unterminated streams
+// Metrics use saturating signed arithmetic
+unsigned int get_best_state_viterbi224_sse2(struct v224 *p){
+  struct v224 *vp = p;
+  return (unsigned int)argmin_i16(vp->old_metrics->s, 1<<(K-1));
+}
+
 // Delete instance of a Viterbi decoder
 void delete_viterbi224_sse2(struct v224 *p){
   struct v224 *vp = p;
 
   if(vp != NULL){
-    free(vp->decisions);
+    decision_store_free(vp->decisions);
+    delete_branch_table(vp->branchtab);
     free(vp);
   }
 }
 
 
+// Select whether decisions are written through the cache or streamed
+void set_decision_store_viterbi224_sse2(struct v224 *p, int policy){
+  p->decision_store = DecisionStorePolicy(policy);
+}
+
 // Process received symbols
-void update_viterbi224_blk_sse2(struct v224 *p, unsigned char *syms, int nbits){
-  struct v224 *vp = p;
+// When STREAM is set decisions are staged a cache line at a time and written with non-temporal stores
+template <bool STREAM>
+static void update_viterbi224_blk(struct v224 *vp, unsigned char *syms, int nbits){
   decision_t *d = (decision_t *)vp->dp;
+  const branchtab224 *branchtab = reinterpret_cast<const branchtab224 *>(vp->branchtab->values);
+  union { uint16_t s[32]; __m128i v[4]; } stage;
 
   while(nbits--){
     __m128i sym0v,sym1v;
@@ -142,8 +161,9 @@ void update_viterbi224_blk_sse2(struct v224 *p, unsigned char *syms, int nbits){
     int i;
 
     // Splat the 0th symbol across sym0v, the 1st symbol across sym1v, etc
-    sym0v = _mm_set1_epi16(syms[0]);
-    sym1v = _mm_set1_epi16(syms[1]);
+    // Symbols are signed so flip the sign bit to get offset binary
+    sym0v = _mm_set1_epi16(syms[0]^0x80);
+    sym1v = _mm_set1_epi16(syms[1]^0x80);
     syms += 2;
 
     // SSE2 doesn't support minimum of unsigned words but does minimum of signed words.
@@ -153,10 +173,10 @@ void update_viterbi224_blk_sse2(struct v224 *p, unsigned char *syms, int nbits){
       __m128i decision0,decision1,metric,m_metric,m0,m1,m2,m3,survivor0,survivor1;
 
       // Form branch metrics
-      // Because Branchtab takes on values 0 and 255, and the values of sym?v are offset binary in the range 0-255,
+      // Because Branchtab takes on values 0 and 255, and the values of sym?v are converted from signed to offset binary in the range 0-255,
       // the XOR operations constitute conditional negation.
       // metric and m_metric (-metric) are in the range 0-510
-      metric = _mm_add_epi16(_mm_xor_si128(Branchtab224[0].v[i],sym0v),_mm_xor_si128(Branchtab224[1].v[i],sym1v));
+      metric = _mm_add_epi16(_mm_xor_si128(branchtab[0].v[i],sym0v),_mm_xor_si128(branchtab[1].v[i],sym1v));
       m_metric = _mm_sub_epi16(_mm_set1_epi16(510),metric);
     
       // Add branch metrics to path metrics using saturating signed addition
@@ -166,8 +186,8 @@ void update_viterbi224_blk_sse2(struct v224 *p, unsigned char *syms, int nbits){
       m2 = _mm_adds_epi16(vp->old_metrics->v[i],m_metric);
     
 #if 0
-      _mm_prefetch((void *)&Branchtab224[0].v[i+1],3);
-      _mm_prefetch((void *)&Branchtab224[1].v[i+1],3);
+      _mm_prefetch((void *)&branchtab[0].v[i+1],3);
+      _mm_prefetch((void *)&branchtab[1].v[i+1],3);
       _mm_prefetch((void *)&vp->old_metrics->v[i+1],0);
       _mm_prefetch((void *)&vp->old_metrics->v[(1<<(K-5))+i],0);
 #endif
@@ -195,7 +215,14 @@ void update_viterbi224_blk_sse2(struct v224 *p, unsigned char *syms, int nbits){
 #endif
  
       // Pack each set of decisions into 8 8-bit bytes, then interleave and compress into 16 bits
-      d->s[i] = _mm_movemask_epi8(_mm_unpacklo_epi8(_mm_packs_epi16(decision0,_mm_setzero_si128()),_mm_packs_epi16(decision1,_mm_setzero_si128())));
+      const uint16_t s = _mm_movemask_epi8(_mm_unpacklo_epi8(_mm_packs_epi16(decision0,_mm_setzero_si128()),_mm_packs_epi16(decision1,_mm_setzero_si128())));
+      if(STREAM){
+        stage.s[i%32] = s;
+        if((i%32) == 31)
+          stream_decisions(&d->s[i-31],stage.s,sizeof(stage));
+      } else {
+        d->s[i] = s;
+      }
 
       // Store surviving metrics
       vp->new_metrics->v[2*i] = _mm_unpacklo_epi16(survivor0,survivor1);
@@ -257,4 +284,13 @@ void update_viterbi224_blk_sse2(struct v224 *p, unsigned char *syms, int nbits){
   vp->dp = d;
 }
 
+void update_viterbi224_blk_sse2(struct v224 *p, unsigned char *syms, int nbits){
+  if(p->decision_store == DecisionStorePolicy::STREAMING){
+    update_viterbi224_blk<true>(p,syms,nbits);
+    _mm_sfence();
+  } else {
+    update_viterbi224_blk<false>(p,syms,nbits);
+  }
+}
+
 
@@ -5,4 +5,7 @@ struct v224 *create_viterbi224_sse2(const int *poly, int len);
 int init_viterbi224_sse2(struct v224 *p, int starting_state);
 int chainback_viterbi224_sse2(struct v224 *p, unsigned char *data, unsigned int nbits, unsigned int endstate);
 void delete_viterbi224_sse2(struct v224 *p);
+/* syms are signed 8bit soft decisions where +127 is a 1 and -127 is a 0 */
 void update_viterbi224_blk_sse2(struct v224 *p, unsigned char *syms, int nbits);
+void set_decision_store_viterbi224_sse2(struct v224 *p, int policy);
+unsigned int get_best_state_viterbi224_sse2(struct v224 *p);
@@ -2,11 +2,16 @@
  * Feb 2004, Phil Karn, KA9Q
  */
 #include <stdlib.h>
+#include <string.h>
 #include <immintrin.h>
 #include "./viterbi27_sse2.h"
-#include "../src/parity.h"
+#include "../src/branch_table.h"
+#include "../src/decision_store.h"
+#include "../src/argmin.h"
+#include "../src/nibble_packing.h"
+#include "../src/simd_vector.h"
 
-union metric_t { 
+union alignas(32) metric_t { 
     unsigned char c[64];
     __m128i v[4];
 };
@@ -23,9 +28,19 @@ union branchtab27 {
     __m128i v[2];
 }; 
 
-branchtab27 Branchtab27_sse2[2];
+/* The CCSDS code is generated at compile time and other codes get their own table on create */
+static constexpr auto& Branchtab27_ccsds = CONSTEXPR_BRANCH_TABLE<unsigned char, 7, 0x7F, 0x80, 0x6d, 0x4f>;
+static const NibbleLUT Nibble_lut27 = get_nibble_lut_full_scale();
 
-static int Init = 0;
+static constexpr size_t DECISION_STAGE_SIZE = get_decision_stage_size<decision_t>();
+
+/* Butterflies are written against src/simd_vector.h so the width is a single alias
+ * 256bit registers would do all 32 butterflies at once but measured slower since each bit depends on
+ * the last and the lane crossing interleave lands on that chain, two 128bit blocks overlap instead
+ */
+using simd_t = SimdVector128;
+static constexpr size_t SIMD_WIDTH = simd_t::WIDTH;
+static constexpr size_t TOTAL_BUTTERFLY_BLOCKS = 32/SIMD_WIDTH;
 
 /* State info for instance of Viterbi decoder
  * Don't change this without also changing references in sse2bfly27.s!
@@ -36,6 +51,10 @@ struct v27 {
   decision_t *dp;          /* Pointer to current decision */
   metric_t *old_metrics,*new_metrics; /* Pointers to path metrics, swapped on every bit */
   decision_t *decisions;   /* Beginning of decisions for block */
+  DecisionStorePolicy decision_store; /* How decisions are written during update */
+  decision_t decision_stage[DECISION_STAGE_SIZE]; /* Cache line of decisions waiting to be streamed */
+  const branchtab27 *branchtab; /* Branch table of this decoder's code */
+  BranchTable<unsigned char, 7, 2> *branchtab_custom; /* Owned table if the code isn't the default */
 };
 
 /* Initialize Viterbi decoder for start of new frame */
@@ -56,20 +75,19 @@ int init_viterbi27_sse2(struct v27 *p, int starting_state) {
 /* Create a new instance of a Viterbi decoder */
 struct v27 *create_viterbi27_sse2(const int *poly, int len){
   struct v27 *vp;
-  int state;
-
-  if(!Init){
-    const auto& parity = ParityTable::get();
-    /* Initialize branch tables */
-    for(state=0; state < 32; state++){
-      for(int i = 0; i < 2; i++) {
-          Branchtab27_sse2[i].c[state] = parity.parse((2*state) & poly[i]) ? 255 : 0;
-      }
-    }
-    Init++;
+
+  /* Aligned for full width metric loads */
+  vp = (struct v27 *)_mm_malloc(sizeof(struct v27), alignof(struct v27));
+  /* Symbols are signed so flip the sign bit, XOR then gives offset binary with conditional negation */
+  if(Branchtab27_ccsds.is_poly(poly)){
+    vp->branchtab = reinterpret_cast<const branchtab27 *>(Branchtab27_ccsds.values);
+    vp->branchtab_custom = NULL;
+  } else {
+    vp->branchtab_custom = create_branch_table<unsigned char, 7, 2>(poly, 0x7F, 0x80);
+    vp->branchtab = reinterpret_cast<const branchtab27 *>(vp->branchtab_custom->values);
   }
-  vp = (struct v27 *)malloc(sizeof(struct v27));
-  vp->decisions = (decision_t *)malloc((len+6)*sizeof(decision_t));
+  vp->decisions = (decision_t *)decision_store_malloc((len+6)*sizeof(decision_t));
+  vp->decision_store = DecisionStorePolicy::CACHED;
   init_viterbi27_sse2(vp,0);
   return vp;
 }
@@ -104,72 +122,149 @@ int chainback_viterbi27_sse2(
   return 0;
 }
 
+/* Find state with the best path metric for chainback of unterminated streams
+ * Metrics use modulo arithmetic
+ */
+unsigned int get_best_state_viterbi27_sse2(struct v27 *p){
+  struct v27 *vp = p;
+  return (unsigned int)argmin_u8_modular(vp->old_metrics->c, 64);
+}
+
 /* Delete instance of a Viterbi decoder */
 void delete_viterbi27_sse2(struct v27 *p){
   struct v27 *vp = p;
 
   if(vp != NULL){
-    free(vp->decisions);
-    free(vp);
+    decision_store_free(vp->decisions);
+    delete_branch_table(vp->branchtab_custom);
+    _mm_free(vp);
   }
 }
 
 
+/* Select whether decisions are written through the cache or streamed */
+void set_decision_store_viterbi27_sse2(struct v27 *p, int policy){
+  p->decision_store = DecisionStorePolicy(policy);
+}
+
+/* Update path metrics and decisions for a single decoded bit from splatted symbols */
+static inline void update_viterbi27_bit(struct v27 *vp, decision_t *d, simd_t::reg_t sym0v, simd_t::reg_t sym1v) {
+  using V = simd_t;
+  metric_t *tmp;
+  size_t i;
+  /* Decisions are written as bytes which could alias the metric pointers so keep them in registers */
+  const unsigned char *old_metrics = vp->old_metrics->c;
+  unsigned char *new_metrics = vp->new_metrics->c;
+  const branchtab27 *branchtab = vp->branchtab;
+
+  for(i=0;i<TOTAL_BUTTERFLY_BLOCKS;i++){
+    V::reg_t decision0,decision1,metric,m_metric,m0,m1,m2,m3,survivor0,survivor1;
+    uint64_t decisions_lo,decisions_hi;
+    const V::reg_t old0 = V::load(&old_metrics[i*SIMD_WIDTH]);
+    const V::reg_t old1 = V::load(&old_metrics[32+i*SIMD_WIDTH]);
+
+    /* Form branch metrics */
+    metric = V::avg_u8(
+      V::bit_xor(V::load(&branchtab[0].c[i*SIMD_WIDTH]),sym0v),
+      V::bit_xor(V::load(&branchtab[1].c[i*SIMD_WIDTH]),sym1v)
+    );
+    /* There's no packed bytes right shift in SSE2, so we use the word version and mask
+     * (I'm *really* starting to like Altivec...)
+     */
+    metric = V::srli_i16<4>(metric);
+    metric = V::bit_and(metric,V::set1_u8(0b1111));
+    m_metric = V::sub_u8(V::set1_u8(0b1111),metric);
+  
+    /* Add branch metrics to path metrics */
+    m0 = V::add_u8(old0,metric);
+    m3 = V::add_u8(old1,metric);
+    m1 = V::add_u8(old1,m_metric);
+    m2 = V::add_u8(old0,m_metric);
+  
+    /* Compare and select, using modulo arithmetic */
+    decision0 = V::cmpgt_i8(V::sub_u8(m0,m1),V::zero());
+    decision1 = V::cmpgt_i8(V::sub_u8(m2,m3),V::zero());
+    survivor0 = V::select(decision0,m1,m0);
+    survivor1 = V::select(decision1,m3,m2);
+ 
+    /* Pack each set of decisions into a bit per new state */
+    decisions_lo = V::movemask_u8(V::interleave_lo_u8(decision0,decision1));
+    decisions_hi = V::movemask_u8(V::interleave_hi_u8(decision0,decision1));
+    memcpy(&d->c[(2*i)*SIMD_WIDTH/8], &decisions_lo, SIMD_WIDTH/8);
+    memcpy(&d->c[(2*i+1)*SIMD_WIDTH/8], &decisions_hi, SIMD_WIDTH/8);
+
+    /* Store surviving metrics */
+    V::store(&new_metrics[(2*i)*SIMD_WIDTH], V::interleave_lo_u8(survivor0,survivor1));
+    V::store(&new_metrics[(2*i+1)*SIMD_WIDTH], V::interleave_hi_u8(survivor0,survivor1));
+  }
+  /* Swap pointers to old and new metrics */
+  tmp = vp->old_metrics;
+  vp->old_metrics = vp->new_metrics;
+  vp->new_metrics = tmp;
+}
+
 /* This code is turned off because it's slower than my hand-crafted assembler in sse2bfly27.s. But it does work. */
+static void update_viterbi27_blk(struct v27 *vp, decision_t *d, unsigned char *syms, int nbits) {
+  while(nbits--){
+    /* Splat the 0th symbol across sym0v, the 1st symbol across sym1v, etc */
+    update_viterbi27_bit(vp, d, simd_t::set1_u8(syms[0]), simd_t::set1_u8(syms[1]));
+    syms += 2;
+    d++;
+  }
+}
+
+/* Each packed byte holds both 4bit symbols for a bit
+ * Unpack 16 bits at a time with pshufb and splat each symbol from there
+ */
+static void update_viterbi27_blk_nibble(struct v27 *vp, decision_t *d, const unsigned char *packed, int nbits) {
+  const __m128i lut = _mm_load_si128((const __m128i *)Nibble_lut27.values);
+  const __m128i mask = _mm_set1_epi8(0x0F);
+  while(nbits > 0){
+    const int n = (nbits < 16) ? nbits : 16;
+    __m128i x;
+    if(n == 16){
+      x = _mm_loadu_si128((const __m128i *)packed);
+    } else {
+      alignas(16) unsigned char tail[16] = {0};
+      memcpy(tail, packed, size_t(n));
+      x = _mm_load_si128((const __m128i *)tail);
+    }
+    alignas(16) unsigned char sym0s[16], sym1s[16];
+    _mm_store_si128((__m128i *)sym0s, _mm_shuffle_epi8(lut, _mm_and_si128(x, mask)));
+    _mm_store_si128((__m128i *)sym1s, _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(x, 4), mask)));
+    for(int i=0;i<n;i++){
+      update_viterbi27_bit(vp, d, simd_t::set1_u8(sym0s[i]), simd_t::set1_u8(sym1s[i]));
+      d++;
+    }
+    packed += n;
+    nbits -= n;
+  }
+}
+
 void update_viterbi27_blk_sse2(struct v27 *p, unsigned char *syms, int nbits) {
   struct v27 *vp = p;
   decision_t *d = (decision_t *)vp->dp;
 
-  while(nbits--){
-    __m128i sym0v,sym1v;
-    metric_t *tmp;
-    int i;
-    
-    /* Splat the 0th symbol across sym0v, the 1st symbol across sym1v, etc */
-    sym0v = _mm_set1_epi8(syms[0]);
-    sym1v = _mm_set1_epi8(syms[1]);
-    syms += 2;
+  if(vp->decision_store == DecisionStorePolicy::STREAMING){
+    update_with_streamed_decisions(d, vp->decision_stage, size_t(nbits), [&](decision_t *dst, size_t bit, size_t n) {
+      update_viterbi27_blk(vp, dst, syms+2*bit, int(n));
+    });
+  } else {
+    update_viterbi27_blk(vp, d, syms, nbits);
+  }
+  vp->dp = d + nbits;
+}
 
-    for(i=0;i<2;i++){
-      __m128i decision0,decision1,metric,m_metric,m0,m1,m2,m3,survivor0,survivor1;
-
-      /* Form branch metrics */
-      metric = _mm_avg_epu8(
-        _mm_xor_si128(Branchtab27_sse2[0].v[i],sym0v),
-        _mm_xor_si128(Branchtab27_sse2[1].v[i],sym1v)
-      );
-      /* There's no packed bytes right shift in SSE2, so we use the word version and mask
-       * (I'm *really* starting to like Altivec...)
-       */
-      metric = _mm_srli_epi16(metric,4);
-      metric = _mm_and_si128(metric,_mm_set1_epi8(0b1111));
-      m_metric = _mm_sub_epi8(_mm_set1_epi8(0b1111),metric);
-    
-      /* Add branch metrics to path metrics */
-      m0 = _mm_add_epi8(vp->old_metrics->v[i],metric);
-      m3 = _mm_add_epi8(vp->old_metrics->v[2+i],metric);
-      m1 = _mm_add_epi8(vp->old_metrics->v[2+i],m_metric);
-      m2 = _mm_add_epi8(vp->old_metrics->v[i],m_metric);
-    
-      /* Compare and select, using modulo arithmetic */
-      decision0 = _mm_cmpgt_epi8(_mm_sub_epi8(m0,m1),_mm_setzero_si128());
-      decision1 = _mm_cmpgt_epi8(_mm_sub_epi8(m2,m3),_mm_setzero_si128());
-      survivor0 = _mm_or_si128(_mm_and_si128(decision0,m1),_mm_andnot_si128(decision0,m0));
-      survivor1 = _mm_or_si128(_mm_and_si128(decision1,m3),_mm_andnot_si128(decision1,m2));
- 
-      /* Pack each set of decisions into 16 bits */
-      d->s[2*i] = _mm_movemask_epi8(_mm_unpacklo_epi8(decision0,decision1));
-      d->s[2*i+1] = _mm_movemask_epi8(_mm_unpackhi_epi8(decision0,decision1));
+void update_viterbi27_blk_nibble_sse2(struct v27 *p, const unsigned char *packed, int nbits) {
+  struct v27 *vp = p;
+  decision_t *d = (decision_t *)vp->dp;
 
-      /* Store surviving metrics */
-      vp->new_metrics->v[2*i] = _mm_unpacklo_epi8(survivor0,survivor1);
-      vp->new_metrics->v[2*i+1] = _mm_unpackhi_epi8(survivor0,survivor1);
-    }
-    d++;
-    /* Swap pointers to old and new metrics */
-    tmp = vp->old_metrics;
-    vp->old_metrics = vp->new_metrics;
-    vp->new_metrics = tmp;
+  if(vp->decision_store == DecisionStorePolicy::STREAMING){
+    update_with_streamed_decisions(d, vp->decision_stage, size_t(nbits), [&](decision_t *dst, size_t bit, size_t n) {
+      update_viterbi27_blk_nibble(vp, dst, packed+bit, int(n));
+    });
+  } else {
+    update_viterbi27_blk_nibble(vp, d, packed, nbits);
   }
-  vp->dp = d;
+  vp->dp = d + nbits;
 }
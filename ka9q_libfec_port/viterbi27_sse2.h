@@ -5,4 +5,8 @@ struct v27 *create_viterbi27_sse2(const int *poly, int len);
 int init_viterbi27_sse2(struct v27 *p, int starting_state);
 int chainback_viterbi27_sse2(struct v27 *p, unsigned char *data, unsigned int nbits, unsigned int endstate);
 void delete_viterbi27_sse2(struct v27 *p);
+/* syms are signed 8bit soft decisions where +127 is a 1 and -127 is a 0 */
 void update_viterbi27_blk_sse2(struct v27 *p, unsigned char *syms, int nbits);
+void set_decision_store_viterbi27_sse2(struct v27 *p, int policy);
+unsigned int get_best_state_viterbi27_sse2(struct v27 *p);
+void update_viterbi27_blk_nibble_sse2(struct v27 *p, const unsigned char *packed, int nbits);
@@ -1,7 +1,9 @@
 #include <stdlib.h>
 #include <immintrin.h>
 #include "./viterbi29_sse2.h"
-#include "../src/parity.h"
+#include "../src/branch_table.h"
+#include "../src/decision_store.h"
+#include "../src/argmin.h"
 
 typedef union { unsigned char c[256]; __m128i v[16];} metric_t;
 typedef union { 
@@ -13,9 +15,12 @@ typedef union {
 union branchtab29 { 
     unsigned char c[128]; 
     __m128i v[8];
-} Branchtab29_sse2[2];
+};
+
+/* The NASA standard K=9 code is generated at compile time and other codes get their own table on create */
+static constexpr auto& Branchtab29_default = CONSTEXPR_BRANCH_TABLE<unsigned char, 9, 0x7F, 0x80, 0x1af, 0x11d>;
 
-static int Init = 0;
+static constexpr size_t DECISION_STAGE_SIZE = get_decision_stage_size<decision_t>();
 
 /* State info for instance of Viterbi decoder
  * Don't change this without also changing references in sse2bfly29.s!
@@ -26,6 +31,10 @@ struct v29 {
   decision_t *dp;          /* Pointer to current decision */
   metric_t *old_metrics,*new_metrics; /* Pointers to path metrics, swapped on every bit */
   decision_t *decisions;   /* Beginning of decisions for block */
+  DecisionStorePolicy decision_store; /* How decisions are written during update */
+  decision_t decision_stage[DECISION_STAGE_SIZE]; /* Cache line of decisions waiting to be streamed */
+  const branchtab29 *branchtab; /* Branch table of this decoder's code */
+  BranchTable<unsigned char, 9, 2> *branchtab_custom; /* Owned table if the code isn't the default */
 };
 
 /* Initialize Viterbi decoder for start of new frame */
@@ -46,20 +55,18 @@ int init_viterbi29_sse2(struct v29 *p,int starting_state){
 /* Create a new instance of a Viterbi decoder */
 struct v29 *create_viterbi29_sse2(const int *poly, int len){
   struct v29 *vp;
-  int state;
-
-  if(!Init){
-    const auto& parity = ParityTable::get();
-    /* Initialize branch tables */
-    for(state=0;state < 128;state++){
-      for(int i = 0; i < 2; i++) {
-        Branchtab29_sse2[i].c[state] = parity.parse((2*state) & poly[i]) ? 255:0;
-      }
-    }
-    Init++;
-  }
+
   vp = (struct v29 *)malloc(sizeof(struct v29));
-  vp->decisions = (decision_t *)malloc((len+8)*sizeof(decision_t));
+  /* Symbols are signed so flip the sign bit, XOR then gives offset binary with conditional negation */
+  if(Branchtab29_default.is_poly(poly)){
+    vp->branchtab = reinterpret_cast<const branchtab29 *>(Branchtab29_default.values);
+    vp->branchtab_custom = NULL;
+  } else {
+    vp->branchtab_custom = create_branch_table<unsigned char, 9, 2>(poly, 0x7F, 0x80);
+    vp->branchtab = reinterpret_cast<const branchtab29 *>(vp->branchtab_custom->values);
+  }
+  vp->decisions = (decision_t *)decision_store_malloc((len+8)*sizeof(decision_t));
+  vp->decision_store = DecisionStorePolicy::CACHED;
   init_viterbi29_sse2(vp,0);
   return vp;
 }
@@ -94,21 +101,33 @@ int chainback_viterbi29_sse2(
 }
 
 
+/* Find state with the best path metric for chainback of unterminated streams
+ * Metrics use modulo arithmetic
+ */
+unsigned int get_best_state_viterbi29_sse2(struct v29 *p){
+  struct v29 *vp = p;
+  return (unsigned int)argmin_u8_modular(vp->old_metrics->c, 256);
+}
+
 /* Delete instance of a Viterbi decoder */
 void delete_viterbi29_sse2(struct v29 *p){
   struct v29 *vp = p;
 
   if(vp != NULL){
-    free(vp->decisions);
+    decision_store_free(vp->decisions);
+    delete_branch_table(vp->branchtab_custom);
     free(vp);
   }
 }
 
-/* This code is turned off because it's slower than my hand-crafted assembler in sse2bfly27.s. But it does work. */
-void update_viterbi29_blk_sse2(struct v29 *p, unsigned char *syms, int nbits) {
-  struct v29 *vp = p;
-  decision_t *d = (decision_t *)vp->dp;
+/* Select whether decisions are written through the cache or streamed */
+void set_decision_store_viterbi29_sse2(struct v29 *p, int policy){
+  p->decision_store = DecisionStorePolicy(policy);
+}
 
+/* This code is turned off because it's slower than my hand-crafted assembler in sse2bfly27.s. But it does work. */
+static void update_viterbi29_blk(struct v29 *vp, decision_t *d, unsigned char *syms, int nbits) {
+  const branchtab29 *branchtab = vp->branchtab;
   while(nbits--){
     __m128i sym0v,sym1v;
     metric_t *tmp;
@@ -124,8 +143,8 @@ void update_viterbi29_blk_sse2(struct v29 *p, unsigned char *syms, int nbits) {
 
       /* Form branch metrics */
       metric = _mm_avg_epu8(
-        _mm_xor_si128(Branchtab29_sse2[0].v[i],sym0v),
-        _mm_xor_si128(Branchtab29_sse2[1].v[i],sym1v)
+        _mm_xor_si128(branchtab[0].v[i],sym0v),
+        _mm_xor_si128(branchtab[1].v[i],sym1v)
       );
       /* There's no packed bytes right shift in SSE2, so we use the word version and mask
        * (I'm *really* starting to like Altivec...)
@@ -160,5 +179,18 @@ void update_viterbi29_blk_sse2(struct v29 *p, unsigned char *syms, int nbits) {
     vp->old_metrics = vp->new_metrics;
     vp->new_metrics = tmp;
   }
-  vp->dp = d;
+}
+
+void update_viterbi29_blk_sse2(struct v29 *p, unsigned char *syms, int nbits) {
+  struct v29 *vp = p;
+  decision_t *d = (decision_t *)vp->dp;
+
+  if(vp->decision_store == DecisionStorePolicy::STREAMING){
+    update_with_streamed_decisions(d, vp->decision_stage, size_t(nbits), [&](decision_t *dst, size_t bit, size_t n) {
+      update_viterbi29_blk(vp, dst, syms+2*bit, int(n));
+    });
+  } else {
+    update_viterbi29_blk(vp, d, syms, nbits);
+  }
+  vp->dp = d + nbits;
 }
@@ -7,14 +7,20 @@
 #include <stdlib.h>
 #include <memory.h>
 #include <limits.h>
-#include "../src/parity.h"
+#include <stdint.h>
+#include "../src/branch_table.h"
+#include "../src/decision_store.h"
+#include "../src/argmin.h"
 #include "./viterbi615_sse2.h"
 
-typedef union { unsigned long w[512]; unsigned short s[1024];} decision_t;
+/* NOTE: Use 32bit words since chainback indexes with endstate/32, long is 64bit on LP64 platforms */
+typedef union { uint32_t w[512]; unsigned short s[1024];} decision_t;
 typedef union { signed short s[16384]; __m128i v[2048];} metric_t;
 
-static union branchtab615 { unsigned short s[8192]; __m128i v[1024];} Branchtab615[6];
-static int Init = 0;
+union branchtab615 { unsigned short s[8192]; __m128i v[1024];};
+
+/* The Voyager code is generated at compile time and other codes get their own table on create */
+static constexpr auto& Branchtab615_voyager = CONSTEXPR_BRANCH_TABLE<unsigned short, 15, 255, 0, 042631, 047245, 056507, 073363, 077267, 064537>;
 
 /* State info for instance of Viterbi decoder */
 struct v615 {
@@ -23,6 +29,9 @@ struct v615 {
   void *dp;          /* Pointer to current decision */
   metric_t *old_metrics,*new_metrics; /* Pointers to path metrics, swapped on every bit */
   void *decisions;   /* Beginning of decisions for block */
+  DecisionStorePolicy decision_store; /* How decisions are written during update */
+  const branchtab615 *branchtab; /* Branch table of this decoder's code */
+  BranchTable<unsigned short, 15, 6> *branchtab_custom; /* Owned table if the code isn't the default */
 };
 
 /* Initialize Viterbi decoder for start of new frame */
@@ -43,20 +52,17 @@ int init_viterbi615_sse2(struct v615 *p,int starting_state){
 /* Create a new instance of a Viterbi decoder */
 struct v615 *create_viterbi615_sse2(const int *poly, int len){
   struct v615 *vp;
-  int state;
-
-  if(!Init){
-    const auto& parity = ParityTable::get();
-    /* Initialize branch tables */
-    for(state=0;state < 8192;state++){
-      for(int i = 0; i < 6; i++) {
-        Branchtab615[i].s[state] = parity.parse((2*state) & poly[i]) ? 255:0;
-      }
-    }
-    Init++;
-  }
+
   vp = (struct v615 *)malloc(sizeof(struct v615));
-  vp->decisions = malloc((len+14)*sizeof(decision_t));
+  if(Branchtab615_voyager.is_poly(poly)){
+    vp->branchtab = reinterpret_cast<const branchtab615 *>(Branchtab615_voyager.values);
+    vp->branchtab_custom = NULL;
+  } else {
+    vp->branchtab_custom = create_branch_table<unsigned short, 15, 6>(poly, 255, 0);
+    vp->branchtab = reinterpret_cast<const branchtab615 *>(vp->branchtab_custom->values);
+  }
+  vp->decisions = decision_store_malloc((len+14)*sizeof(decision_t));
+  vp->decision_store = DecisionStorePolicy::CACHED;
   init_viterbi615_sse2(vp,0);
   return vp;
 }
@@ -90,34 +96,53 @@ int chainback_viterbi615_sse2(
   return path_metric;
 }
 
+/* Find state with the best path metric for chainback of unterminated streams
+ * Metrics use saturating signed arithmetic
+ */
+unsigned int get_best_state_viterbi615_sse2(struct v615 *p){
+  struct v615 *vp = p;
+  return (unsigned int)argmin_i16(vp->old_metrics->s, 16384);
+}
+
 /* Delete instance of a Viterbi decoder */
 void delete_viterbi615_sse2(struct v615 *p){
   struct v615 *vp = p;
 
   if(vp != NULL){
-    free(vp->decisions);
+    decision_store_free(vp->decisions);
+    delete_branch_table(vp->branchtab_custom);
     free(vp);
   }
 }
 
 
-void update_viterbi615_blk_sse2(struct v615 *p,unsigned char *syms,int nbits){
-  struct v615 *vp = p;
+/* Select whether decisions are written through the cache or streamed */
+void set_decision_store_viterbi615_sse2(struct v615 *p, int policy){
+  p->decision_store = DecisionStorePolicy(policy);
+}
+
+/* When STREAM is set decisions are staged a cache line at a time and written with non-temporal stores */
+template <bool STREAM>
+static void update_viterbi615_blk(struct v615 *vp,unsigned char *syms,int nbits){
   decision_t *d = (decision_t *)vp->dp;
+  const branchtab615 *branchtab = vp->branchtab;
   int path_metric = 0;
+  union { unsigned short s[32]; __m128i v[4]; } stage;
 
   while(nbits--){
     __m128i sym0v,sym1v,sym2v,sym3v,sym4v,sym5v;
     metric_t *tmp;
     int i;
 
-    /* Splat the 0th symbol across sym0v, the 1st symbol across sym1v, etc */
-    sym0v = _mm_set1_epi16(syms[0]);
-    sym1v = _mm_set1_epi16(syms[1]);
-    sym2v = _mm_set1_epi16(syms[2]);
-    sym3v = _mm_set1_epi16(syms[3]);
-    sym4v = _mm_set1_epi16(syms[4]);
-    sym5v = _mm_set1_epi16(syms[5]);
+    /* Splat the 0th symbol across sym0v, the 1st symbol across sym1v, etc
+     * Symbols are signed so flip the sign bit to get offset binary
+     */
+    sym0v = _mm_set1_epi16(syms[0]^0x80);
+    sym1v = _mm_set1_epi16(syms[1]^0x80);
+    sym2v = _mm_set1_epi16(syms[2]^0x80);
+    sym3v = _mm_set1_epi16(syms[3]^0x80);
+    sym4v = _mm_set1_epi16(syms[4]^0x80);
+    sym5v = _mm_set1_epi16(syms[5]^0x80);
     syms += 6;
 
     /* SSE2 doesn't support saturated adds on unsigned shorts, so we have to use signed shorts */
@@ -125,13 +150,13 @@ void update_viterbi615_blk_sse2(struct v615 *p,unsigned char *syms,int nbits){
       __m128i decision0,decision1,metric,m_metric,m0,m1,m2,m3,survivor0,survivor1;
 
       /* Form branch metrics
-       * Because Branchtab takes on values 0 and 255, and the values of sym?v are offset binary in the range 0-255,
+       * Because Branchtab takes on values 0 and 255, and the values of sym?v are converted from signed to offset binary in the range 0-255,
        * the XOR operations constitute conditional negation.
        * metric and m_metric (-metric) are in the range 0-1530
        */
-      m0 = _mm_add_epi16(_mm_xor_si128(Branchtab615[0].v[i],sym0v),_mm_xor_si128(Branchtab615[1].v[i],sym1v));
-      m1 = _mm_add_epi16(_mm_xor_si128(Branchtab615[2].v[i],sym2v),_mm_xor_si128(Branchtab615[3].v[i],sym3v));
-      m2 = _mm_add_epi16(_mm_xor_si128(Branchtab615[4].v[i],sym4v),_mm_xor_si128(Branchtab615[5].v[i],sym5v));
+      m0 = _mm_add_epi16(_mm_xor_si128(branchtab[0].v[i],sym0v),_mm_xor_si128(branchtab[1].v[i],sym1v));
+      m1 = _mm_add_epi16(_mm_xor_si128(branchtab[2].v[i],sym2v),_mm_xor_si128(branchtab[3].v[i],sym3v));
+      m2 = _mm_add_epi16(_mm_xor_si128(branchtab[4].v[i],sym4v),_mm_xor_si128(branchtab[5].v[i],sym5v));
       metric = _mm_add_epi16(m0,_mm_add_epi16(m1,m2));
       m_metric = _mm_sub_epi16(_mm_set1_epi16(1530),metric);
     
@@ -148,7 +173,14 @@ void update_viterbi615_blk_sse2(struct v615 *p,unsigned char *syms,int nbits){
       decision1 = _mm_cmpeq_epi16(survivor1,m3);
  
       /* Pack each set of decisions into 8 8-bit bytes, then interleave them and compress into 16 bits */
-      d->s[i] = _mm_movemask_epi8(_mm_unpacklo_epi8(_mm_packs_epi16(decision0,_mm_setzero_si128()),_mm_packs_epi16(decision1,_mm_setzero_si128())));
+      const unsigned short s = _mm_movemask_epi8(_mm_unpacklo_epi8(_mm_packs_epi16(decision0,_mm_setzero_si128()),_mm_packs_epi16(decision1,_mm_setzero_si128())));
+      if(STREAM){
+        stage.s[i%32] = s;
+        if((i%32) == 31)
+          stream_decisions(&d->s[i-31],stage.s,sizeof(stage));
+      } else {
+        d->s[i] = s;
+      }
 
       /* Store surviving metrics */
       vp->new_metrics->v[2*i] = _mm_unpacklo_epi16(survivor0,survivor1);
@@ -190,4 +222,13 @@ void update_viterbi615_blk_sse2(struct v615 *p,unsigned char *syms,int nbits){
   vp->dp = d;
 }
 
+void update_viterbi615_blk_sse2(struct v615 *p,unsigned char *syms,int nbits){
+  if(p->decision_store == DecisionStorePolicy::STREAMING){
+    update_viterbi615_blk<true>(p,syms,nbits);
+    _mm_sfence();
+  } else {
+    update_viterbi615_blk<false>(p,syms,nbits);
+  }
+}
+
 
@@ -5,4 +5,7 @@ struct v615 *create_viterbi615_sse2(const int *poly, int len);
 int init_viterbi615_sse2(struct v615 *p, int starting_state);
 int chainback_viterbi615_sse2(struct v615 *p, unsigned char *data, unsigned int nbits, unsigned int endstate);
 void delete_viterbi615_sse2(struct v615 *p);
+/* syms are signed 8bit soft decisions where +127 is a 1 and -127 is a 0 */
 void update_viterbi615_blk_sse2(struct v615 *p, unsigned char *syms, int nbits);
+void set_decision_store_viterbi615_sse2(struct v615 *p, int policy);
+unsigned int get_best_state_viterbi615_sse2(struct v615 *p);
@@ -20,9 +20,12 @@ def main():
     samples = load_samples_from_json(json_data)
 
     names = list(unique((s.name for s in samples)))
-    kr_list = list(unique(((s.K,s.R) for s in samples)))
+    # frames of different lengths can be run for the same code
+    kr_list = list(unique(((s.K,s.R,s.total_input_bytes) for s in samples)))
     norm_name = "sse_u8"
-    sorted_names = ["ka9q", "spiral", "sse_u16", "avx_u16", "sse_u8", "avx_u8"]
+    # only plot runs that have a sample to normalise against
+    kr_list = [(K,R,N) for (K,R,N) in kr_list if any(s.K == K and s.R == R and s.total_input_bytes == N and s.name == norm_name for s in samples)]
+    sorted_names = ["ka9q", "spiral", "spiral_avx2", "sse_u16", "avx_u16", "sse_u8", "avx_u8"]
 
     import matplotlib.pyplot as plt
     import matplotlib.ticker as mpl_ticker
@@ -34,11 +37,11 @@ def main():
     figsize = (10,5)
     fig, ax = plt.subplots(figsize=figsize)
     kr_norms = {}
-    for (K,R) in kr_list:
-        sample = next(s for s in samples if s.K == K and s.R == R and s.name == norm_name)
-        kr_norms[(K,R)] = np.mean(sample.update_ns)
+    for (K,R,N) in kr_list:
+        sample = next(s for s in samples if s.K == K and s.R == R and s.total_input_bytes == N and s.name == norm_name)
+        kr_norms[(K,R,N)] = np.mean(sample.update_ns)
     for name_index, name in enumerate(sorted_names):
-        kr_samples = {(s.K,s.R): s for s in samples if s.name == name}
+        kr_samples = {(s.K,s.R,s.total_input_bytes): s for s in samples if s.name == name}
         x_offset = name_index*bar_width
         x = []
         y_avg = []
@@ -48,7 +51,6 @@ def main():
                 continue
             sample = kr_samples[key]
             value_norm = kr_norms[key]
-            K, R = key
             x.append(column_index + x_offset - column_width/2 + bar_width/2)
             values = value_norm / sample.update_ns
             y_avg.append(np.mean(values))
@@ -57,7 +59,7 @@ def main():
         ax.errorbar(x, y_avg, y_std, fmt="none", linewidth=0.5, capsize=3, color="black")
     ax.set_ylim([0,2])
     ax.set_xticks(np.arange(len(kr_list)))
-    ax.set_xticklabels([f"K={K} R={R}" for K,R in kr_list])
+    ax.set_xticklabels([f"K={K} R={R}" for K,R,_ in kr_list])
     ax.legend(loc="upper right")
     ax.set_ylabel("Relative symbol update rate")
     ax.yaxis.set_major_locator(mpl_ticker.MultipleLocator(0.5))
@@ -73,11 +75,11 @@ def main():
 
     fig, ax = plt.subplots(figsize=figsize)
     kr_norms = {}
-    for (K,R) in kr_list:
-        sample = next(s for s in samples if s.K == K and s.R == R and s.name == norm_name)
-        kr_norms[(K,R)] = np.mean(sample.chainback_ns)
+    for (K,R,N) in kr_list:
+        sample = next(s for s in samples if s.K == K and s.R == R and s.total_input_bytes == N and s.name == norm_name)
+        kr_norms[(K,R,N)] = np.mean(sample.chainback_ns)
     for name_index, name in enumerate(sorted_names):
-        kr_samples = {(s.K,s.R): s for s in samples if s.name == name}
+        kr_samples = {(s.K,s.R,s.total_input_bytes): s for s in samples if s.name == name}
         x_offset = name_index*bar_width
         x = []
         y_avg = []
@@ -87,7 +89,6 @@ def main():
                 continue
             sample = kr_samples[key]
             value_norm = kr_norms[key]
-            K, R = key
             x.append(column_index + x_offset - column_width/2 + bar_width/2)
             values = value_norm / sample.chainback_ns
             y_avg.append(np.mean(values))
@@ -96,7 +97,7 @@ def main():
         ax.errorbar(x, y_avg, y_std, fmt="none", linewidth=0.5, capsize=3, color="black")
     ax.set_ylim([0,2])
     ax.set_xticks(np.arange(len(kr_list)))
-    ax.set_xticklabels([f"K={K} R={R}" for K,R in kr_list])
+    ax.set_xticklabels([f"K={K} R={R}" for K,R,_ in kr_list])
     ax.legend(loc="upper right")
     ax.set_ylabel("Relative chainback bit rate")
     ax.yaxis.set_major_locator(mpl_ticker.MultipleLocator(0.5))
@@ -11,10 +11,38 @@ class Sample:
         self.total_output_symbols = v["total_output_symbols"]
         self.sampling_time = v["sampling_time"]
         self.minimum_samples = v["minimum_samples"]
+        # only present when frames went through the noisy channel with --channel-ebno
+        self.channel_ebno_db = v.get("channel_ebno_db", None)
         self.total_samples = v["total_samples"]
         self.init_ns = np.array(v["init_ns"])
         self.update_ns = np.array(v["update_ns"])
+        # only present when built with VITERBI_METRIC_COUNTERS
+        self.metric_counters = v.get("metric_counters", None)
         self.chainback_ns = np.array(v["chainback_ns"])
+        self.best_state_ns = np.array(v.get("best_state_ns", []))
+        # fenced timestamp counter reference cycles, only present on x86
+        self.tsc_frequency_hz = v.get("tsc_frequency_hz", None)
+        self.update_cycles = np.array(v.get("update_cycles", []))
+        self.chainback_cycles = np.array(v.get("chainback_cycles", []))
+        # decoder startup, only present for tests that sample it
+        # branch_table_ns is only present for our decoders since ka9q and spiral build theirs inside create
+        self.create_ns = np.array(v.get("create_ns", []))
+        self.branch_table_ns = np.array(v.get("branch_table_ns", []))
+        self.warmup_update_ns = np.array(v.get("warmup_update_ns", []))
+        self.destroy_ns = np.array(v.get("destroy_ns", []))
+        # encoder tests only time encoding, their errors are symbols that differ from the decoders' test frame
+        self.encode_ns = np.array(v.get("encode_ns", []))
+        # package energy in microjoules, only present when run with --energy
+        self.update_energy_uj = np.array(v.get("update_energy_uj", []))
+        self.chainback_energy_uj = np.array(v.get("chainback_energy_uj", []))
+        # {phase: {counter: [...]}} only present when hardware counters could be opened
+        self.perf_counters = {
+            phase: {name: np.array(values) for name, values in counters.items()}
+            for phase, counters in v.get("perf_counters", {}).items()
+        }
+        # {phase: {allocations, bytes_allocated, bytes_in_use, rss_bytes, peak_rss_bytes}} and steady_allocations
+        # only present when malloc could be replaced to track heap usage
+        self.memory = v.get("memory", None)
         self.total_bits = v["total_bits"]
         self.total_bit_errors = v["total_bit_errors"]
         self.bit_error_rate = v["bit_error_rate"]
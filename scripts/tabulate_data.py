@@ -4,6 +4,8 @@ import numpy as np
 from sample_loader import Sample, load_samples_from_json
 from util import unique, get_si_scale
 
+UNTERMINATED_SUFFIX = "_unterminated"
+
 def main():
     parser = argparse.ArgumentParser(
         prog="tabulate_data",
@@ -17,15 +19,22 @@ def main():
         json_text = fp.read()
     json_data = json.loads(json_text)
     samples = load_samples_from_json(json_data)
+    # encoders are tabulated separately since they have no decode phases
+    encode_samples = [s for s in samples if len(s.encode_ns) > 0]
+    samples = [s for s in samples if len(s.encode_ns) == 0]
+    # streams cut off partway through the trellis only check that best state chainback decodes them
+    unterminated_samples = [s for s in samples if s.name.endswith(UNTERMINATED_SUFFIX)]
+    samples = [s for s in samples if not s.name.endswith(UNTERMINATED_SUFFIX)]
 
     names = list(unique((s.name for s in samples)))
-    kr_list = list(unique(((s.K,s.R) for s in samples)))
+    # frames of different lengths can be run for the same code
+    krn_list = list(unique(((s.K,s.R,s.total_input_bytes) for s in samples)))
 
     print("## Update symbol rate")
-    print("| K | R | {0} |".format(" | ".join(names)))
-    print("| {0} |".format(" | ".join(["---"]*(len(names)+2))))
-    for (K, R) in kr_list:
-        kr_samples = {s.name: s for s in samples if (s.K == K and s.R == R)}
+    print("| K | R | Bytes | {0} |".format(" | ".join(names)))
+    print("| {0} |".format(" | ".join(["---"]*(len(names)+3))))
+    for (K, R, N) in krn_list:
+        kr_samples = {s.name: s for s in samples if (s.K == K and s.R == R and s.total_input_bytes == N)}
         values = []
         for name in names:
             if name in kr_samples:
@@ -39,14 +48,14 @@ def main():
                 values.append(f"{avg:.3g}±{std:.2g}{prefix}")
             else:
                 values.append("---")
-        print("| {0} | {1} | {2} |".format(K, R, " | ".join(values)))
+        print("| {0} | {1} | {2} | {3} |".format(K, R, N, " | ".join(values)))
 
     print()
     print("## Chainback bit rate")
-    print("| K | R | {0} |".format(" | ".join(names)))
-    print("| {0} |".format(" | ".join(["---"]*(len(names)+2))))
-    for (K, R) in kr_list:
-        kr_samples = {s.name: s for s in samples if (s.K == K and s.R == R)}
+    print("| K | R | Bytes | {0} |".format(" | ".join(names)))
+    print("| {0} |".format(" | ".join(["---"]*(len(names)+3))))
+    for (K, R, N) in krn_list:
+        kr_samples = {s.name: s for s in samples if (s.K == K and s.R == R and s.total_input_bytes == N)}
         values = []
         for name in names:
             if name in kr_samples:
@@ -60,7 +69,160 @@ def main():
                 values.append(f"{avg:.3g}±{std:.2g}{prefix}")
             else:
                 values.append("---")
-        print("| {0} | {1} | {2} |".format(K, R, " | ".join(values)))
+        print("| {0} | {1} | {2} | {3} |".format(K, R, N, " | ".join(values)))
+
+    # Cycles are independent of clock speed so these compare directly across CPUs
+    print_cycles_table(
+        "Update cycles per decoded bit", samples, names, krn_list,
+        lambda s: s.update_cycles / s.total_transmit_bits)
+    print_cycles_table(
+        "Update cycles per state update", samples, names, krn_list,
+        lambda s: s.update_cycles / (s.total_transmit_bits * 2**(s.K-1)))
+
+    print_energy_table(samples, names, krn_list)
+    print_bit_error_table(samples, names, krn_list)
+
+    # Startup cost when spinning up a decoder per connection
+    print_create_table(
+        "Create time (us)", samples, names, krn_list,
+        lambda s: s.create_ns)
+    print_create_table(
+        "First update after create (us)", samples, names, krn_list,
+        lambda s: s.warmup_update_ns)
+
+    print_encode_table(encode_samples)
+    print_unterminated_table(unterminated_samples)
+
+def print_unterminated_table(samples):
+    if len(samples) == 0:
+        return
+    names = list(unique((s.name[:-len(UNTERMINATED_SUFFIX)] for s in samples)))
+    krn_list = list(unique(((s.K,s.R,s.total_input_bytes) for s in samples)))
+    print()
+    print("## Unterminated stream bit error rate")
+    print("| K | R | Bytes | {0} |".format(" | ".join(names)))
+    print("| {0} |".format(" | ".join(["---"]*(len(names)+3))))
+    for (K, R, N) in krn_list:
+        kr_samples = {s.name[:-len(UNTERMINATED_SUFFIX)]: s for s in samples if (s.K == K and s.R == R and s.total_input_bytes == N)}
+        values = []
+        for name in names:
+            if name in kr_samples:
+                sample = kr_samples[name]
+                values.append(f"{sample.total_bit_errors/sample.total_bits:.3g}")
+            else:
+                values.append("---")
+        print("| {0} | {1} | {2} | {3} |".format(K, R, N, " | ".join(values)))
+
+def print_encode_table(samples):
+    if len(samples) == 0:
+        return
+    names = list(unique((s.name for s in samples)))
+    krn_list = list(unique(((s.K,s.R,s.total_input_bytes) for s in samples)))
+    print()
+    print("## Encode bit rate")
+    print("| K | R | Bytes | {0} |".format(" | ".join(names)))
+    print("| {0} |".format(" | ".join(["---"]*(len(names)+3))))
+    for (K, R, N) in krn_list:
+        kr_samples = {s.name: s for s in samples if (s.K == K and s.R == R and s.total_input_bytes == N)}
+        values = []
+        for name in names:
+            if name in kr_samples:
+                sample = kr_samples[name]
+                bit_rate = sample.total_input_bytes*8 / (sample.encode_ns*1e-9)
+                avg = np.mean(bit_rate)
+                std = np.std(bit_rate)
+                prefix, scale = get_si_scale(avg)
+                avg = avg/scale
+                std = std/scale
+                values.append(f"{avg:.3g}±{std:.2g}{prefix}")
+            else:
+                values.append("---")
+        print("| {0} | {1} | {2} | {3} |".format(K, R, N, " | ".join(values)))
+
+def print_create_table(title, samples, names, krn_list, get_ns):
+    if not any(len(s.create_ns) > 0 for s in samples):
+        return
+    print()
+    print(f"## {title}")
+    print("| K | R | Bytes | {0} |".format(" | ".join(names)))
+    print("| {0} |".format(" | ".join(["---"]*(len(names)+3))))
+    for (K, R, N) in krn_list:
+        kr_samples = {s.name: s for s in samples if (s.K == K and s.R == R and s.total_input_bytes == N)}
+        values = []
+        for name in names:
+            if name in kr_samples and len(kr_samples[name].create_ns) > 0:
+                us = get_ns(kr_samples[name])*1e-3
+                values.append(f"{np.median(us):.3g}")
+            else:
+                values.append("---")
+        print("| {0} | {1} | {2} | {3} |".format(K, R, N, " | ".join(values)))
+
+def print_bit_error_table(samples, names, krn_list):
+    # noiseless frames always decode without errors
+    if not any(s.channel_ebno_db is not None for s in samples):
+        return
+    print()
+    print("## Bit error rate")
+    print("| K | R | Bytes | Eb/N0 | {0} |".format(" | ".join(names)))
+    print("| {0} |".format(" | ".join(["---"]*(len(names)+4))))
+    for (K, R, N) in krn_list:
+        kr_samples = {s.name: s for s in samples if (s.K == K and s.R == R and s.total_input_bytes == N)}
+        ebno_db = next((s.channel_ebno_db for s in kr_samples.values() if s.channel_ebno_db is not None), None)
+        if ebno_db is None:
+            continue
+        values = []
+        for name in names:
+            if name in kr_samples:
+                # bit_error_rate is written with fixed precision so recompute it from the totals
+                sample = kr_samples[name]
+                values.append(f"{sample.total_bit_errors/sample.total_bits:.3g}")
+            else:
+                values.append("---")
+        print("| {0} | {1} | {2} | {3:g} | {4} |".format(K, R, N, ebno_db, " | ".join(values)))
+
+def print_energy_table(samples, names, krn_list):
+    if not any(len(s.update_energy_uj) > 0 for s in samples):
+        return
+    print()
+    print("## Decoded bits per joule")
+    print("| K | R | Bytes | {0} |".format(" | ".join(names)))
+    print("| {0} |".format(" | ".join(["---"]*(len(names)+3))))
+    for (K, R, N) in krn_list:
+        kr_samples = {s.name: s for s in samples if (s.K == K and s.R == R and s.total_input_bytes == N)}
+        values = []
+        for name in names:
+            sample = kr_samples.get(name, None)
+            if sample is None or len(sample.update_energy_uj) == 0:
+                values.append("---")
+                continue
+            # RAPL counters update about once a millisecond so use totals over all samples instead of each one
+            total_joules = (np.sum(sample.update_energy_uj) + np.sum(sample.chainback_energy_uj)) * 1e-6
+            total_bits = sample.total_input_bytes*8*sample.total_samples
+            if total_joules <= 0:
+                values.append("---")
+                continue
+            bits_per_joule = total_bits / total_joules
+            prefix, scale = get_si_scale(bits_per_joule)
+            values.append(f"{bits_per_joule/scale:.3g}{prefix}")
+        print("| {0} | {1} | {2} | {3} |".format(K, R, N, " | ".join(values)))
+
+def print_cycles_table(title, samples, names, krn_list, get_cycles):
+    if not any(len(s.update_cycles) > 0 for s in samples):
+        return
+    print()
+    print(f"## {title}")
+    print("| K | R | Bytes | {0} |".format(" | ".join(names)))
+    print("| {0} |".format(" | ".join(["---"]*(len(names)+3))))
+    for (K, R, N) in krn_list:
+        kr_samples = {s.name: s for s in samples if (s.K == K and s.R == R and s.total_input_bytes == N)}
+        values = []
+        for name in names:
+            if name in kr_samples and len(kr_samples[name].update_cycles) > 0:
+                cycles = get_cycles(kr_samples[name])
+                values.append(f"{np.median(cycles):.3g}")
+            else:
+                values.append("---")
+        print("| {0} | {1} | {2} | {3} |".format(K, R, N, " | ".join(values)))
 
 if __name__ == '__main__':
     main()
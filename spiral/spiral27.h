@@ -1,9 +1,14 @@
 #pragma once
 
 struct spiral27;
+struct MetricCounters;
 
 spiral27 *create_spiral27(const int *poly, int len);
 int init_spiral27(spiral27 *vp, int starting_state);
+/* syms are signed 8bit soft decisions where +127 is a 1 and -127 is a 0 */
 void update_spiral27(spiral27 *vp, unsigned char *syms, int nbits);
 int chainback_spiral27(spiral27 *vp, unsigned char *data, unsigned int nbits, unsigned int endstate);
 void delete_spiral27(spiral27 *vp);
+void set_decision_store_spiral27(spiral27 *vp, int policy);
+unsigned int get_best_state_spiral27(spiral27 *vp);
+const MetricCounters *get_metric_counters_spiral27(spiral27 *vp);
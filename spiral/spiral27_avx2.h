@@ -0,0 +1,14 @@
+#pragma once
+
+struct spiral27_avx2;
+struct MetricCounters;
+
+spiral27_avx2 *create_spiral27_avx2(const int *poly, int len);
+int init_spiral27_avx2(spiral27_avx2 *vp, int starting_state);
+/* syms are signed 8bit soft decisions where +127 is a 1 and -127 is a 0 */
+void update_spiral27_avx2(spiral27_avx2 *vp, unsigned char *syms, int nbits);
+int chainback_spiral27_avx2(spiral27_avx2 *vp, unsigned char *data, unsigned int nbits, unsigned int endstate);
+void delete_spiral27_avx2(spiral27_avx2 *vp);
+void set_decision_store_spiral27_avx2(spiral27_avx2 *vp, int policy);
+unsigned int get_best_state_spiral27_avx2(spiral27_avx2 *vp);
+const MetricCounters *get_metric_counters_spiral27_avx2(spiral27_avx2 *vp);
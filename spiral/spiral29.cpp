@@ -4,7 +4,10 @@
 #include <xmmintrin.h>
 #include <mmintrin.h>
 #include "./spiral29.h"
-#include "../src/parity.h"
+#include "../src/branch_table.h"
+#include "../src/decision_store.h"
+#include "../src/argmin.h"
+#include "../src/metric_counters.h"
 
 #define K 9
 #define RATE 2
@@ -40,7 +43,11 @@ inline void renormalize(COMPUTETYPE* X, COMPUTETYPE threshold){
     }
 }
 
-  static COMPUTETYPE Branchtab[NUMSTATES/2*RATE];
+/* The code used by the benchmark is generated at compile time and other codes get their own table on create */
+static constexpr auto& Branchtab_default = CONSTEXPR_BRANCH_TABLE<COMPUTETYPE, K, 0x7F, 0x80, 0x1af, 0x11d>;
+
+/* Spiral decodes 2 bits per step so stage at least one full step */
+static constexpr size_t DECISION_STAGE_SIZE = (get_decision_stage_size<decision_t>() < 2) ? 2 : get_decision_stage_size<decision_t>();
 
 /* State info for instance of Viterbi decoder
  */
@@ -49,6 +56,11 @@ struct spiral29 {
    metric_t metrics2; /* path metric buffer 2 */
   metric_t *old_metrics,*new_metrics; /* Pointers to path metrics, swapped on every bit */
   decision_t *decisions;   /* decisions */
+  DecisionStorePolicy decision_store; /* How decisions are written during update */
+  decision_t decision_stage[DECISION_STAGE_SIZE]; /* Decisions waiting to be streamed */
+  const COMPUTETYPE *branchtab; /* Branch table of this decoder's code */
+  BranchTable<COMPUTETYPE, K, RATE> *branchtab_custom; /* Owned table if the code isn't the default */
+  MetricCounters counters; /* Path metric dynamics of the current frame */
 };
 
 /* Initialize Viterbi decoder for start of new frame */
@@ -60,25 +72,24 @@ int init_spiral29(spiral29 *vp,int starting_state){
   vp->old_metrics = &vp->metrics1;
   vp->new_metrics = &vp->metrics2;
   vp->old_metrics->t[starting_state & (NUMSTATES-1)] = 0; /* Bias known start state */
+  vp->counters = MetricCounters();
   return 0;
 }
 
 /* Create a new instance of a Viterbi decoder */
 spiral29 *create_spiral29(const int *poly, int len){
   struct spiral29 *vp;
-  static int Init = 0;
-  if(!Init){
-    int state, i;
-    const auto& parity = ParityTable::get();
-    for(state=0;state < NUMSTATES/2;state++){
-      for (i=0; i<RATE; i++){
-        Branchtab[i*NUMSTATES/2+state] = (poly[i] < 0) ^ parity.parse((2*state) & abs(poly[i])) ? 255 : 0;
-      }
-    }
-    Init++;
-  }
   vp = (spiral29*)malloc(sizeof(struct spiral29));
-  vp->decisions = (decision_t*)malloc((len+(K-1))*sizeof(decision_t));
+  /* Symbols are signed so flip the sign bit, XOR then gives offset binary with conditional negation */
+  if(Branchtab_default.is_poly(poly)){
+    vp->branchtab = Branchtab_default.values;
+    vp->branchtab_custom = NULL;
+  } else {
+    vp->branchtab_custom = create_branch_table<COMPUTETYPE, K, RATE>(poly, 0x7F, 0x80);
+    vp->branchtab = vp->branchtab_custom->values;
+  }
+  vp->decisions = (decision_t*)decision_store_malloc((len+(K-1))*sizeof(decision_t));
+  vp->decision_store = DecisionStorePolicy::CACHED;
   init_spiral29(vp,0);
   return vp;
 }
@@ -124,15 +135,28 @@ int chainback_spiral29(
   return 0;
 }
 
+/* Find state with the best path metric for chainback of unterminated streams
+ * Metrics use saturating unsigned arithmetic
+ */
+unsigned int get_best_state_spiral29(spiral29 *vp) {
+  return (unsigned int)argmin_u8(vp->old_metrics->t, NUMSTATES);
+}
+
+/* Path metric counters of the last frame, only updated when built with VITERBI_METRIC_COUNTERS */
+const MetricCounters *get_metric_counters_spiral29(spiral29 *vp) {
+  return &vp->counters;
+}
+
 /* Delete instance of a Viterbi decoder */
 void delete_spiral29(spiral29 *vp){
   if(vp != NULL){
-    free(vp->decisions);
+    decision_store_free(vp->decisions);
+    delete_branch_table(vp->branchtab_custom);
     free(vp);
   }
 }
 
-static void FULL_SPIRAL(unsigned char  *Y, unsigned char  *X, unsigned char  *syms, unsigned char  *dec, unsigned char  *Branchtab, int N) {
+static void FULL_SPIRAL(unsigned char  *Y, unsigned char  *X, unsigned char  *syms, unsigned char  *dec, const unsigned char  *Branchtab, int N, [[maybe_unused]] MetricCounters *counters) {
     for(int i9 = 0; i9 < N; i9++) {
         unsigned char a285, a291;
         int a283, a302;
@@ -504,6 +528,7 @@ static void FULL_SPIRAL(unsigned char  *Y, unsigned char  *X, unsigned char  *sy
         *(a425) = s112;
         a426 = (a305 + 15);
         *(a426) = s113;
+        COUNT_METRICS_U8(counters, Y, NUMSTATES, 210);
         if ((((unsigned char  *) Y)[0]>210)) {
             __m128i m5, m6;
             m5 = ((__m128i  *) Y)[0];
@@ -918,6 +943,7 @@ static void FULL_SPIRAL(unsigned char  *Y, unsigned char  *X, unsigned char  *sy
         *(a850) = s224;
         a851 = (a731 + 15);
         *(a851) = s225;
+        COUNT_METRICS_U8(counters, X, NUMSTATES, 210);
         if ((((unsigned char  *) X)[0]>210)) {
             __m128i m12, m13;
             m12 = ((__m128i  *) X)[0];
@@ -965,6 +991,18 @@ static void FULL_SPIRAL(unsigned char  *Y, unsigned char  *X, unsigned char  *sy
     /* skip */
 }
 
+/* Select whether decisions are written through the cache or streamed */
+void set_decision_store_spiral29(spiral29 *vp, int policy) {
+  vp->decision_store = DecisionStorePolicy(policy);
+}
+
 void update_spiral29(spiral29 *vp, COMPUTETYPE *syms, int nbits) {
-  FULL_SPIRAL(vp->new_metrics->t, vp->old_metrics->t, syms, vp->decisions->c, Branchtab, nbits/2);
+  decision_t *d = vp->decisions;
+  if (vp->decision_store == DecisionStorePolicy::STREAMING) {
+    update_with_streamed_decisions(d, vp->decision_stage, size_t(nbits), [&](decision_t *dst, size_t bit, size_t n) {
+      FULL_SPIRAL(vp->new_metrics->t, vp->old_metrics->t, syms+bit*RATE, dst->c, vp->branchtab, int(n/2), &vp->counters);
+    });
+  } else {
+    FULL_SPIRAL(vp->new_metrics->t, vp->old_metrics->t, syms, d->c, vp->branchtab, nbits/2, &vp->counters);
+  }
 }
@@ -1,9 +1,14 @@
 #pragma once
 
 struct spiral29;
+struct MetricCounters;
 
 spiral29 *create_spiral29(const int *poly, int len);
 int init_spiral29(spiral29 *vp, int starting_state);
+/* syms are signed 8bit soft decisions where +127 is a 1 and -127 is a 0 */
 void update_spiral29(spiral29 *vp, unsigned char *syms, int nbits);
 int chainback_spiral29(spiral29 *vp, unsigned char *data, unsigned int nbits, unsigned int endstate);
 void delete_spiral29(spiral29 *vp);
+void set_decision_store_spiral29(spiral29 *vp, int policy);
+unsigned int get_best_state_spiral29(spiral29 *vp);
+const MetricCounters *get_metric_counters_spiral29(spiral29 *vp);
@@ -1,9 +1,14 @@
 #pragma once
 
 struct spiral47;
+struct MetricCounters;
 
 spiral47 *create_spiral47(const int *poly, int len);
 int init_spiral47(spiral47 *vp, int starting_state);
+/* syms are signed 8bit soft decisions where +127 is a 1 and -127 is a 0 */
 void update_spiral47(spiral47 *vp, unsigned char *syms, int nbits);
 int chainback_spiral47(spiral47 *vp, unsigned char *data, unsigned int nbits, unsigned int endstate);
 void delete_spiral47(spiral47 *vp);
+void set_decision_store_spiral47(spiral47 *vp, int policy);
+unsigned int get_best_state_spiral47(spiral47 *vp);
+const MetricCounters *get_metric_counters_spiral47(spiral47 *vp);
@@ -0,0 +1,159 @@
+#include <immintrin.h>
+#include <math.h>
+#include "./spiral47_avx2.h"
+#include "./spiral_avx2.h"
+#include "../src/branch_table.h"
+#include "../src/decision_store.h"
+#include "../src/argmin.h"
+#include "../src/metric_counters.h"
+
+#define K 7
+#define RATE 4
+#define NUMSTATES 64
+#define DECISIONTYPE unsigned char
+#define DECISIONTYPE_BITSIZE 8
+#define COMPUTETYPE unsigned char
+#define METRICSHIFT 2
+#define PRECISIONSHIFT 2
+#define RENORMALIZE_THRESHOLD 114
+
+//decision_t is a BIT vector
+typedef union  {
+  DECISIONTYPE t[NUMSTATES/DECISIONTYPE_BITSIZE];
+  unsigned int w[NUMSTATES/32];
+  unsigned short s[NUMSTATES/16];
+  unsigned char c[NUMSTATES/8];
+} decision_t;
+
+typedef union  {
+  COMPUTETYPE t[NUMSTATES];
+} metric_t;
+
+/* The code used by the benchmark is generated at compile time and other codes get their own table on create */
+static constexpr auto& Branchtab_default = CONSTEXPR_BRANCH_TABLE<COMPUTETYPE, K, 0x7F, 0x80, 121, 117, 91, 111>;
+
+/* Spiral decodes 2 bits per step so stage at least one full step */
+static constexpr size_t DECISION_STAGE_SIZE = (get_decision_stage_size<decision_t>() < 2) ? 2 : get_decision_stage_size<decision_t>();
+
+/* State info for instance of Viterbi decoder
+ */
+struct spiral47_avx2 {
+   metric_t metrics1; /* path metric buffer 1 */
+   metric_t metrics2; /* path metric buffer 2 */
+  metric_t *old_metrics,*new_metrics; /* Pointers to path metrics, swapped on every bit */
+  decision_t *decisions;   /* decisions */
+  DecisionStorePolicy decision_store; /* How decisions are written during update */
+  decision_t decision_stage[DECISION_STAGE_SIZE]; /* Decisions waiting to be streamed */
+  const COMPUTETYPE *branchtab; /* Branch table of this decoder's code */
+  BranchTable<COMPUTETYPE, K, RATE> *branchtab_custom; /* Owned table if the code isn't the default */
+  MetricCounters counters; /* Path metric dynamics of the current frame */
+};
+
+/* Initialize Viterbi decoder for start of new frame */
+int init_spiral47_avx2(spiral47_avx2 *vp,int starting_state){
+  int i;
+  for(i=0;i<NUMSTATES;i++) vp->metrics1.t[i] = 63;
+  vp->old_metrics = &vp->metrics1;
+  vp->new_metrics = &vp->metrics2;
+  vp->old_metrics->t[starting_state & (NUMSTATES-1)] = 0; /* Bias known start state */
+  vp->counters = MetricCounters();
+  return 0;
+}
+
+/* Create a new instance of a Viterbi decoder */
+spiral47_avx2 *create_spiral47_avx2(const int* poly, int len){
+  struct spiral47_avx2* vp = (spiral47_avx2*)malloc(sizeof(struct spiral47_avx2));
+  /* Symbols are signed so flip the sign bit, XOR then gives offset binary with conditional negation */
+  if(Branchtab_default.is_poly(poly)){
+    vp->branchtab = Branchtab_default.values;
+    vp->branchtab_custom = NULL;
+  } else {
+    vp->branchtab_custom = create_branch_table<COMPUTETYPE, K, RATE>(poly, 0x7F, 0x80);
+    vp->branchtab = vp->branchtab_custom->values;
+  }
+  vp->decisions = (decision_t*)decision_store_malloc((len+(K-1))*sizeof(decision_t));
+  vp->decision_store = DecisionStorePolicy::CACHED;
+  init_spiral47_avx2(vp,0);
+  return vp;
+}
+
+/* Viterbi chainback */
+int chainback_spiral47_avx2(
+      spiral47_avx2 *vp,
+      unsigned char *data, /* Decoded output data */
+      unsigned int nbits, /* Number of data bits */
+      unsigned int endstate){ /* Terminal encoder state */
+  decision_t *d;
+
+  /* ADDSHIFT and SUBSHIFT make sure that the thing returned is a byte. */
+#if (K-1<8)
+#define ADDSHIFT (8-(K-1))
+#define SUBSHIFT 0
+#elif (K-1>8)
+#define ADDSHIFT 0
+#define SUBSHIFT ((K-1)-8)
+#else
+#define ADDSHIFT 0
+#define SUBSHIFT 0
+#endif
+  d = vp->decisions;
+  /* Make room beyond the end of the encoder register so we can
+   * accumulate a full byte of decoded data
+   */
+
+  endstate = (endstate%NUMSTATES) << ADDSHIFT;
+
+  /* The store into data[] only needs to be done every 8 bits.
+   * But this avoids a conditional branch, and the writes will
+   * combine in the cache anyway
+   */
+  d += (K-1); /* Look past tail */
+  while(nbits-- != 0){
+    int k;
+    k = (d[nbits].w[(endstate>>ADDSHIFT)/32] >> ((endstate>>ADDSHIFT)%32)) & 1;
+    endstate = (endstate >> 1) | (k << (K-2+ADDSHIFT));
+    data[nbits>>3] = endstate>>SUBSHIFT;
+  }
+  return 0;
+}
+
+/* Find state with the best path metric for chainback of unterminated streams
+ * Metrics use saturating unsigned arithmetic
+ */
+unsigned int get_best_state_spiral47_avx2(spiral47_avx2 *vp) {
+  return (unsigned int)argmin_u8(vp->old_metrics->t, NUMSTATES);
+}
+
+/* Path metric counters of the last frame, only updated when built with VITERBI_METRIC_COUNTERS */
+const MetricCounters *get_metric_counters_spiral47_avx2(spiral47_avx2 *vp) {
+  return &vp->counters;
+}
+
+/* Delete instance of a Viterbi decoder */
+void delete_spiral47_avx2(spiral47_avx2 *vp){
+  if(vp != NULL){
+    decision_store_free(vp->decisions);
+    delete_branch_table(vp->branchtab_custom);
+    free(vp);
+  }
+}
+
+static void FULL_SPIRAL(unsigned char  *Y, unsigned char  *X, unsigned char  *syms, unsigned char  *dec, const unsigned char  *Branchtab, int N, MetricCounters *counters) {
+    spiral_avx2_update<NUMSTATES, RATE, 63, 126>(Y, X, syms, dec, Branchtab, N, counters);
+}
+
+/* Select whether decisions are written through the cache or streamed */
+void set_decision_store_spiral47_avx2(spiral47_avx2 *vp, int policy) {
+  vp->decision_store = DecisionStorePolicy(policy);
+}
+
+void update_spiral47_avx2(spiral47_avx2 *vp, COMPUTETYPE *syms, int nbits) {
+  decision_t *d = vp->decisions;
+  if (vp->decision_store == DecisionStorePolicy::STREAMING) {
+    update_with_streamed_decisions(d, vp->decision_stage, size_t(nbits), [&](decision_t *dst, size_t bit, size_t n) {
+      FULL_SPIRAL(vp->new_metrics->t, vp->old_metrics->t, syms+bit*RATE, dst->c, vp->branchtab, int(n/2), &vp->counters);
+    });
+  } else {
+    FULL_SPIRAL(vp->new_metrics->t, vp->old_metrics->t, syms, d->c, vp->branchtab, nbits/2, &vp->counters);
+  }
+}
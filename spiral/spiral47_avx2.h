@@ -0,0 +1,14 @@
+#pragma once
+
+struct spiral47_avx2;
+struct MetricCounters;
+
+spiral47_avx2 *create_spiral47_avx2(const int *poly, int len);
+int init_spiral47_avx2(spiral47_avx2 *vp, int starting_state);
+/* syms are signed 8bit soft decisions where +127 is a 1 and -127 is a 0 */
+void update_spiral47_avx2(spiral47_avx2 *vp, unsigned char *syms, int nbits);
+int chainback_spiral47_avx2(spiral47_avx2 *vp, unsigned char *data, unsigned int nbits, unsigned int endstate);
+void delete_spiral47_avx2(spiral47_avx2 *vp);
+void set_decision_store_spiral47_avx2(spiral47_avx2 *vp, int policy);
+unsigned int get_best_state_spiral47_avx2(spiral47_avx2 *vp);
+const MetricCounters *get_metric_counters_spiral47_avx2(spiral47_avx2 *vp);
@@ -1,9 +1,14 @@
 #pragma once
 
 struct spiral49;
+struct MetricCounters;
 
 spiral49 *create_spiral49(const int *poly, int len);
 int init_spiral49(spiral49 *vp, int starting_state);
+/* syms are signed 8bit soft decisions where +127 is a 1 and -127 is a 0 */
 void update_spiral49(spiral49 *vp, unsigned char *syms, int nbits);
 int chainback_spiral49(spiral49 *vp, unsigned char *data, unsigned int nbits, unsigned int endstate);
 void delete_spiral49(spiral49 *vp);
+void set_decision_store_spiral49(spiral49 *vp, int policy);
+unsigned int get_best_state_spiral49(spiral49 *vp);
+const MetricCounters *get_metric_counters_spiral49(spiral49 *vp);
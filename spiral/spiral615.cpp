@@ -4,7 +4,10 @@
 #include <xmmintrin.h>
 #include <mmintrin.h>
 #include "./spiral615.h"
-#include "../src/parity.h"
+#include "../src/branch_table.h"
+#include "../src/decision_store.h"
+#include "../src/argmin.h"
+#include "../src/metric_counters.h"
 
 #define K 15
 #define RATE 6
@@ -28,18 +31,28 @@ typedef union  {
   COMPUTETYPE t[NUMSTATES];
 } metric_t;
 
+/* This runs after every bit over all the states so do the min-reduction and subtraction with SSE2 */
 inline void renormalize(COMPUTETYPE* X, COMPUTETYPE threshold){
     if (X[0]>threshold){
-        COMPUTETYPE min=X[0];
-        for(int i=0;i<NUMSTATES;i++) {
-            if (min>X[i]) min=X[i];
-        }
-        for(int i=0;i<NUMSTATES;i++)
-            X[i]-=min;
+        __m128i *v = (__m128i *) X;
+        __m128i m = v[0];
+        for(int i=1;i<NUMSTATES/16;i++) m = _mm_min_epu8(m, v[i]);
+        m = _mm_min_epu8(m, _mm_srli_si128(m, 8));
+        m = _mm_min_epu8(m, _mm_srli_si128(m, 4));
+        m = _mm_min_epu8(m, _mm_srli_si128(m, 2));
+        m = _mm_min_epu8(m, _mm_srli_si128(m, 1));
+        m = _mm_unpacklo_epi8(m, m);
+        m = _mm_shufflelo_epi16(m, _MM_SHUFFLE(0, 0, 0, 0));
+        m = _mm_unpacklo_epi64(m, m);
+        for(int i=0;i<NUMSTATES/16;i++) v[i] = _mm_subs_epu8(v[i], m);
     }
 }
 
- static COMPUTETYPE Branchtab[NUMSTATES/2*RATE];
+/* The code used by the benchmark is generated at compile time and other codes get their own table on create */
+static constexpr auto& Branchtab_default = CONSTEXPR_BRANCH_TABLE<COMPUTETYPE, K, 0x7F, 0x80, 042631, 047245, 056507, 073363, 077267, 064537>;
+
+/* Spiral decodes 2 bits per step so stage at least one full step */
+static constexpr size_t DECISION_STAGE_SIZE = (get_decision_stage_size<decision_t>() < 2) ? 2 : get_decision_stage_size<decision_t>();
 
 /* State info for instance of Viterbi decoder
  */
@@ -48,6 +61,11 @@ struct spiral615 {
    metric_t metrics2; /* path metric buffer 2 */
   metric_t *old_metrics,*new_metrics; /* Pointers to path metrics, swapped on every bit */
   decision_t *decisions;   /* decisions */
+  DecisionStorePolicy decision_store; /* How decisions are written during update */
+  decision_t decision_stage[DECISION_STAGE_SIZE]; /* Decisions waiting to be streamed */
+  const COMPUTETYPE *branchtab; /* Branch table of this decoder's code */
+  BranchTable<COMPUTETYPE, K, RATE> *branchtab_custom; /* Owned table if the code isn't the default */
+  MetricCounters counters; /* Path metric dynamics of the current frame */
 };
 
 /* Initialize Viterbi decoder for start of new frame */
@@ -57,26 +75,23 @@ int init_spiral615(spiral615 *vp,int starting_state){
   vp->old_metrics = &vp->metrics1;
   vp->new_metrics = &vp->metrics2;
   vp->old_metrics->t[starting_state & (NUMSTATES-1)] = 0; /* Bias known start state */
+  vp->counters = MetricCounters();
   return 0;
 }
 
 /* Create a new instance of a Viterbi decoder */
 spiral615 *create_spiral615(const int* poly, int len){
-  static int Init = 0;
-
-  if(!Init){
-    int state, i;
-    const auto& parity = ParityTable::get();
-    for(state=0;state < NUMSTATES/2;state++){
-      for (i=0; i<RATE; i++){
-        Branchtab[i*NUMSTATES/2+state] = (poly[i] < 0) ^ parity.parse((2*state) & abs(poly[i])) ? 255 : 0;
-      }
-    }
-    Init++;
-  }
-
   spiral615 *vp = (spiral615*)malloc(sizeof(struct spiral615));
-  vp->decisions = (decision_t*)malloc((len+(K-1))*sizeof(decision_t));
+  /* Symbols are signed so flip the sign bit, XOR then gives offset binary with conditional negation */
+  if(Branchtab_default.is_poly(poly)){
+    vp->branchtab = Branchtab_default.values;
+    vp->branchtab_custom = NULL;
+  } else {
+    vp->branchtab_custom = create_branch_table<COMPUTETYPE, K, RATE>(poly, 0x7F, 0x80);
+    vp->branchtab = vp->branchtab_custom->values;
+  }
+  vp->decisions = (decision_t*)decision_store_malloc((len+(K-1))*sizeof(decision_t));
+  vp->decision_store = DecisionStorePolicy::CACHED;
   init_spiral615(vp,0);
   return vp;
 }
@@ -121,13 +136,26 @@ int chainback_spiral615(
   return 0;
 }
 
+/* Find state with the best path metric for chainback of unterminated streams
+ * Metrics use saturating unsigned arithmetic
+ */
+unsigned int get_best_state_spiral615(spiral615 *vp) {
+  return (unsigned int)argmin_u8(vp->old_metrics->t, NUMSTATES);
+}
+
+/* Path metric counters of the last frame, only updated when built with VITERBI_METRIC_COUNTERS */
+const MetricCounters *get_metric_counters_spiral615(spiral615 *vp) {
+  return &vp->counters;
+}
+
 /* Delete instance of a Viterbi decoder */
 void delete_spiral615(spiral615 *vp){
-    free(vp->decisions);
+    decision_store_free(vp->decisions);
+    delete_branch_table(vp->branchtab_custom);
     free(vp);
 }
 
-static void FULL_SPIRAL(unsigned char  *Y, unsigned char  *X, unsigned char  *syms, unsigned char  *dec, unsigned char  *Branchtab, int N) {
+static void FULL_SPIRAL(unsigned char  *Y, unsigned char  *X, unsigned char  *syms, unsigned char  *dec, const unsigned char  *Branchtab, int N, [[maybe_unused]] MetricCounters *counters) {
     for(int i9 = 0; i9 < N; i9++) {
         for(int i1 = 0; i1 <= 511; i1++) {
             unsigned char a101, a112, a122, a132, a142, a152;
@@ -266,6 +294,7 @@ static void FULL_SPIRAL(unsigned char  *Y, unsigned char  *X, unsigned char  *sy
             a173 = (a172 + 1);
             *(a173) = s15;
         }
+        COUNT_METRICS_U8(counters, Y, NUMSTATES, 74);
         renormalize(Y, 74);
         for(int i1 = 0; i1 <= 511; i1++) {
             unsigned char a274, a285, a295, a305, a315, a325;
@@ -405,11 +434,24 @@ static void FULL_SPIRAL(unsigned char  *Y, unsigned char  *X, unsigned char  *sy
             a346 = (a345 + 1);
             *(a346) = s29;
         }
+        COUNT_METRICS_U8(counters, X, NUMSTATES, 74);
         renormalize(X, 74);
     }
     /* skip */
 }
 
+/* Select whether decisions are written through the cache or streamed */
+void set_decision_store_spiral615(spiral615 *vp, int policy) {
+  vp->decision_store = DecisionStorePolicy(policy);
+}
+
 void update_spiral615(spiral615 *vp, COMPUTETYPE *syms, int nbits) {
-  FULL_SPIRAL(vp->new_metrics->t, vp->old_metrics->t, syms, vp->decisions->c, Branchtab, nbits/2);
+  decision_t *d = vp->decisions;
+  if (vp->decision_store == DecisionStorePolicy::STREAMING) {
+    update_with_streamed_decisions(d, vp->decision_stage, size_t(nbits), [&](decision_t *dst, size_t bit, size_t n) {
+      FULL_SPIRAL(vp->new_metrics->t, vp->old_metrics->t, syms+bit*RATE, dst->c, vp->branchtab, int(n/2), &vp->counters);
+    });
+  } else {
+    FULL_SPIRAL(vp->new_metrics->t, vp->old_metrics->t, syms, d->c, vp->branchtab, nbits/2, &vp->counters);
+  }
 }
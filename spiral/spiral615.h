@@ -1,9 +1,14 @@
 #pragma once
 
 struct spiral615;
+struct MetricCounters;
 
 spiral615 *create_spiral615(const int *poly, int len);
 int init_spiral615(spiral615 *vp, int starting_state);
+/* syms are signed 8bit soft decisions where +127 is a 1 and -127 is a 0 */
 void update_spiral615(spiral615 *vp, unsigned char *syms, int nbits);
 int chainback_spiral615(spiral615 *vp, unsigned char *data, unsigned int nbits, unsigned int endstate);
 void delete_spiral615(spiral615 *vp);
+void set_decision_store_spiral615(spiral615 *vp, int policy);
+unsigned int get_best_state_spiral615(spiral615 *vp);
+const MetricCounters *get_metric_counters_spiral615(spiral615 *vp);
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <immintrin.h>
+#include "../src/metric_counters.h"
+
+/* AVX2 version of the spiral generated kernels
+ * Branch metrics, saturation and renormalisation thresholds are the same as the SSE2 kernels so both decode identically
+ * Each register holds 32 butterflies so all the codes here need NUMSTATES >= 64
+ * Renormalisation is done in-kernel with a vectorised min-reduction and subtraction
+ * counters belongs to the decoder being updated and is only touched when built with VITERBI_METRIC_COUNTERS
+ */
+template <int NUMSTATES, int RATE, int METRIC_MAX, int RENORMALIZE_THRESHOLD>
+static inline void spiral_avx2_bit(unsigned char *Y, unsigned char *X, const unsigned char *syms, unsigned char *dec, const unsigned char *Branchtab, [[maybe_unused]] MetricCounters *counters) {
+    static_assert(NUMSTATES >= 64, "Need at least 32 butterflies to fill an AVX2 register");
+    constexpr int BUTTERFLIES = NUMSTATES/2;
+    const __m256i mask = _mm256_set1_epi8(63);
+    const __m256i metric_max = _mm256_set1_epi8(METRIC_MAX);
+    __m256i sym[RATE];
+    for (int r = 0; r < RATE; r++) {
+        sym[r] = _mm256_set1_epi8(char(syms[r]));
+    }
+    unsigned int *dec32 = (unsigned int *) dec;
+    for (int i = 0; i < BUTTERFLIES; i += 32) {
+        const __m256i s0 = _mm256_loadu_si256((const __m256i *) &X[i]);
+        const __m256i s1 = _mm256_loadu_si256((const __m256i *) &X[i+BUTTERFLIES]);
+        __m256i t0;
+        if (RATE == 2) {
+            const __m256i b0 = _mm256_xor_si256(sym[0], _mm256_loadu_si256((const __m256i *) &Branchtab[i]));
+            const __m256i b1 = _mm256_xor_si256(sym[1], _mm256_loadu_si256((const __m256i *) &Branchtab[i+BUTTERFLIES]));
+            t0 = _mm256_and_si256(_mm256_srli_epi16(_mm256_avg_epu8(b0, b1), 2), mask);
+        } else {
+            __m256i sum = _mm256_setzero_si256();
+            for (int r = 0; r < RATE; r++) {
+                const __m256i b = _mm256_xor_si256(sym[r], _mm256_loadu_si256((const __m256i *) &Branchtab[r*BUTTERFLIES+i]));
+                sum = _mm256_adds_epu8(sum, _mm256_and_si256(_mm256_srli_epi16(b, 2), mask));
+            }
+            t0 = _mm256_and_si256(_mm256_srli_epi16(sum, 2), mask);
+        }
+        const __m256i t1 = _mm256_subs_epu8(metric_max, t0);
+        const __m256i m0 = _mm256_adds_epu8(s0, t0);
+        const __m256i m1 = _mm256_adds_epu8(s1, t1);
+        const __m256i m2 = _mm256_adds_epu8(s0, t1);
+        const __m256i m3 = _mm256_adds_epu8(s1, t0);
+        const __m256i a0 = _mm256_min_epu8(m1, m0);
+        const __m256i d0 = _mm256_cmpeq_epi8(a0, m1);
+        const __m256i a1 = _mm256_min_epu8(m3, m2);
+        const __m256i d1 = _mm256_cmpeq_epi8(a1, m3);
+        /* unpack interleaves within 128bit lanes so swap the middle lanes to put new states back in order */
+        const __m256i d_lo = _mm256_unpacklo_epi8(d0, d1);
+        const __m256i d_hi = _mm256_unpackhi_epi8(d0, d1);
+        dec32[i/16]   = (unsigned int) _mm256_movemask_epi8(_mm256_permute2x128_si256(d_lo, d_hi, 0x20));
+        dec32[i/16+1] = (unsigned int) _mm256_movemask_epi8(_mm256_permute2x128_si256(d_lo, d_hi, 0x31));
+        const __m256i a_lo = _mm256_unpacklo_epi8(a0, a1);
+        const __m256i a_hi = _mm256_unpackhi_epi8(a0, a1);
+        _mm256_storeu_si256((__m256i *) &Y[2*i],    _mm256_permute2x128_si256(a_lo, a_hi, 0x20));
+        _mm256_storeu_si256((__m256i *) &Y[2*i+32], _mm256_permute2x128_si256(a_lo, a_hi, 0x31));
+    }
+    COUNT_METRICS_U8(counters, Y, NUMSTATES, RENORMALIZE_THRESHOLD);
+    if (Y[0] > RENORMALIZE_THRESHOLD) {
+        __m256i m = _mm256_loadu_si256((const __m256i *) &Y[0]);
+        for (int i = 32; i < NUMSTATES; i += 32) {
+            m = _mm256_min_epu8(m, _mm256_loadu_si256((const __m256i *) &Y[i]));
+        }
+        m = _mm256_min_epu8(m, _mm256_permute2x128_si256(m, m, 0x01));
+        m = _mm256_min_epu8(m, _mm256_srli_si256(m, 8));
+        m = _mm256_min_epu8(m, _mm256_srli_si256(m, 4));
+        m = _mm256_min_epu8(m, _mm256_srli_si256(m, 2));
+        m = _mm256_min_epu8(m, _mm256_srli_si256(m, 1));
+        m = _mm256_broadcastb_epi8(_mm256_castsi256_si128(m));
+        for (int i = 0; i < NUMSTATES; i += 32) {
+            __m256i *v = (__m256i *) &Y[i];
+            _mm256_storeu_si256(v, _mm256_subs_epu8(_mm256_loadu_si256(v), m));
+        }
+    }
+}
+
+/* Decodes 2 bits per step like the SSE2 kernels so the final metrics end up back in X */
+template <int NUMSTATES, int RATE, int METRIC_MAX, int RENORMALIZE_THRESHOLD>
+static void spiral_avx2_update(unsigned char *Y, unsigned char *X, const unsigned char *syms, unsigned char *dec, const unsigned char *Branchtab, int N, MetricCounters *counters) {
+    constexpr int DECISION_BYTES = NUMSTATES/8;
+    for (int i = 0; i < N; i++) {
+        spiral_avx2_bit<NUMSTATES, RATE, METRIC_MAX, RENORMALIZE_THRESHOLD>(Y, X, &syms[2*RATE*i], &dec[2*DECISION_BYTES*i], Branchtab, counters);
+        spiral_avx2_bit<NUMSTATES, RATE, METRIC_MAX, RENORMALIZE_THRESHOLD>(X, Y, &syms[2*RATE*i+RATE], &dec[2*DECISION_BYTES*i+DECISION_BYTES], Branchtab, counters);
+    }
+}
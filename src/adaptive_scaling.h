@@ -0,0 +1,131 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include "./llr_quantiser.h"
+#include "./viterbi_configs.h"
+
+// Our decoders renormalise more often when the symbol magnitude is larger, so the fastest config is
+// the one with the smallest quantisation range that doesn't noticeably degrade the bit error rate
+// This measures the received symbol statistics and picks that range for the current channel
+
+// Running statistics of received BPSK symbols
+class SymbolStatistics
+{
+private:
+    double m_sum_abs = 0.0;
+    double m_sum_squared = 0.0;
+    size_t m_total_symbols = 0u;
+public:
+    void reset() {
+        m_sum_abs = 0.0;
+        m_sum_squared = 0.0;
+        m_total_symbols = 0u;
+    }
+    void update(const float* symbols, const size_t N) {
+        float sum_abs = 0.0f;
+        float sum_squared = 0.0f;
+        for (size_t i = 0u; i < N; i++) {
+            sum_abs += fabsf(symbols[i]);
+            sum_squared += symbols[i]*symbols[i];
+        }
+        m_sum_abs += double(sum_abs);
+        m_sum_squared += double(sum_squared);
+        m_total_symbols += N;
+    }
+    // Estimate of the noiseless symbol amplitude
+    float get_amplitude() const {
+        if (m_total_symbols == 0u) return 1.0f;
+        return float(m_sum_abs / double(m_total_symbols));
+    }
+    // Es/N0 estimated from the spread of symbol magnitudes around the amplitude
+    float get_esno_db() const {
+        if (m_total_symbols == 0u) return 0.0f;
+        const double amplitude = m_sum_abs / double(m_total_symbols);
+        const double power = m_sum_squared / double(m_total_symbols);
+        const double noise = power - amplitude*amplitude;
+        if (noise <= 0.0) return INFINITY;
+        return float(10.0*log10((amplitude*amplitude) / (2.0*noise)));
+    }
+};
+
+struct AdaptiveScalingConfig {
+    int8_t min_magnitude = 1;
+    int8_t max_magnitude = 3;           // reference range which the bit error rate is compared against
+    float ber_tolerance = 0.1f;         // allowed relative increase in bit errors over the reference
+    float esno_bucket_db = 0.5f;        // channel estimates within the same bucket reuse their magnitude
+    size_t min_reference_errors = 100;  // reference bit errors wanted before the tolerance is meaningful
+    size_t min_training_frames = 8;
+    size_t max_training_frames = 32;    // clean channels stop here and only accept magnitudes that match the reference
+};
+
+// Chooses the smallest symbol magnitude that keeps bit errors within tolerance of the reference magnitude
+// Choices are cached per Es/N0 bucket so measurement is only repeated when the channel changes
+class AdaptiveSoftScaler
+{
+private:
+    AdaptiveScalingConfig m_config;
+    std::map<int, int8_t> m_bucket_magnitudes;
+    int8_t m_magnitude;
+public:
+    explicit AdaptiveSoftScaler(const AdaptiveScalingConfig& config)
+    : m_config(config), m_magnitude(config.max_magnitude) {}
+
+    // get_bit_errors(magnitude, frame) decodes a pilot frame quantised to the magnitude and returns its bit errors
+    // Pilot frames carry known data separate from the traffic being decoded so the choice isn't fitted to that traffic
+    // Returns true if the magnitude changed so the decoder config needs to be regenerated
+    template <typename F>
+    bool update(const SymbolStatistics& statistics, F&& get_bit_errors) {
+        // Noiseless channels have an infinite estimate so keep the bucket index in range
+        float esno_db = statistics.get_esno_db();
+        esno_db = (esno_db > 100.0f) ? 100.0f : esno_db;
+        esno_db = (esno_db < -100.0f) ? -100.0f : esno_db;
+        const int bucket = int(floorf(esno_db / m_config.esno_bucket_db));
+        auto it = m_bucket_magnitudes.find(bucket);
+        int8_t magnitude = m_config.max_magnitude;
+        if (it != m_bucket_magnitudes.end()) {
+            magnitude = it->second;
+        } else {
+            // A handful of reference errors makes the tolerance meaningless so keep adding pilot frames
+            size_t total_frames = 0u;
+            size_t reference_errors = 0u;
+            while (total_frames < m_config.max_training_frames) {
+                if ((total_frames >= m_config.min_training_frames) && (reference_errors >= m_config.min_reference_errors)) break;
+                reference_errors += get_bit_errors(m_config.max_magnitude, total_frames);
+                total_frames++;
+            }
+            // Candidates decode the same pilot frames and stop early once they are over the limit
+            const float allowed_errors = float(reference_errors) * (1.0f + m_config.ber_tolerance);
+            for (int8_t m = m_config.min_magnitude; m < m_config.max_magnitude; m++) {
+                size_t total_errors = 0u;
+                for (size_t i = 0u; (i < total_frames) && (float(total_errors) <= allowed_errors); i++) {
+                    total_errors += get_bit_errors(m, i);
+                }
+                if (float(total_errors) <= allowed_errors) {
+                    magnitude = m;
+                    break;
+                }
+            }
+            m_bucket_magnitudes.insert({ bucket, magnitude });
+        }
+        const bool is_changed = (magnitude != m_magnitude);
+        m_magnitude = magnitude;
+        return is_changed;
+    }
+
+    int8_t get_magnitude() const { return m_magnitude; }
+
+    Decoder_Config<int8_t, uint8_t> get_decoding_config(const size_t code_rate) const {
+        return get_scaled8_decoding_config(code_rate, m_magnitude);
+    }
+
+    // The symbol amplitude is mapped onto the magnitude so noise pushes symbols into the lower levels
+    static LLR_Quantiser get_quantiser(const SymbolStatistics& statistics, const int8_t magnitude) {
+        LLR_Quantiser quantiser;
+        quantiser.scale = float(magnitude) / statistics.get_amplitude();
+        quantiser.limit = float(magnitude);
+        return quantiser;
+    }
+};
@@ -0,0 +1,100 @@
+#include "./alloc_tracker.h"
+#include <atomic>
+
+#if VITERBI_ALLOC_TRACKING
+#include <errno.h>
+#include <malloc.h>
+
+// glibc supports replacing malloc by defining these in the executable and still exports its own implementation
+// Everything including libstdc++'s operator new and _mm_malloc's posix_memalign then goes through here
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+// Constant initialised so allocations made before static constructors run are still counted
+static std::atomic<uint64_t> total_allocations{0u};
+static std::atomic<uint64_t> total_bytes_allocated{0u};
+static std::atomic<int64_t> total_bytes_in_use{0};
+
+static void* on_alloc(void* ptr) {
+    if (ptr == nullptr) return ptr;
+    const size_t size = malloc_usable_size(ptr);
+    total_allocations.fetch_add(1u, std::memory_order_relaxed);
+    total_bytes_allocated.fetch_add(size, std::memory_order_relaxed);
+    total_bytes_in_use.fetch_add(int64_t(size), std::memory_order_relaxed);
+    return ptr;
+}
+
+static void on_free(void* ptr) {
+    if (ptr == nullptr) return;
+    total_bytes_in_use.fetch_sub(int64_t(malloc_usable_size(ptr)), std::memory_order_relaxed);
+}
+
+extern "C" {
+
+void* malloc(size_t size) {
+    return on_alloc(__libc_malloc(size));
+}
+
+void* calloc(size_t count, size_t size) {
+    return on_alloc(__libc_calloc(count, size));
+}
+
+void* realloc(void* ptr, size_t size) {
+    const size_t old_size = (ptr != nullptr) ? malloc_usable_size(ptr) : 0u;
+    void* new_ptr = __libc_realloc(ptr, size);
+    if (new_ptr == nullptr) {
+        // realloc(ptr, 0) frees while a failed resize leaves the old block alone
+        if (size == 0u) total_bytes_in_use.fetch_sub(int64_t(old_size), std::memory_order_relaxed);
+        return new_ptr;
+    }
+    total_bytes_in_use.fetch_sub(int64_t(old_size), std::memory_order_relaxed);
+    return on_alloc(new_ptr);
+}
+
+void free(void* ptr) {
+    on_free(ptr);
+    __libc_free(ptr);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    return on_alloc(__libc_memalign(alignment, size));
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    return on_alloc(__libc_memalign(alignment, size));
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+    if ((alignment % sizeof(void*)) != 0u || (alignment & (alignment-1u)) != 0u) return EINVAL;
+    void* new_ptr = on_alloc(__libc_memalign(alignment, size));
+    if (new_ptr == nullptr) return ENOMEM;
+    *ptr = new_ptr;
+    return 0;
+}
+
+void* valloc(size_t size) {
+    return on_alloc(__libc_memalign(size_t(sysconf(_SC_PAGESIZE)), size));
+}
+
+}
+
+AllocTotals get_alloc_totals() {
+    AllocTotals totals;
+    totals.allocations = total_allocations.load(std::memory_order_relaxed);
+    totals.bytes_allocated = total_bytes_allocated.load(std::memory_order_relaxed);
+    totals.bytes_in_use = total_bytes_in_use.load(std::memory_order_relaxed);
+    return totals;
+}
+
+#else
+
+AllocTotals get_alloc_totals() {
+    return AllocTotals();
+}
+
+#endif
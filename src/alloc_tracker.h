@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+// Heap usage of a benchmark phase for sizing how many decoder instances fit per core
+// On glibc alloc_tracker.cpp replaces malloc and friends so C, C++ and _mm_malloc allocations are all seen
+// Sanitizers bring their own allocator so build with VITERBI_ALLOC_TRACKING=0 to leave malloc alone
+#ifndef VITERBI_ALLOC_TRACKING
+#if defined(__GLIBC__)
+#define VITERBI_ALLOC_TRACKING 1
+#else
+#define VITERBI_ALLOC_TRACKING 0
+#endif
+#endif
+
+// Running totals since startup, sizes are the usable size of each block as reported by the allocator
+struct AllocTotals {
+    uint64_t allocations = 0u;
+    uint64_t bytes_allocated = 0u;
+    int64_t bytes_in_use = 0;
+};
+
+AllocTotals get_alloc_totals();
+
+struct AllocStats {
+    uint64_t allocations = 0u;
+    uint64_t bytes_allocated = 0u;
+    int64_t bytes_in_use = 0;           // net change so a phase that frees more than it allocates is negative
+    int64_t rss_bytes = 0;              // change in resident pages, includes first touches of memory allocated earlier
+    uint64_t peak_rss_bytes = 0u;       // growth of the process high water mark, zero unless the phase sets a new peak
+};
+
+inline bool is_alloc_tracking_available() {
+    return VITERBI_ALLOC_TRACKING != 0;
+}
+
+// Resident set size from /proc without going through stdio since that would allocate
+inline int64_t get_current_rss_bytes() {
+#if defined(__linux__)
+    const int fd = open("/proc/self/statm", O_RDONLY);
+    if (fd == -1) return 0;
+    char buf[128];
+    const ssize_t length = read(fd, buf, sizeof(buf)-1);
+    close(fd);
+    if (length <= 0) return 0;
+    buf[length] = '\0';
+    // { size, resident, shared, ... } in pages
+    char* next = nullptr;
+    strtoull(buf, &next, 10);
+    const uint64_t resident_pages = strtoull(next, nullptr, 10);
+    return int64_t(resident_pages * uint64_t(sysconf(_SC_PAGESIZE)));
+#else
+    return 0;
+#endif
+}
+
+inline uint64_t get_peak_rss_bytes() {
+#if defined(__linux__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0u;
+    return uint64_t(usage.ru_maxrss) * 1024u;
+#else
+    return 0u;
+#endif
+}
+
+// Measures heap usage from construction until get_delta() like Timer does for elapsed time
+class AllocCounter
+{
+private:
+    AllocTotals m_start;
+    int64_t m_start_rss;
+    uint64_t m_start_peak_rss;
+public:
+    AllocCounter() {
+        m_start_peak_rss = get_peak_rss_bytes();
+        m_start_rss = get_current_rss_bytes();
+        m_start = get_alloc_totals();
+    }
+    AllocStats get_delta() {
+        const auto end = get_alloc_totals();
+        AllocStats stats;
+        stats.allocations = end.allocations - m_start.allocations;
+        stats.bytes_allocated = end.bytes_allocated - m_start.bytes_allocated;
+        stats.bytes_in_use = end.bytes_in_use - m_start.bytes_in_use;
+        stats.rss_bytes = get_current_rss_bytes() - m_start_rss;
+        stats.peak_rss_bytes = get_peak_rss_bytes() - m_start_peak_rss;
+        return stats;
+    }
+};
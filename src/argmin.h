@@ -0,0 +1,165 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Find index of the smallest path metric so chainback can start from the most likely state
+// The minimum is found with a vectorised reduction, then the first lane matching it is located
+
+static inline size_t get_lowest_set_bit(const unsigned int x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return size_t(index);
+#else
+    return size_t(__builtin_ctz(x));
+#endif
+}
+
+// Path metrics which use saturating unsigned arithmetic
+static size_t argmin_u8(const uint8_t* x, const size_t N) {
+    size_t i = 0;
+    uint8_t min = 0xFF;
+#if defined(__AVX2__)
+    if (N >= 32) {
+        __m256i v = _mm256_set1_epi8(char(0xFF));
+        for (; (i+32) <= N; i += 32) {
+            v = _mm256_min_epu8(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&x[i])));
+        }
+        __m128i u = _mm_min_epu8(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        u = _mm_min_epu8(u, _mm_srli_si128(u, 8));
+        u = _mm_min_epu8(u, _mm_srli_si128(u, 4));
+        u = _mm_min_epu8(u, _mm_srli_si128(u, 2));
+        u = _mm_min_epu8(u, _mm_srli_si128(u, 1));
+        min = uint8_t(_mm_cvtsi128_si32(u) & 0xFF);
+    }
+#endif
+    if ((i+16) <= N) {
+        __m128i v = _mm_set1_epi8(char(min));
+        for (; (i+16) <= N; i += 16) {
+            v = _mm_min_epu8(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[i])));
+        }
+        v = _mm_min_epu8(v, _mm_srli_si128(v, 8));
+        v = _mm_min_epu8(v, _mm_srli_si128(v, 4));
+        v = _mm_min_epu8(v, _mm_srli_si128(v, 2));
+        v = _mm_min_epu8(v, _mm_srli_si128(v, 1));
+        min = uint8_t(_mm_cvtsi128_si32(v) & 0xFF);
+    }
+    for (; i < N; i++) {
+        if (x[i] < min) min = x[i];
+    }
+
+    const __m128i target = _mm_set1_epi8(char(min));
+    for (i = 0; (i+16) <= N; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[i]));
+        const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, target));
+        if (mask != 0) return i + get_lowest_set_bit(unsigned(mask));
+    }
+    for (; i < N; i++) {
+        if (x[i] == min) return i;
+    }
+    return 0;
+}
+
+// Path metrics which use modular unsigned arithmetic
+// Metrics are only meaningful relative to each other, since the spread is under 128 we compare
+// (x - x[0]) as a signed value and bias it so unsigned minimum can be used
+static size_t argmin_u8_modular(const uint8_t* x, const size_t N) {
+    const __m128i reference = _mm_set1_epi8(char(x[0] ^ 0x80));
+    auto relative = [&reference](const __m128i v) {
+        return _mm_sub_epi8(v, reference);
+    };
+    size_t i = 0;
+    uint8_t min = 0xFF;
+#if defined(__AVX2__)
+    if (N >= 32) {
+        const __m256i reference_256 = _mm256_set1_epi8(char(x[0] ^ 0x80));
+        __m256i v = _mm256_set1_epi8(char(0xFF));
+        for (; (i+32) <= N; i += 32) {
+            const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&x[i]));
+            v = _mm256_min_epu8(v, _mm256_sub_epi8(y, reference_256));
+        }
+        __m128i u = _mm_min_epu8(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        u = _mm_min_epu8(u, _mm_srli_si128(u, 8));
+        u = _mm_min_epu8(u, _mm_srli_si128(u, 4));
+        u = _mm_min_epu8(u, _mm_srli_si128(u, 2));
+        u = _mm_min_epu8(u, _mm_srli_si128(u, 1));
+        min = uint8_t(_mm_cvtsi128_si32(u) & 0xFF);
+    }
+#endif
+    if ((i+16) <= N) {
+        __m128i v = _mm_set1_epi8(char(min));
+        for (; (i+16) <= N; i += 16) {
+            v = _mm_min_epu8(v, relative(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[i]))));
+        }
+        v = _mm_min_epu8(v, _mm_srli_si128(v, 8));
+        v = _mm_min_epu8(v, _mm_srli_si128(v, 4));
+        v = _mm_min_epu8(v, _mm_srli_si128(v, 2));
+        v = _mm_min_epu8(v, _mm_srli_si128(v, 1));
+        min = uint8_t(_mm_cvtsi128_si32(v) & 0xFF);
+    }
+    const uint8_t bias = uint8_t(x[0] ^ 0x80);
+    for (; i < N; i++) {
+        const uint8_t y = uint8_t(x[i] - bias);
+        if (y < min) min = y;
+    }
+
+    const __m128i target = _mm_set1_epi8(char(min));
+    for (i = 0; (i+16) <= N; i += 16) {
+        const __m128i v = relative(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[i])));
+        const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, target));
+        if (mask != 0) return i + get_lowest_set_bit(unsigned(mask));
+    }
+    for (; i < N; i++) {
+        if (uint8_t(x[i] - bias) == min) return i;
+    }
+    return 0;
+}
+
+// Path metrics which use saturating signed arithmetic
+static size_t argmin_i16(const int16_t* x, const size_t N) {
+    size_t i = 0;
+    int16_t min = INT16_MAX;
+#if defined(__AVX2__)
+    if (N >= 16) {
+        __m256i v = _mm256_set1_epi16(INT16_MAX);
+        for (; (i+16) <= N; i += 16) {
+            v = _mm256_min_epi16(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&x[i])));
+        }
+        __m128i u = _mm_min_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        u = _mm_min_epi16(u, _mm_srli_si128(u, 8));
+        u = _mm_min_epi16(u, _mm_srli_si128(u, 4));
+        u = _mm_min_epi16(u, _mm_srli_si128(u, 2));
+        min = int16_t(_mm_extract_epi16(u, 0));
+    }
+#endif
+    const size_t total_vectorised = N - (N % 8);
+    if (i < total_vectorised) {
+        __m128i v = _mm_set1_epi16(min);
+        for (; i < total_vectorised; i += 8) {
+            v = _mm_min_epi16(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[i])));
+        }
+        v = _mm_min_epi16(v, _mm_srli_si128(v, 8));
+        v = _mm_min_epi16(v, _mm_srli_si128(v, 4));
+        v = _mm_min_epi16(v, _mm_srli_si128(v, 2));
+        min = int16_t(_mm_extract_epi16(v, 0));
+    }
+    for (; i < N; i++) {
+        if (x[i] < min) min = x[i];
+    }
+
+    const __m128i target = _mm_set1_epi16(min);
+    for (i = 0; i < total_vectorised; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[i]));
+        const int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(v, target));
+        if (mask != 0) return i + get_lowest_set_bit(unsigned(mask))/2;
+    }
+    for (; i < N; i++) {
+        if (x[i] == min) return i;
+    }
+    return 0;
+}
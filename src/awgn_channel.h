@@ -0,0 +1,241 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+// Additive white gaussian noise for BPSK symbols with unit energy
+// Uniforms come from 8 interleaved xoshiro128++ generators so every vector lane has its own stream
+// and are turned into normals with the Box-Muller transform using polynomial log, sin and cos so every step vectorises
+// The angle is drawn from a quarter turn and two spare bits of the first uniform pick the quadrant
+// Uniforms have 24bits so normals are limited to about 5.8 sigma which is well below any error rate we simulate
+class AWGN_Channel
+{
+public:
+    static constexpr size_t TOTAL_LANES = 8;
+    static constexpr size_t BLOCK_SIZE = 2*TOTAL_LANES;     // normals from one step of every lane
+private:
+    alignas(32) uint32_t m_state[4][TOTAL_LANES];
+public:
+    explicit AWGN_Channel(const uint64_t seed = 0u) { set_seed(seed); }
+
+    // Channels with different seeds give independent streams, e.g. one per thread
+    void set_seed(uint64_t seed) {
+        // splitmix64 so that similar seeds still give unrelated states and the state is never all zeros
+        auto next = [&seed]() {
+            seed += 0x9E3779B97F4A7C15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        };
+        for (size_t i = 0; i < TOTAL_LANES; i++) {
+            const uint64_t a = next();
+            const uint64_t b = next();
+            m_state[0][i] = uint32_t(a);
+            m_state[1][i] = uint32_t(a >> 32);
+            m_state[2][i] = uint32_t(b);
+            m_state[3][i] = uint32_t(b >> 32);
+        }
+    }
+
+    // Es = 1 and Eb = R*Es since each bit is spread over R symbols
+    static float get_sigma(const float ebno_db, const size_t code_rate) {
+        const float ebno = powf(10.0f, ebno_db/10.0f);
+        return sqrtf(float(code_rate) / (2.0f*ebno));
+    }
+
+    // Standard normal samples
+    void generate(float* x, const size_t N) {
+        size_t i = 0;
+        for (; (i+BLOCK_SIZE) <= N; i += BLOCK_SIZE) {
+            generate_block(&x[i]);
+        }
+        if (i == N) return;
+        alignas(32) float block[BLOCK_SIZE];
+        generate_block(block);
+        for (size_t j = 0; j < (N-i); j++) {
+            x[i+j] = block[j];
+        }
+    }
+
+    // symbols[i] += sigma*normal
+    void add_noise(float* symbols, const size_t N, const float sigma) {
+        alignas(32) float block[BLOCK_SIZE];
+        size_t i = 0;
+        for (; (i+BLOCK_SIZE) <= N; i += BLOCK_SIZE) {
+            generate_block(block);
+#if defined(__AVX2__)
+            const __m256 v_sigma = _mm256_set1_ps(sigma);
+            for (size_t j = 0; j < BLOCK_SIZE; j += 8u) {
+                const __m256 noise = _mm256_mul_ps(_mm256_load_ps(&block[j]), v_sigma);
+                _mm256_storeu_ps(&symbols[i+j], _mm256_add_ps(_mm256_loadu_ps(&symbols[i+j]), noise));
+            }
+#else
+            const __m128 v_sigma = _mm_set1_ps(sigma);
+            for (size_t j = 0; j < BLOCK_SIZE; j += 4u) {
+                const __m128 noise = _mm_mul_ps(_mm_load_ps(&block[j]), v_sigma);
+                _mm_storeu_ps(&symbols[i+j], _mm_add_ps(_mm_loadu_ps(&symbols[i+j]), noise));
+            }
+#endif
+        }
+        if (i == N) return;
+        generate_block(block);
+        for (size_t j = 0; j < (N-i); j++) {
+            symbols[i+j] += sigma*block[j];
+        }
+    }
+private:
+    // Lane i writes its pair of normals to x[i] and x[i+TOTAL_LANES]
+    void generate_block(float* x) {
+#if defined(__AVX2__)
+        generate_lanes<Vector256>(x, 0);
+#else
+        generate_lanes<Vector128>(x, 0);
+        generate_lanes<Vector128>(x, 4);
+#endif
+    }
+
+    struct Vector128 {
+        using i_t = __m128i;
+        using f_t = __m128;
+        static i_t load(const uint32_t* x) { return _mm_load_si128(reinterpret_cast<const __m128i*>(x)); }
+        static void store(uint32_t* x, i_t a) { _mm_store_si128(reinterpret_cast<__m128i*>(x), a); }
+        static void store(float* x, f_t a) { _mm_storeu_ps(x, a); }
+        static i_t set1(uint32_t x) { return _mm_set1_epi32(int(x)); }
+        static f_t set1(float x) { return _mm_set1_ps(x); }
+        static i_t add(i_t a, i_t b) { return _mm_add_epi32(a, b); }
+        static i_t sub(i_t a, i_t b) { return _mm_sub_epi32(a, b); }
+        static i_t bit_and(i_t a, i_t b) { return _mm_and_si128(a, b); }
+        static i_t bit_or(i_t a, i_t b) { return _mm_or_si128(a, b); }
+        static i_t bit_xor(i_t a, i_t b) { return _mm_xor_si128(a, b); }
+        template <int N> static i_t shl(i_t a) { return _mm_slli_epi32(a, N); }
+        template <int N> static i_t shr(i_t a) { return _mm_srli_epi32(a, N); }
+        template <int N> static i_t rotl(i_t a) { return bit_or(shl<N>(a), shr<32-N>(a)); }
+        static i_t cmplt(f_t a, f_t b) { return _mm_castps_si128(_mm_cmplt_ps(a, b)); }
+        static f_t to_float(i_t a) { return _mm_cvtepi32_ps(a); }
+        static f_t as_float(i_t a) { return _mm_castsi128_ps(a); }
+        static i_t as_int(f_t a) { return _mm_castps_si128(a); }
+        static f_t add(f_t a, f_t b) { return _mm_add_ps(a, b); }
+        static f_t sub(f_t a, f_t b) { return _mm_sub_ps(a, b); }
+        static f_t mul(f_t a, f_t b) { return _mm_mul_ps(a, b); }
+        static f_t sqrt(f_t a) { return _mm_sqrt_ps(a); }
+        static f_t bit_and(f_t a, i_t b) { return _mm_and_ps(a, as_float(b)); }
+    };
+
+#if defined(__AVX2__)
+    struct Vector256 {
+        using i_t = __m256i;
+        using f_t = __m256;
+        static i_t load(const uint32_t* x) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(x)); }
+        static void store(uint32_t* x, i_t a) { _mm256_store_si256(reinterpret_cast<__m256i*>(x), a); }
+        static void store(float* x, f_t a) { _mm256_storeu_ps(x, a); }
+        static i_t set1(uint32_t x) { return _mm256_set1_epi32(int(x)); }
+        static f_t set1(float x) { return _mm256_set1_ps(x); }
+        static i_t add(i_t a, i_t b) { return _mm256_add_epi32(a, b); }
+        static i_t sub(i_t a, i_t b) { return _mm256_sub_epi32(a, b); }
+        static i_t bit_and(i_t a, i_t b) { return _mm256_and_si256(a, b); }
+        static i_t bit_or(i_t a, i_t b) { return _mm256_or_si256(a, b); }
+        static i_t bit_xor(i_t a, i_t b) { return _mm256_xor_si256(a, b); }
+        template <int N> static i_t shl(i_t a) { return _mm256_slli_epi32(a, N); }
+        template <int N> static i_t shr(i_t a) { return _mm256_srli_epi32(a, N); }
+        template <int N> static i_t rotl(i_t a) { return bit_or(shl<N>(a), shr<32-N>(a)); }
+        static i_t cmplt(f_t a, f_t b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+        static f_t to_float(i_t a) { return _mm256_cvtepi32_ps(a); }
+        static f_t as_float(i_t a) { return _mm256_castsi256_ps(a); }
+        static i_t as_int(f_t a) { return _mm256_castps_si256(a); }
+        static f_t add(f_t a, f_t b) { return _mm256_add_ps(a, b); }
+        static f_t sub(f_t a, f_t b) { return _mm256_sub_ps(a, b); }
+        static f_t mul(f_t a, f_t b) { return _mm256_mul_ps(a, b); }
+        static f_t sqrt(f_t a) { return _mm256_sqrt_ps(a); }
+        static f_t bit_and(f_t a, i_t b) { return _mm256_and_ps(a, as_float(b)); }
+    };
+#endif
+
+    // xoshiro128++ on the lanes starting at offset
+    template <class V>
+    typename V::i_t next_uniform(const size_t offset) {
+        using i_t = typename V::i_t;
+        i_t s0 = V::load(&m_state[0][offset]);
+        i_t s1 = V::load(&m_state[1][offset]);
+        i_t s2 = V::load(&m_state[2][offset]);
+        i_t s3 = V::load(&m_state[3][offset]);
+        const i_t result = V::add(V::template rotl<7>(V::add(s0, s3)), s0);
+        const i_t t = V::template shl<9>(s1);
+        s2 = V::bit_xor(s2, s0);
+        s3 = V::bit_xor(s3, s1);
+        s1 = V::bit_xor(s1, s2);
+        s0 = V::bit_xor(s0, s3);
+        s2 = V::bit_xor(s2, t);
+        s3 = V::template rotl<11>(s3);
+        V::store(&m_state[0][offset], s0);
+        V::store(&m_state[1][offset], s1);
+        V::store(&m_state[2][offset], s2);
+        V::store(&m_state[3][offset], s3);
+        return result;
+    }
+
+    // Natural log of x in (0,1] using the cephes logf reduction and polynomial
+    template <class V>
+    static typename V::f_t log(const typename V::f_t x) {
+        using i_t = typename V::i_t;
+        using f_t = typename V::f_t;
+        const i_t bits = V::as_int(x);
+        // x = m*2^e with m in [0.5,1)
+        i_t e = V::sub(V::template shr<23>(bits), V::set1(uint32_t(126)));
+        f_t m = V::as_float(V::bit_or(V::bit_and(bits, V::set1(uint32_t(0x007FFFFF))), V::set1(uint32_t(0x3F000000))));
+        // move m into [sqrt(0.5),sqrt(2)) and take 1 from it
+        const i_t is_small = V::cmplt(m, V::set1(0.707106781186547524f));
+        e = V::add(e, is_small);    // true lanes are -1
+        m = V::sub(V::add(m, V::bit_and(m, is_small)), V::set1(1.0f));
+        const f_t fe = V::to_float(e);
+        const f_t z = V::mul(m, m);
+        f_t y = V::set1(7.0376836292e-2f);
+        y = V::add(V::mul(y, m), V::set1(-1.1514610310e-1f));
+        y = V::add(V::mul(y, m), V::set1(+1.1676998740e-1f));
+        y = V::add(V::mul(y, m), V::set1(-1.2420140846e-1f));
+        y = V::add(V::mul(y, m), V::set1(+1.4249322787e-1f));
+        y = V::add(V::mul(y, m), V::set1(-1.6668057665e-1f));
+        y = V::add(V::mul(y, m), V::set1(+2.0000714765e-1f));
+        y = V::add(V::mul(y, m), V::set1(-2.4999993993e-1f));
+        y = V::add(V::mul(y, m), V::set1(+3.3333331174e-1f));
+        y = V::mul(V::mul(y, m), z);
+        y = V::add(y, V::mul(fe, V::set1(-2.12194440e-4f)));
+        y = V::sub(y, V::mul(z, V::set1(0.5f)));
+        return V::add(V::add(m, y), V::mul(fe, V::set1(0.693359375f)));
+    }
+
+    template <class V>
+    void generate_lanes(float* x, const size_t offset) {
+        using i_t = typename V::i_t;
+        using f_t = typename V::f_t;
+        const i_t r0 = next_uniform<V>(offset);
+        const i_t r1 = next_uniform<V>(offset);
+        // u0 in (0,1] so the log is always finite, u1 in [0,1)
+        const f_t scale = V::set1(1.0f/16777216.0f);
+        const f_t u0 = V::mul(V::to_float(V::add(V::template shr<8>(r0), V::set1(uint32_t(1)))), scale);
+        const f_t u1 = V::mul(V::to_float(V::template shr<8>(r1)), scale);
+        // radius is scaled by 1/sqrt(2) which the rotation below needs
+        const f_t radius = V::sqrt(V::mul(log<V>(u0), V::set1(-1.0f)));
+        // angle in [0,pi/2) is taken as a+pi/4 so the polynomials only cover [-pi/4,pi/4)
+        // cos(a+pi/4) = (cos(a)-sin(a))/sqrt(2), sin(a+pi/4) = (cos(a)+sin(a))/sqrt(2)
+        const f_t a = V::mul(V::sub(u1, V::set1(0.5f)), V::set1(1.57079632679489662f));
+        const f_t z = V::mul(a, a);
+        f_t sin_a = V::set1(-1.9515295891e-4f);
+        sin_a = V::add(V::mul(sin_a, z), V::set1(+8.3321608736e-3f));
+        sin_a = V::add(V::mul(sin_a, z), V::set1(-1.6666654611e-1f));
+        sin_a = V::add(V::mul(V::mul(sin_a, z), a), a);
+        f_t cos_a = V::set1(2.443315711809948e-5f);
+        cos_a = V::add(V::mul(cos_a, z), V::set1(-1.388731625493765e-3f));
+        cos_a = V::add(V::mul(cos_a, z), V::set1(+4.166664568298827e-2f));
+        cos_a = V::add(V::sub(V::mul(V::mul(cos_a, z), z), V::mul(z, V::set1(0.5f))), V::set1(1.0f));
+        // the low bits of r0 are unused by u0 so they flip the sign of each normal to pick the quadrant
+        const i_t sign_0 = V::template shl<31>(r0);
+        const i_t sign_1 = V::bit_and(V::template shl<30>(r0), V::set1(uint32_t(0x80000000)));
+        const f_t n0 = V::mul(radius, V::sub(cos_a, sin_a));
+        const f_t n1 = V::mul(radius, V::add(cos_a, sin_a));
+        V::store(&x[offset], V::as_float(V::bit_xor(V::as_int(n0), sign_0)));
+        V::store(&x[offset+TOTAL_LANES], V::as_float(V::bit_xor(V::as_int(n1), sign_1)));
+    }
+};
@@ -0,0 +1,143 @@
+#include "./ber_sweep.h"
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include "./awgn_channel.h"
+#include "./convolutional_encoder_clmul.h"
+#include "./llr_quantiser.h"
+#include "./timer.h"
+#include "./util.h"
+#include "viterbi/convolutional_encoder_shift_register.h"
+
+// Counters shared by every thread working on a point
+struct SweepCounters {
+    std::atomic<size_t> frames_started{0};
+    std::atomic<size_t> total_frames{0};
+    std::atomic<size_t> total_frame_errors{0};
+    std::atomic<uint64_t> total_bit_errors{0};
+    std::atomic<uint64_t> decode_ns{0};
+};
+
+static bool is_point_finished(const SweepCounters& counters, const BerSweepConfig& config) {
+    if ((config.target_bit_errors > 0) && (counters.total_bit_errors.load() >= config.target_bit_errors)) return true;
+    if ((config.target_frame_errors > 0) && (counters.total_frame_errors.load() >= config.target_frame_errors)) return true;
+    return false;
+}
+
+// Frames encoded to BPSK symbols with +1 for a 1 and -1 for a 0
+class SweepEncoder
+{
+private:
+    std::unique_ptr<ConvolutionalEncoder_CLMUL> m_clmul;
+    std::unique_ptr<ConvolutionalEncoder_ShiftRegister<uint32_t>> m_shift_register;
+public:
+    SweepEncoder(const size_t K, const size_t R, const int* poly) {
+        if (is_clmul_encoder_supported()) {
+            m_clmul = std::make_unique<ConvolutionalEncoder_CLMUL>(K, R, poly);
+        } else {
+            m_shift_register = std::make_unique<ConvolutionalEncoder_ShiftRegister<uint32_t>>(K, R, poly);
+        }
+    }
+    void encode(const uint8_t* x, const size_t total_bytes, float* y, const size_t total_symbols) {
+        if (m_clmul) {
+            m_clmul->encode<float>(x, total_bytes, y, total_symbols, +1.0f, -1.0f);
+        } else {
+            m_shift_register->reset(0);
+            encode_data<float>(m_shift_register.get(), x, total_bytes, y, total_symbols, +1.0f, -1.0f);
+        }
+    }
+};
+
+static void run_sweep_thread(
+    const DecoderEntry& entry, DynamicDecoder& decoder, const int* poly, const float ebno_db,
+    const BerSweepConfig& config, const uint64_t seed, SweepCounters& counters)
+{
+    const size_t K = entry.K;
+    const size_t R = entry.R;
+    const size_t total_input_bits = config.total_input_bytes*8u;
+    const size_t total_transmit_bits = total_input_bits + K-1u;
+    const size_t total_symbols = total_transmit_bits*R;
+    auto x_in = std::vector<uint8_t>(config.total_input_bytes);
+    auto x_out = std::vector<uint8_t>(config.total_input_bytes);
+    auto y_bpsk = std::vector<float>(total_symbols);
+    auto y_int8 = std::vector<int8_t>(total_symbols);
+    auto encoder = SweepEncoder(K, R, poly);
+    // Registry decoders take full scale signed symbols
+    LLR_Quantiser quantiser;
+    quantiser.scale = 127.0f;
+    quantiser.limit = 127.0f;
+    auto channel = AWGN_Channel(seed);
+    auto data_rng = std::mt19937_64(seed);
+    const float sigma = AWGN_Channel::get_sigma(ebno_db, R);
+
+    while (!is_point_finished(counters, config)) {
+        if (counters.frames_started.fetch_add(1) >= config.max_frames) break;
+        for (size_t i = 0; i < x_in.size(); i += 8u) {
+            const uint64_t x = data_rng();
+            const size_t total_copy = ((i+8u) <= x_in.size()) ? 8u : (x_in.size()-i);
+            memcpy(&x_in[i], &x, total_copy);
+        }
+        encoder.encode(x_in.data(), x_in.size(), y_bpsk.data(), y_bpsk.size());
+        channel.add_noise(y_bpsk.data(), y_bpsk.size(), sigma);
+        quantise_llr(y_bpsk.data(), y_int8.data(), y_int8.size(), quantiser);
+        // Some chainbacks only set bits so clear the output like the benchmark does
+        memset(x_out.data(), 0, x_out.size());
+        Timer t;
+        decoder.reset();
+        decoder.update(y_int8.data(), y_int8.size());
+        decoder.chainback(x_out.data(), total_input_bits, 0u);
+        counters.decode_ns += t.get_delta();
+        const size_t bit_errors = get_total_bit_errors(x_in.data(), x_out.data(), x_in.size());
+        counters.total_bit_errors += bit_errors;
+        if (bit_errors > 0) counters.total_frame_errors++;
+        counters.total_frames++;
+    }
+}
+
+size_t get_ber_sweep_threads(const BerSweepConfig& config) {
+    if (config.total_threads > 0) return config.total_threads;
+    const size_t total_threads = size_t(std::thread::hardware_concurrency());
+    return (total_threads > 0) ? total_threads : 1u;
+}
+
+std::vector<BerSweepPoint> run_ber_sweep(
+    const DecoderEntry& decoder, const int* poly,
+    const std::vector<float>& ebno_db, const BerSweepConfig& config)
+{
+    const size_t total_threads = get_ber_sweep_threads(config);
+    // Decoders are created up front on this thread so creation never runs concurrently
+    // and each thread reuses its decoder for every point
+    const size_t total_transmit_bits = config.total_input_bytes*8u + decoder.K-1u;
+    std::vector<std::unique_ptr<DynamicDecoder>> thread_decoders;
+    for (size_t i = 0; i < total_threads; i++) {
+        thread_decoders.push_back(decoder.create(poly, total_transmit_bits));
+    }
+    std::vector<BerSweepPoint> points;
+    for (size_t point_index = 0; point_index < ebno_db.size(); point_index++) {
+        SweepCounters counters;
+        Timer elapsed;
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < total_threads; i++) {
+            // Seeds are hashed by the generators so neighbouring values still give unrelated streams
+            const uint64_t seed = config.seed + uint64_t(point_index)*uint64_t(total_threads) + uint64_t(i);
+            threads.emplace_back(
+                run_sweep_thread,
+                std::cref(decoder), std::ref(*thread_decoders[i]), poly, ebno_db[point_index],
+                std::cref(config), seed, std::ref(counters)
+            );
+        }
+        for (auto& thread: threads) thread.join();
+        BerSweepPoint point;
+        point.ebno_db = ebno_db[point_index];
+        point.elapsed_ns = elapsed.get_delta();
+        point.total_frames = counters.total_frames.load();
+        point.total_frame_errors = counters.total_frame_errors.load();
+        point.total_bits = uint64_t(point.total_frames)*uint64_t(config.total_input_bytes*8u);
+        point.total_bit_errors = counters.total_bit_errors.load();
+        point.decode_ns = counters.decode_ns.load();
+        points.push_back(point);
+    }
+    return points;
+}
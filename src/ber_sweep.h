@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "./decoder_registry.h"
+
+// Monte Carlo bit and frame error rates of a registered decoder over a range of Eb/N0
+// Each thread has its own decoder, encoder and random streams and runs random frames through
+// encode -> BPSK AWGN channel -> quantise -> decode so the only shared state is the error counters
+// A point stops early once enough errors have been counted for a stable estimate
+
+struct BerSweepConfig {
+    size_t total_input_bytes = 1024;
+    size_t target_bit_errors = 1000;    // stop a point after this many bit errors, 0 to disable
+    size_t target_frame_errors = 100;   // or after this many frame errors, 0 to disable
+    size_t max_frames = 10000;          // or after this many frames
+    size_t total_threads = 0;           // 0 uses every hardware thread
+    uint64_t seed = 0;
+};
+
+struct BerSweepPoint {
+    float ebno_db = 0.0f;
+    size_t total_frames = 0;
+    size_t total_frame_errors = 0;
+    uint64_t total_bits = 0;
+    uint64_t total_bit_errors = 0;
+    uint64_t decode_ns = 0;             // summed over every thread
+    uint64_t elapsed_ns = 0;            // wall clock time of the whole point
+
+    double get_bit_error_rate() const { return (total_bits > 0) ? double(total_bit_errors)/double(total_bits) : 0.0; }
+    double get_frame_error_rate() const { return (total_frames > 0) ? double(total_frame_errors)/double(total_frames) : 0.0; }
+    // Decoded bits per second of all threads including the encoder and channel
+    double get_total_mbps() const { return (elapsed_ns > 0) ? double(total_bits)/double(elapsed_ns)*1e3 : 0.0; }
+    // Decoded bits per second of the decoder alone on a single thread
+    double get_decode_mbps() const { return (decode_ns > 0) ? double(total_bits)/double(decode_ns)*1e3 : 0.0; }
+};
+
+size_t get_ber_sweep_threads(const BerSweepConfig& config);
+
+// Frames are terminated so decoders are traced back from the zero state
+// Points are returned in the same order as ebno_db
+std::vector<BerSweepPoint> run_ber_sweep(
+    const DecoderEntry& decoder, const int* poly,
+    const std::vector<float>& ebno_db, const BerSweepConfig& config);
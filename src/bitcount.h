@@ -1,52 +1,40 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
+#include <type_traits>
 
-// Return number of 1s bits
-class BitcountTable 
-{
-private:
-    uint8_t* table;
-    BitcountTable() {
-        constexpr size_t N = 256;
-        table = new uint8_t[N];
-        for (size_t i = 0u; i < 256u; i++) {
-            uint8_t x = (uint8_t)i;
-            uint8_t count = 0;
-            for (int j = 0u; j < 8; j++) {
-                count += (x & 0b1);
-                x = x >> 1;
-            }
-            table[i] = count;
+struct BitcountLUT {
+    uint8_t values[256];
+};
+
+constexpr BitcountLUT make_bitcount_lut() {
+    BitcountLUT lut{};
+    for (size_t i = 0u; i < 256u; i++) {
+        uint8_t x = (uint8_t)i;
+        uint8_t count = 0;
+        for (int j = 0u; j < 8; j++) {
+            count += (x & 0b1);
+            x = x >> 1;
         }
+        lut.values[i] = count;
     }
-    ~BitcountTable() {
-        delete [] table;
-    }
-    BitcountTable(const BitcountTable&) = delete;
-    BitcountTable(BitcountTable&&) = delete;
-    BitcountTable& operator=(const BitcountTable&) = delete;
-    BitcountTable& operator=(BitcountTable&&) = delete;
-public:
-    static 
-    BitcountTable& get() {
-        static auto bitcount_table = BitcountTable();
-        return bitcount_table;
-    }
+    return lut;
+}
 
-    uint8_t parse(uint8_t x) {
-        return table[x];
-    }
+// Generated at compile time so it lives in .rodata instead of being allocated on first use
+inline constexpr BitcountLUT BITCOUNT_LUT = make_bitcount_lut();
 
-    template <typename T>
-    uint8_t parse(const T x) {
-        static_assert(std::is_trivially_copyable<T>::value, "Not a copyable type" );
-        constexpr size_t N = sizeof(x);
-        auto* arr = reinterpret_cast<const uint8_t*>(&x);
-        uint8_t count = 0u;
-        for (size_t i = 0u; i < N; i++) {
-            count += table[arr[i]];
-        }
-        return count;
+// Return number of 1s bits
+template <typename T>
+constexpr uint8_t get_bitcount(const T x) {
+    static_assert(std::is_integral<T>::value, "Bitcount is only defined for integers");
+    using U = typename std::make_unsigned<T>::type;
+    U y = static_cast<U>(x);
+    uint8_t count = 0u;
+    for (size_t i = 0u; i < sizeof(U); i++) {
+        count += BITCOUNT_LUT.values[uint8_t(y & U(0xFF))];
+        y = U(y >> 8u);
     }
-};
+    return count;
+}
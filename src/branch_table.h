@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <immintrin.h>
+#include "./parity.h"
+
+// Branch tables for the ported ka9q and spiral kernels
+// Entry [i*NUMSTATES/2 + state] is high when poly[i] outputs a 1 going from (2*state) and low otherwise
+// A negative polynomial inverts its output like spiral does
+template <typename T, size_t K, size_t R>
+constexpr void fill_branch_table(T* values, const int* poly, const T high, const T low) {
+    constexpr size_t TOTAL_BUTTERFLIES = size_t(1) << (K-2u);
+    for (size_t i = 0u; i < R; i++) {
+        const bool is_inverted = poly[i] < 0;
+        const uint32_t code = uint32_t(is_inverted ? -poly[i] : poly[i]);
+        for (size_t state = 0u; state < TOTAL_BUTTERFLIES; state++) {
+            const bool is_high = is_inverted ^ (get_parity(uint32_t(2u*state) & code) != 0u);
+            values[i*TOTAL_BUTTERFLIES + state] = is_high ? high : low;
+        }
+    }
+}
+
+template <typename T, size_t K, size_t R>
+struct BranchTable {
+    static constexpr size_t TOTAL_VALUES = R*(size_t(1) << (K-2u));
+    int poly[R];
+    alignas(32) T values[TOTAL_VALUES];
+
+    constexpr bool is_poly(const int* other) const {
+        for (size_t i = 0u; i < R; i++) {
+            if (poly[i] != other[i]) return false;
+        }
+        return true;
+    }
+};
+
+template <typename T, size_t K, size_t R>
+constexpr BranchTable<T,K,R> make_branch_table(const int (&poly)[R], const T high, const T low) {
+    BranchTable<T,K,R> table{};
+    for (size_t i = 0u; i < R; i++) {
+        table.poly[i] = poly[i];
+    }
+    fill_branch_table<T,K,R>(table.values, poly, high, low);
+    return table;
+}
+
+// Tables for fixed codes are evaluated at compile time and stored in .rodata
+// This skips rebuilding them on create and page faulting a freshly written table on the first update
+// Being a variable template each table is only generated by the decoders that use it
+template <typename T, size_t K, T HIGH, T LOW, int... POLY>
+inline constexpr BranchTable<T, K, sizeof...(POLY)> CONSTEXPR_BRANCH_TABLE = make_branch_table<T, K, sizeof...(POLY)>({ POLY... }, HIGH, LOW);
+
+// Tables for other codes are owned by the decoder instance that was created with them
+// Each decoder reads its own table so instances with different codes can run side by side
+// Static so the instruction set specific kernels don't share a copy through the linker
+template <typename T, size_t K, size_t R>
+static inline BranchTable<T,K,R>* create_branch_table(const int* poly, const T high, const T low) {
+    auto* table = static_cast<BranchTable<T,K,R>*>(_mm_malloc(sizeof(BranchTable<T,K,R>), alignof(BranchTable<T,K,R>)));
+    for (size_t i = 0u; i < R; i++) {
+        table->poly[i] = poly[i];
+    }
+    fill_branch_table<T,K,R>(table->values, poly, high, low);
+    return table;
+}
+
+template <typename T, size_t K, size_t R>
+static inline void delete_branch_table(BranchTable<T,K,R>* table) {
+    if (table != nullptr) _mm_free(table);
+}
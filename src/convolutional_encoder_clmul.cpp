@@ -0,0 +1,183 @@
+// Compiled with pclmul and SSE4.1 so nothing here may run before the cpu is checked
+#include "./convolutional_encoder_clmul.h"
+#include <assert.h>
+#include <string.h>
+#include <immintrin.h>
+#include <stdexcept>
+
+ConvolutionalEncoder_CLMUL::ConvolutionalEncoder_CLMUL(const size_t K_, const size_t R_, const int* poly)
+: K(K_), R(R_)
+{
+    // The carry between chunks has to fit in the upper half of the product
+    // and a byte of each stream has to spread into a 64bit word
+    if ((K < 2u) || (K > 64u)) throw std::invalid_argument("Constraint length must be between 2 and 64");
+    if ((R < 1u) || (R > 8u)) throw std::invalid_argument("Code rate must be between 1 and 8");
+    const uint64_t mask = (K == 64u) ? ~uint64_t(0) : ((uint64_t(1) << K) - 1u);
+    for (size_t i = 0; i < R; i++) {
+        m_poly[i] = uint64_t(uint32_t(poly[i])) & mask;
+    }
+    for (size_t x = 0; x < 256; x++) {
+        uint64_t y = 0u;
+        for (size_t i = 0; i < 8; i++) {
+            y |= uint64_t((x >> i) & 0b1) << (i*R);
+        }
+        m_spread_lut[x] = y;
+    }
+}
+
+ConvolutionalEncoder_CLMUL::~ConvolutionalEncoder_CLMUL() {
+    delete [] m_words;
+    delete [] m_packed;
+}
+
+// Input bytes are consumed MSB first so reverse the bits of each byte with a nibble lookup
+static void load_input_bits(const uint8_t* input_bytes, const size_t total_input_bytes, uint64_t* words, const size_t total_words) {
+    memset(words, 0, total_words*sizeof(uint64_t));
+    memcpy(words, input_bytes, total_input_bytes);
+    const __m128i reverse_lut = _mm_setr_epi8(0x0,0x8,0x4,0xC,0x2,0xA,0x6,0xE,0x1,0x9,0x5,0xD,0x3,0xB,0x7,0xF);
+    const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(words);
+    const size_t total_bytes = total_words*sizeof(uint64_t);
+    size_t i = 0;
+    for (; (i+16u) <= total_bytes; i += 16u) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&bytes[i]));
+        const __m128i lo = _mm_shuffle_epi8(reverse_lut, _mm_and_si128(x, nibble_mask));
+        const __m128i hi = _mm_shuffle_epi8(reverse_lut, _mm_and_si128(_mm_srli_epi16(x, 4), nibble_mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&bytes[i]), _mm_or_si128(_mm_slli_epi16(lo, 4), hi));
+    }
+    for (; i < total_bytes; i++) {
+        uint8_t x = bytes[i];
+        uint8_t y = 0u;
+        for (size_t j = 0; j < 8; j++) y |= uint8_t(((x >> j) & 0b1) << (7u-j));
+        bytes[i] = y;
+    }
+}
+
+size_t ConvolutionalEncoder_CLMUL::encode_hard_packed(const uint8_t* input_bytes, const size_t total_input_bytes, uint8_t* output_bytes, const size_t max_output_bytes) {
+    const size_t total_bits = total_input_bytes*8u + K-1u;
+    const size_t total_symbols = total_bits*R;
+    const size_t total_output_bytes = (total_symbols+7u)/8u;
+    assert(total_output_bytes <= max_output_bytes);
+    (void)max_output_bytes;
+    const size_t total_words = (total_bits+63u)/64u;
+    if (m_total_words < total_words*(R+1u)) {
+        m_total_words = total_words*(R+1u);
+        delete [] m_words;
+        m_words = new uint64_t[m_total_words];
+    }
+    uint64_t* input = m_words;
+    uint64_t* streams = &m_words[total_words];
+    load_input_bits(input_bytes, total_input_bytes, input, total_words);
+
+    // Product of the input with each polynomial, the tail bits are zero so the last carry lands inside the frame
+    for (size_t r = 0; r < R; r++) {
+        const __m128i poly = _mm_set_epi64x(0, int64_t(m_poly[r]));
+        uint64_t* stream = &streams[r*total_words];
+        uint64_t carry = 0u;
+        for (size_t i = 0; i < total_words; i++) {
+            const __m128i x = _mm_set_epi64x(0, int64_t(input[i]));
+            const __m128i product = _mm_clmulepi64_si128(x, poly, 0x00);
+            stream[i] = uint64_t(_mm_cvtsi128_si64(product)) ^ carry;
+            carry = uint64_t(_mm_extract_epi64(product, 1));
+        }
+    }
+
+    // Every 8 input bits become exactly R bytes of symbols
+    const size_t total_steps = (total_bits+7u)/8u;
+    for (size_t step = 0; step < total_steps; step++) {
+        const size_t word = step / 8u;
+        const size_t shift = (step % 8u)*8u;
+        uint64_t symbols = 0u;
+        for (size_t r = 0; r < R; r++) {
+            const uint8_t x = uint8_t(streams[r*total_words + word] >> shift);
+            symbols |= m_spread_lut[x] << r;
+        }
+        const size_t offset = step*R;
+        const size_t total_copy = ((offset+R) <= total_output_bytes) ? R : (total_output_bytes-offset);
+        memcpy(&output_bytes[offset], &symbols, total_copy);
+    }
+    return total_symbols;
+}
+
+// Expand 16 packed symbols into a byte mask per symbol
+static inline __m128i expand_bits_to_mask(const uint16_t bits) {
+    const __m128i spread = _mm_setr_epi8(0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1);
+    const __m128i select = _mm_setr_epi8(1,2,4,8,16,32,64,-128,1,2,4,8,16,32,64,-128);
+    const __m128i x = _mm_shuffle_epi8(_mm_cvtsi32_si128(int(bits)), spread);
+    return _mm_cmpeq_epi8(_mm_and_si128(x, select), select);
+}
+
+static inline __m128i select_si128(const __m128i mask, const __m128i if_true, const __m128i if_false) {
+    return _mm_blendv_epi8(if_false, if_true, mask);
+}
+
+template <typename T>
+static void expand_symbols(const uint8_t* packed, const size_t total_symbols, T* output, const T high, const T low) {
+    static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4, "Symbols must be 8, 16 or 32bits");
+    __m128i v_high, v_low;
+    if constexpr (sizeof(T) == 1) {
+        uint8_t h, l;
+        memcpy(&h, &high, 1); memcpy(&l, &low, 1);
+        v_high = _mm_set1_epi8(char(h));
+        v_low = _mm_set1_epi8(char(l));
+    } else if constexpr (sizeof(T) == 2) {
+        uint16_t h, l;
+        memcpy(&h, &high, 2); memcpy(&l, &low, 2);
+        v_high = _mm_set1_epi16(short(h));
+        v_low = _mm_set1_epi16(short(l));
+    } else {
+        uint32_t h, l;
+        memcpy(&h, &high, 4); memcpy(&l, &low, 4);
+        v_high = _mm_set1_epi32(int(h));
+        v_low = _mm_set1_epi32(int(l));
+    }
+    size_t i = 0;
+    for (; (i+16u) <= total_symbols; i += 16u) {
+        uint16_t bits;
+        memcpy(&bits, &packed[i/8u], sizeof(bits));
+        const __m128i mask = expand_bits_to_mask(bits);
+        __m128i* dst = reinterpret_cast<__m128i*>(&output[i]);
+        if constexpr (sizeof(T) == 1) {
+            _mm_storeu_si128(dst, select_si128(mask, v_high, v_low));
+        } else if constexpr (sizeof(T) == 2) {
+            _mm_storeu_si128(dst+0, select_si128(_mm_unpacklo_epi8(mask, mask), v_high, v_low));
+            _mm_storeu_si128(dst+1, select_si128(_mm_unpackhi_epi8(mask, mask), v_high, v_low));
+        } else {
+            const __m128i lo = _mm_unpacklo_epi8(mask, mask);
+            const __m128i hi = _mm_unpackhi_epi8(mask, mask);
+            _mm_storeu_si128(dst+0, select_si128(_mm_unpacklo_epi16(lo, lo), v_high, v_low));
+            _mm_storeu_si128(dst+1, select_si128(_mm_unpackhi_epi16(lo, lo), v_high, v_low));
+            _mm_storeu_si128(dst+2, select_si128(_mm_unpacklo_epi16(hi, hi), v_high, v_low));
+            _mm_storeu_si128(dst+3, select_si128(_mm_unpackhi_epi16(hi, hi), v_high, v_low));
+        }
+    }
+    for (; i < total_symbols; i++) {
+        const bool bit = (packed[i/8u] >> (i%8u)) & 0b1;
+        output[i] = bit ? high : low;
+    }
+}
+
+template <typename T>
+size_t ConvolutionalEncoder_CLMUL::encode(
+    const uint8_t* input_bytes, const size_t total_input_bytes,
+    T* output_symbols, const size_t max_output_symbols,
+    const T soft_decision_high, const T soft_decision_low)
+{
+    const size_t total_symbols = get_total_symbols(K, R, total_input_bytes);
+    assert(total_symbols <= max_output_symbols);
+    (void)max_output_symbols;
+    const size_t total_packed = (total_symbols+7u)/8u;
+    if (m_total_packed < total_packed) {
+        m_total_packed = total_packed;
+        delete [] m_packed;
+        m_packed = new uint8_t[m_total_packed];
+    }
+    encode_hard_packed(input_bytes, total_input_bytes, m_packed, total_packed);
+    expand_symbols<T>(m_packed, total_symbols, output_symbols, soft_decision_high, soft_decision_low);
+    return total_symbols;
+}
+
+template size_t ConvolutionalEncoder_CLMUL::encode<int8_t>(const uint8_t*, const size_t, int8_t*, const size_t, const int8_t, const int8_t);
+template size_t ConvolutionalEncoder_CLMUL::encode<uint8_t>(const uint8_t*, const size_t, uint8_t*, const size_t, const uint8_t, const uint8_t);
+template size_t ConvolutionalEncoder_CLMUL::encode<int16_t>(const uint8_t*, const size_t, int16_t*, const size_t, const int16_t, const int16_t);
+template size_t ConvolutionalEncoder_CLMUL::encode<float>(const uint8_t*, const size_t, float*, const size_t, const float, const float);
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bulk convolutional encoder for whole frames
+// Each output stream is the input bitstream multiplied by its generator polynomial over GF(2)
+// so 64 input bits at a time are encoded with one carryless multiply (pclmulqdq) per polynomial,
+// the bits that spill past each 64bit chunk carry into the next one
+// The streams are then interleaved into symbol order a byte at a time and expanded to soft symbols with SSE
+//
+// Output matches encode_data() with a ConvolutionalEncoder_ShiftRegister starting at state 0:
+// input bytes are consumed MSB first and the frame is terminated with K-1 zero tail bits
+// Compiled with pclmul and SSE4.1 so check is_clmul_encoder_supported() before using it
+
+// Defined in baseline code with the registry's cpu checks
+bool is_clmul_encoder_supported();
+
+class ConvolutionalEncoder_CLMUL
+{
+public:
+    const size_t K;
+    const size_t R;
+private:
+    // Buffers are plain arrays and raw new[] so no std template code gets compiled with pclmul and SSE4.1
+    // otherwise the linker could keep that copy for callers that never checked the cpu
+    uint64_t m_poly[8];
+    uint64_t m_spread_lut[256];             // bit i of a byte moved to bit i*R
+    uint64_t* m_words = nullptr;            // input bits with bit t of the frame at bit t%64 of word t/64
+                                            // followed by the encoded bits of each polynomial in the same layout
+    size_t m_total_words = 0;
+    uint8_t* m_packed = nullptr;
+    size_t m_total_packed = 0;
+public:
+    ConvolutionalEncoder_CLMUL(const size_t K, const size_t R, const int* poly);
+    ~ConvolutionalEncoder_CLMUL();
+    ConvolutionalEncoder_CLMUL(const ConvolutionalEncoder_CLMUL&) = delete;
+    ConvolutionalEncoder_CLMUL& operator=(const ConvolutionalEncoder_CLMUL&) = delete;
+
+    static size_t get_total_symbols(const size_t K, const size_t R, const size_t total_input_bytes) {
+        return (total_input_bytes*8u + K-1u)*R;
+    }
+
+    // Hard decision symbols packed 8 to a byte, symbol i is at bit (i%8) of byte (i/8)
+    // Same layout as encode_data_hard_packed(), returns the total number of symbols
+    size_t encode_hard_packed(const uint8_t* input_bytes, const size_t total_input_bytes, uint8_t* output_bytes, const size_t max_output_bytes);
+
+    // Soft decision symbols, implemented for 8, 16 and 32bit types
+    template <typename T>
+    size_t encode(
+        const uint8_t* input_bytes, const size_t total_input_bytes,
+        T* output_symbols, const size_t max_output_symbols,
+        const T soft_decision_high, const T soft_decision_low
+    );
+};
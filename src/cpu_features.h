@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+// Instruction sets that decoder kernels are compiled for
+enum CpuFeature: uint32_t {
+    CPU_FEATURE_SSE2  = 1u << 0,
+    CPU_FEATURE_SSSE3 = 1u << 1,
+    CPU_FEATURE_SSE41 = 1u << 2,
+    CPU_FEATURE_AVX2  = 1u << 3,
+    CPU_FEATURE_PCLMUL = 1u << 4,
+};
+
+constexpr size_t TOTAL_CPU_FEATURES = 5;
+
+static const char* const CPU_FEATURE_NAMES[TOTAL_CPU_FEATURES] = {
+    "sse2", "ssse3", "sse4.1", "avx2", "pclmul",
+};
+
+// Features of the running cpu from cpuid
+// AVX2 also needs the OS to save the upper halves of the ymm registers which is checked through xgetbv
+class CpuFeatures
+{
+private:
+    uint32_t m_flags;
+
+    static void cpuid(const uint32_t leaf, const uint32_t subleaf, uint32_t regs[4]) {
+        regs[0] = regs[1] = regs[2] = regs[3] = 0u;
+#if defined(_MSC_VER)
+        int values[4];
+        __cpuidex(values, int(leaf), int(subleaf));
+        for (size_t i = 0; i < 4; i++) regs[i] = uint32_t(values[i]);
+#elif defined(__x86_64__) || defined(__i386__)
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#else
+        (void)leaf;
+        (void)subleaf;
+#endif
+    }
+
+    static uint64_t xgetbv() {
+#if defined(_MSC_VER)
+        return uint64_t(_xgetbv(0));
+#elif defined(__x86_64__) || defined(__i386__)
+        uint32_t eax = 0u, edx = 0u;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (uint64_t(edx) << 32) | uint64_t(eax);
+#else
+        return 0u;
+#endif
+    }
+
+    CpuFeatures(): m_flags(0u) {
+        uint32_t regs[4];
+        cpuid(0u, 0u, regs);
+        const uint32_t max_leaf = regs[0];
+        if (max_leaf < 1u) return;
+        cpuid(1u, 0u, regs);
+        const uint32_t ecx = regs[2];
+        const uint32_t edx = regs[3];
+        if (edx & (1u << 26)) m_flags |= CPU_FEATURE_SSE2;
+        if (ecx & (1u << 9))  m_flags |= CPU_FEATURE_SSSE3;
+        if (ecx & (1u << 19)) m_flags |= CPU_FEATURE_SSE41;
+        if (ecx & (1u << 1))  m_flags |= CPU_FEATURE_PCLMUL;
+        const bool is_osxsave = (ecx & (1u << 27)) != 0u;
+        const bool is_avx = (ecx & (1u << 28)) != 0u;
+        // xmm and ymm state
+        const bool is_ymm_saved = is_osxsave && ((xgetbv() & 0b110u) == 0b110u);
+        if (is_avx && is_ymm_saved && max_leaf >= 7u) {
+            cpuid(7u, 0u, regs);
+            if (regs[1] & (1u << 5)) m_flags |= CPU_FEATURE_AVX2;
+        }
+    }
+    CpuFeatures(const CpuFeatures&) = delete;
+    CpuFeatures(CpuFeatures&&) = delete;
+    CpuFeatures& operator=(const CpuFeatures&) = delete;
+    CpuFeatures& operator=(CpuFeatures&&) = delete;
+public:
+    static
+    CpuFeatures& get() {
+        static CpuFeatures features;
+        return features;
+    }
+
+    uint32_t get_flags() const { return m_flags; }
+    bool has(const uint32_t flags) const { return (m_flags & flags) == flags; }
+    // Pretend features are missing to check the fallbacks a smaller machine would pick
+    void disable(const uint32_t flags) { m_flags &= ~flags; }
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+// How a decoder writes out its decision bits during symbol update
+// Decisions aren't read until chainback, so for long frames writing them through the cache
+// evicts the path metrics which are read and written on every bit
+enum class DecisionStorePolicy: int {
+    CACHED = 0,     // store decisions directly as they are produced
+    STREAMING = 1,  // stage decisions in a cache line buffer and flush with non-temporal stores
+};
+
+constexpr size_t DECISION_STORE_CACHE_LINE = 64;
+
+// Number of decision words that fill a cache line
+// Decoders with decision words larger than a cache line stage a single word
+template <typename decision_t>
+constexpr size_t get_decision_stage_size() {
+    return (sizeof(decision_t) >= DECISION_STORE_CACHE_LINE) ? 1 : (DECISION_STORE_CACHE_LINE / sizeof(decision_t));
+}
+
+// Allocate decisions on a cache line boundary so that full lines are streamed
+static inline void* decision_store_malloc(const size_t total_bytes) {
+    return _mm_malloc(total_bytes, DECISION_STORE_CACHE_LINE);
+}
+
+static inline void decision_store_free(void* data) {
+    _mm_free(data);
+}
+
+// Write staged decisions to their final location bypassing the cache
+static inline void stream_decisions(void* dst, const void* src, const size_t total_bytes) {
+    const uintptr_t dst_addr = reinterpret_cast<uintptr_t>(dst);
+    auto* dst_bytes = reinterpret_cast<uint8_t*>(dst);
+    auto* src_bytes = reinterpret_cast<const uint8_t*>(src);
+    size_t i = 0;
+#if defined(__AVX2__)
+    if ((dst_addr % 32u) == 0u) {
+        for (; (i+32u) <= total_bytes; i += 32u) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&src_bytes[i]));
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(&dst_bytes[i]), v);
+        }
+    }
+#endif
+    if ((dst_addr % 16u) == 0u) {
+        for (; (i+16u) <= total_bytes; i += 16u) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src_bytes[i]));
+            _mm_stream_si128(reinterpret_cast<__m128i*>(&dst_bytes[i]), v);
+        }
+    }
+    if (i < total_bytes) {
+        memcpy(&dst_bytes[i], &src_bytes[i], total_bytes-i);
+    }
+}
+
+// Run update over nbits in chunks whose decisions are written to a staging buffer and then streamed out
+// update(decisions, bit_offset, total_bits) must write decisions for total_bits starting at decisions[0]
+template <typename decision_t, size_t STAGE_SIZE, typename F>
+static void update_with_streamed_decisions(decision_t* d, decision_t (&stage)[STAGE_SIZE], const size_t nbits, F&& update) {
+    size_t bit = 0;
+    // Bring destination up to a cache line boundary so each flush covers whole lines
+    if ((DECISION_STORE_CACHE_LINE % sizeof(decision_t)) == 0u) {
+        const size_t misalign = reinterpret_cast<uintptr_t>(d) % DECISION_STORE_CACHE_LINE;
+        if (misalign != 0u) {
+            size_t lead = (DECISION_STORE_CACHE_LINE - misalign) / sizeof(decision_t);
+            lead = (lead > nbits) ? nbits : lead;
+            update(d, bit, lead);
+            bit += lead;
+        }
+    }
+    for (; (bit+STAGE_SIZE) <= nbits; bit += STAGE_SIZE) {
+        update(stage, bit, STAGE_SIZE);
+        stream_decisions(&d[bit], stage, sizeof(stage));
+    }
+    if (bit < nbits) {
+        update(&d[bit], bit, nbits-bit);
+    }
+    _mm_sfence();
+}
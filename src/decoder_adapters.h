@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include "viterbi/viterbi_branch_table.h"
+#include "viterbi/viterbi_decoder_core.h"
+#include "./decoder_kernels.h"
+#include "./decoder_registry.h"
+#include "./viterbi_configs.h"
+
+// Wraps each kernel family behind DynamicDecoder for the registry
+// Only included by baseline code since the kernels themselves are reached through plain function calls
+namespace {
+
+// ka9q and spiral decoders already take full scale signed symbols
+template <typename decoder_t>
+class ThirdPartyDecoder: public DynamicDecoder
+{
+private:
+    decoder_t m_decoder;
+public:
+    ThirdPartyDecoder(const int* poly, const size_t total_transmit_bits): m_decoder(poly, total_transmit_bits) {}
+    void reset() override {
+        m_decoder.reset();
+    }
+    void update(const int8_t* symbols, const size_t total_symbols) override {
+        // Symbols are only read
+        m_decoder.update(const_cast<int8_t*>(symbols), total_symbols);
+    }
+    uint32_t get_best_state() override {
+        return m_decoder.get_best_state();
+    }
+    void chainback(uint8_t* data, const size_t total_bits, const uint32_t end_state) override {
+        m_decoder.chainback(data, total_bits, end_state);
+    }
+};
+
+// Our decoders expect symbols in the soft decision range of their config
+// The u16 config is already full scale but the u8 path metrics only have room for a few levels per symbol
+// so symbols go through a lookup table built once from the config, a block at a time so the
+// converted symbols are still in L1 when the update reads them
+template <size_t K, size_t R, typename soft_t, typename error_t, UpdateKernel<K,R,soft_t,error_t> update_kernel>
+class OursDecoder: public DynamicDecoder
+{
+private:
+    static constexpr size_t BLOCK_SYMBOLS = 1024u*R;
+    Decoder_Config<soft_t, error_t> m_config;
+    std::unique_ptr<ViterbiBranchTable<K,R,soft_t>> m_branch_table;
+    std::unique_ptr<ViterbiDecoder_Core<K,R,error_t,soft_t>> m_core;
+    soft_t m_quantise_lut[256];     // indexed by the symbol's bit pattern
+    std::vector<soft_t> m_symbols;
+public:
+    OursDecoder(const int* poly, const size_t total_transmit_bits, const Decoder_Config<soft_t, error_t>& config)
+    : m_config(config)
+    {
+        m_branch_table = std::make_unique<ViterbiBranchTable<K,R,soft_t>>(poly, m_config.soft_decision_high, m_config.soft_decision_low);
+        m_core = std::make_unique<ViterbiDecoder_Core<K,R,error_t,soft_t>>(*m_branch_table, m_config.decoder_config);
+        m_core->set_traceback_length(total_transmit_bits - (K-1u));
+        const int high = int(m_config.soft_decision_high);
+        for (int symbol = -128; symbol <= 127; symbol++) {
+            // Round to nearest so that full scale symbols land exactly on the soft decision limits
+            const int x = symbol*high;
+            m_quantise_lut[uint8_t(symbol)] = soft_t((x >= 0) ? (x+63)/127 : (x-63)/127);
+        }
+        m_symbols.resize(BLOCK_SYMBOLS);
+    }
+    void reset() override {
+        m_core->reset();
+    }
+    void update(const int8_t* symbols, const size_t total_symbols) override {
+        for (size_t offset = 0; offset < total_symbols; offset += BLOCK_SYMBOLS) {
+            const size_t total_block = ((total_symbols-offset) < BLOCK_SYMBOLS) ? (total_symbols-offset) : BLOCK_SYMBOLS;
+            for (size_t i = 0; i < total_block; i++) {
+                m_symbols[i] = m_quantise_lut[uint8_t(symbols[offset+i])];
+            }
+            update_kernel(*m_core, m_symbols.data(), total_block);
+        }
+    }
+    uint32_t get_best_state() override {
+        constexpr size_t NUMSTATES = size_t(1) << (K-1u);
+        uint32_t best_state = 0;
+        uint64_t best_error = m_core->get_error(0);
+        for (size_t state = 1; state < NUMSTATES; state++) {
+            const uint64_t error = m_core->get_error(state);
+            if (error < best_error) {
+                best_error = error;
+                best_state = uint32_t(state);
+            }
+        }
+        return best_state;
+    }
+    void chainback(uint8_t* data, const size_t total_bits, const uint32_t end_state) override {
+        m_core->chainback(data, total_bits, end_state);
+    }
+};
+
+template <typename decoder_t>
+std::unique_ptr<DynamicDecoder> create_third_party_decoder(const int* poly, const size_t total_transmit_bits) {
+    return std::make_unique<ThirdPartyDecoder<decoder_t>>(poly, total_transmit_bits);
+}
+
+template <size_t K, size_t R, UpdateKernel<K,R,int8_t,uint8_t> update_kernel>
+std::unique_ptr<DynamicDecoder> create_ours_u8_decoder(const int* poly, const size_t total_transmit_bits) {
+    return std::make_unique<OursDecoder<K,R,int8_t,uint8_t,update_kernel>>(poly, total_transmit_bits, get_soft8_decoding_config(R));
+}
+
+template <size_t K, size_t R, UpdateKernel<K,R,int16_t,uint16_t> update_kernel>
+std::unique_ptr<DynamicDecoder> create_ours_u16_decoder(const int* poly, const size_t total_transmit_bits) {
+    return std::make_unique<OursDecoder<K,R,int16_t,uint16_t,update_kernel>>(poly, total_transmit_bits, get_soft16_decoding_config(R));
+}
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "viterbi/viterbi_decoder_core.h"
+
+// Update loops of our decoders compiled in the instruction set specific translation units
+// These are the only thing those translation units export and they take the decoder core directly
+// so the core, branch table and std containers are only ever instantiated in baseline code
+// otherwise the linker could keep a wider instruction set copy of them for every caller
+template <size_t K, size_t R, typename soft_t, typename error_t>
+using UpdateKernel = void (*)(ViterbiDecoder_Core<K,R,error_t,soft_t>& core, const soft_t* symbols, const size_t total_symbols);
+
+// SSE4.1
+template <size_t K, size_t R>
+void update_sse_u8(ViterbiDecoder_Core<K,R,uint8_t,int8_t>& core, const int8_t* symbols, const size_t total_symbols);
+template <size_t K, size_t R>
+void update_sse_u16(ViterbiDecoder_Core<K,R,uint16_t,int16_t>& core, const int16_t* symbols, const size_t total_symbols);
+
+// AVX2
+template <size_t K, size_t R>
+void update_avx_u8(ViterbiDecoder_Core<K,R,uint8_t,int8_t>& core, const int8_t* symbols, const size_t total_symbols);
+template <size_t K, size_t R>
+void update_avx_u16(ViterbiDecoder_Core<K,R,uint16_t,int16_t>& core, const int16_t* symbols, const size_t total_symbols);
@@ -0,0 +1,121 @@
+#include "./decoder_registry.h"
+#include <string.h>
+#include <algorithm>
+#include "./convolutional_encoder_clmul.h"
+#include "./cpu_features.h"
+#include "./decoder_adapters.h"
+#include "./decoder_kernels.h"
+#include "./ka9q_interface.h"
+#include "./spiral_interface.h"
+
+// The entries are built here rather than in the instruction set specific translation units
+// so they only export plain functions, see decoder_kernels.h
+constexpr uint32_t SSE_FEATURES = CPU_FEATURE_SSE2 | CPU_FEATURE_SSSE3 | CPU_FEATURE_SSE41;
+constexpr uint32_t AVX2_FEATURES = CPU_FEATURE_SSE2 | CPU_FEATURE_SSSE3 | CPU_FEATURE_SSE41 | CPU_FEATURE_AVX2;
+
+template <size_t K, size_t R>
+static void add_ours_sse_entries(std::vector<DecoderEntry>& entries) {
+    entries.push_back({ "sse_u8", K, R, DecoderPrecision::U8, SSE_FEATURES, 30, &create_ours_u8_decoder<K,R,&update_sse_u8<K,R>> });
+    entries.push_back({ "sse_u16", K, R, DecoderPrecision::U16, SSE_FEATURES, 30, &create_ours_u16_decoder<K,R,&update_sse_u16<K,R>> });
+}
+
+template <size_t K, size_t R>
+static void add_ours_avx2_entries(std::vector<DecoderEntry>& entries) {
+    entries.push_back({ "avx_u8", K, R, DecoderPrecision::U8, AVX2_FEATURES, 40, &create_ours_u8_decoder<K,R,&update_avx_u8<K,R>> });
+    entries.push_back({ "avx_u16", K, R, DecoderPrecision::U16, AVX2_FEATURES, 40, &create_ours_u16_decoder<K,R,&update_avx_u16<K,R>> });
+}
+
+static void add_sse_decoder_entries(std::vector<DecoderEntry>& entries) {
+    entries.push_back({ "ka9q", 7, 2, DecoderPrecision::U8, SSE_FEATURES, 20, &create_third_party_decoder<ka9q_viterbi27> });
+    entries.push_back({ "ka9q", 9, 2, DecoderPrecision::U8, SSE_FEATURES, 20, &create_third_party_decoder<ka9q_viterbi29> });
+    entries.push_back({ "ka9q", 15, 6, DecoderPrecision::U16, SSE_FEATURES, 20, &create_third_party_decoder<ka9q_viterbi615> });
+    entries.push_back({ "ka9q", 24, 2, DecoderPrecision::U16, SSE_FEATURES, 20, &create_third_party_decoder<ka9q_viterbi224> });
+    entries.push_back({ "spiral", 7, 2, DecoderPrecision::U8, SSE_FEATURES, 20, &create_third_party_decoder<spiral27_i>, false });
+    entries.push_back({ "spiral", 7, 4, DecoderPrecision::U8, SSE_FEATURES, 20, &create_third_party_decoder<spiral47_i>, false });
+    entries.push_back({ "spiral", 9, 2, DecoderPrecision::U8, SSE_FEATURES, 20, &create_third_party_decoder<spiral29_i>, false });
+    entries.push_back({ "spiral", 9, 4, DecoderPrecision::U8, SSE_FEATURES, 20, &create_third_party_decoder<spiral49_i>, false });
+    entries.push_back({ "spiral", 15, 6, DecoderPrecision::U8, SSE_FEATURES, 20, &create_third_party_decoder<spiral615_i>, false });
+    add_ours_sse_entries<7,2>(entries);
+    add_ours_sse_entries<7,4>(entries);
+    add_ours_sse_entries<9,2>(entries);
+    add_ours_sse_entries<9,4>(entries);
+    add_ours_sse_entries<15,6>(entries);
+    add_ours_sse_entries<24,2>(entries);
+}
+
+static void add_avx2_decoder_entries(std::vector<DecoderEntry>& entries) {
+    entries.push_back({ "spiral_avx2", 7, 2, DecoderPrecision::U8, AVX2_FEATURES, 35, &create_third_party_decoder<spiral27_avx2_i>, false });
+    entries.push_back({ "spiral_avx2", 7, 4, DecoderPrecision::U8, AVX2_FEATURES, 35, &create_third_party_decoder<spiral47_avx2_i>, false });
+    entries.push_back({ "spiral_avx2", 9, 2, DecoderPrecision::U8, AVX2_FEATURES, 35, &create_third_party_decoder<spiral29_avx2_i>, false });
+    entries.push_back({ "spiral_avx2", 9, 4, DecoderPrecision::U8, AVX2_FEATURES, 35, &create_third_party_decoder<spiral49_avx2_i>, false });
+    entries.push_back({ "spiral_avx2", 15, 6, DecoderPrecision::U8, AVX2_FEATURES, 35, &create_third_party_decoder<spiral615_avx2_i>, false });
+    add_ours_avx2_entries<7,2>(entries);
+    add_ours_avx2_entries<7,4>(entries);
+    add_ours_avx2_entries<9,2>(entries);
+    add_ours_avx2_entries<9,4>(entries);
+    add_ours_avx2_entries<15,6>(entries);
+    add_ours_avx2_entries<24,2>(entries);
+}
+
+const char* get_precision_name(const DecoderPrecision precision) {
+    switch (precision) {
+    case DecoderPrecision::U8: return "u8";
+    case DecoderPrecision::U16: return "u16";
+    default: return "unknown";
+    }
+}
+
+const std::vector<DecoderEntry>& get_decoder_entries() {
+    static const std::vector<DecoderEntry> entries = []() {
+        std::vector<DecoderEntry> entries;
+        add_sse_decoder_entries(entries);
+        add_avx2_decoder_entries(entries);
+        add_jit_decoder_entries(entries);
+        return entries;
+    }();
+    return entries;
+}
+
+bool is_decoder_supported(const DecoderEntry& entry) {
+    return CpuFeatures::get().has(entry.required_features);
+}
+
+// Checked here since the encoder's own translation unit is compiled with pclmul and SSE4.1
+bool is_clmul_encoder_supported() {
+    return CpuFeatures::get().has(SSE_FEATURES | CPU_FEATURE_PCLMUL);
+}
+
+std::vector<const DecoderEntry*> get_decoder_candidates(const size_t K, const size_t R, const DecoderPrecision precision, const bool is_supported_only) {
+    std::vector<const DecoderEntry*> candidates;
+    for (const auto& entry: get_decoder_entries()) {
+        if (entry.K != K || entry.R != R || entry.precision != precision) continue;
+        if (is_supported_only && !is_decoder_supported(entry)) continue;
+        candidates.push_back(&entry);
+    }
+    // Keep registration order between equal priorities so the result is deterministic
+    std::stable_sort(candidates.begin(), candidates.end(), [](const DecoderEntry* a, const DecoderEntry* b) {
+        return a->priority > b->priority;
+    });
+    return candidates;
+}
+
+const DecoderEntry* find_best_decoder(const size_t K, const size_t R, const DecoderPrecision precision) {
+    const auto candidates = get_decoder_candidates(K, R, precision);
+    if (candidates.empty()) return nullptr;
+    return candidates[0];
+}
+
+const DecoderEntry* find_decoder_by_name(const size_t K, const size_t R, const char* name) {
+    for (const auto& entry: get_decoder_entries()) {
+        if (entry.K != K || entry.R != R || strcmp(entry.name, name) != 0) continue;
+        if (!is_decoder_supported(entry)) continue;
+        return &entry;
+    }
+    return nullptr;
+}
+
+std::unique_ptr<DynamicDecoder> create_best_decoder(const size_t K, const size_t R, const int* poly, const DecoderPrecision precision, const size_t total_transmit_bits) {
+    const auto* entry = find_best_decoder(K, R, precision);
+    if (entry == nullptr) return nullptr;
+    return entry->create(poly, total_transmit_bits);
+}
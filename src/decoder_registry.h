@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+// Registry of every decoder kernel so one binary can pick the fastest one the running cpu supports
+// Kernels are compiled in separate translation units with only the instruction sets they need
+// Nothing here touches vector intrinsics so it is safe to call on any x86 cpu
+
+// Width of the path metrics
+enum class DecoderPrecision {
+    U8,
+    U16,
+};
+
+const char* get_precision_name(const DecoderPrecision precision);
+
+// Type erased decoder so callers don't depend on each kernel family's interface
+// Symbols are signed soft decisions spanning the full 8bit range, i.e. +127 for a 1 and -127 for a 0
+class DynamicDecoder
+{
+public:
+    virtual ~DynamicDecoder() {}
+    virtual void reset() = 0;
+    virtual void update(const int8_t* symbols, const size_t total_symbols) = 0;
+    virtual uint32_t get_best_state() = 0;
+    virtual void chainback(uint8_t* data, const size_t total_bits, const uint32_t end_state) = 0;
+};
+
+struct DecoderEntry {
+    const char* name;
+    size_t K;
+    size_t R;
+    DecoderPrecision precision;
+    uint32_t required_features;     // CpuFeature flags
+    int priority;                   // higher is expected to be faster when several are available
+    std::unique_ptr<DynamicDecoder> (*create)(const int* poly, const size_t total_transmit_bits);
+    // Spiral always writes decisions from the start of its buffer and decodes bits in pairs
+    // so a frame must be given in one update with an even number of bits
+    bool is_incremental_update = true;
+};
+
+// Every registered decoder regardless of whether the cpu supports it
+const std::vector<DecoderEntry>& get_decoder_entries();
+
+bool is_decoder_supported(const DecoderEntry& entry);
+
+// Decoders for a code sorted from highest to lowest priority
+// Unsupported decoders are included when is_supported_only is false so they can be listed
+std::vector<const DecoderEntry*> get_decoder_candidates(const size_t K, const size_t R, const DecoderPrecision precision, const bool is_supported_only = true);
+
+// Highest priority decoder that the cpu supports, nullptr if there are none
+const DecoderEntry* find_best_decoder(const size_t K, const size_t R, const DecoderPrecision precision);
+
+// Supported decoder with the given name, nullptr if there is none
+// Names are unique for a code across precisions
+const DecoderEntry* find_decoder_by_name(const size_t K, const size_t R, const char* name);
+
+// Creates the best decoder for the code, nullptr if there are none
+std::unique_ptr<DynamicDecoder> create_best_decoder(const size_t K, const size_t R, const int* poly, const DecoderPrecision precision, const size_t total_transmit_bits);
+
+void add_jit_decoder_entries(std::vector<DecoderEntry>& entries);
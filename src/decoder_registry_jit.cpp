@@ -0,0 +1,49 @@
+// Generated kernels only use SSE2 and the generator itself is plain C++ so this needs no special flags
+#include "./decoder_registry.h"
+#include "./cpu_features.h"
+#include "./viterbi_decoder_jit.h"
+
+class JitDecoder: public DynamicDecoder
+{
+private:
+    ViterbiDecoder_JIT m_decoder;
+public:
+    JitDecoder(const size_t K, const size_t R, const int* poly, const DecoderPrecision precision, const size_t total_transmit_bits)
+    : m_decoder(K, R, poly, precision, total_transmit_bits) {}
+    void reset() override {
+        m_decoder.reset();
+    }
+    void update(const int8_t* symbols, const size_t total_symbols) override {
+        m_decoder.update(symbols, total_symbols);
+    }
+    uint32_t get_best_state() override {
+        return uint32_t(m_decoder.get_best_state());
+    }
+    void chainback(uint8_t* data, const size_t total_bits, const uint32_t end_state) override {
+        m_decoder.chainback(data, total_bits, end_state);
+    }
+};
+
+template <size_t K, size_t R, DecoderPrecision precision>
+static std::unique_ptr<DynamicDecoder> create_jit_decoder(const int* poly, const size_t total_transmit_bits) {
+    return std::make_unique<JitDecoder>(K, R, poly, precision, total_transmit_bits);
+}
+
+template <size_t K, size_t R>
+static void add_jit_entries(std::vector<DecoderEntry>& entries) {
+    if (is_jit_code_supported(K, R, DecoderPrecision::U8)) {
+        entries.push_back({ "jit_u8", K, R, DecoderPrecision::U8, CPU_FEATURE_SSE2, 25, &create_jit_decoder<K,R,DecoderPrecision::U8> });
+    }
+    if (is_jit_code_supported(K, R, DecoderPrecision::U16)) {
+        entries.push_back({ "jit_u16", K, R, DecoderPrecision::U16, CPU_FEATURE_SSE2, 25, &create_jit_decoder<K,R,DecoderPrecision::U16> });
+    }
+}
+
+// Kernels are generated for any polynomial but entries are only listed for the benchmarked codes
+// K=15 and K=24 would unroll into too much code so they aren't supported
+void add_jit_decoder_entries(std::vector<DecoderEntry>& entries) {
+    add_jit_entries<7,2>(entries);
+    add_jit_entries<7,4>(entries);
+    add_jit_entries<9,2>(entries);
+    add_jit_entries<9,4>(entries);
+}
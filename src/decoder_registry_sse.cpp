@@ -0,0 +1,28 @@
+// Compiled with SSE4.1 so nothing here may run before the registry checks the cpu
+// Only the update loops live here, see decoder_kernels.h
+#include "./decoder_kernels.h"
+#include "viterbi/x86/viterbi_decoder_sse_u16.h"
+#include "viterbi/x86/viterbi_decoder_sse_u8.h"
+
+template <size_t K, size_t R>
+void update_sse_u8(ViterbiDecoder_Core<K,R,uint8_t,int8_t>& core, const int8_t* symbols, const size_t total_symbols) {
+    ViterbiDecoder_SSE_u8<K,R>::template update<uint64_t>(core, symbols, total_symbols);
+}
+
+template <size_t K, size_t R>
+void update_sse_u16(ViterbiDecoder_Core<K,R,uint16_t,int16_t>& core, const int16_t* symbols, const size_t total_symbols) {
+    ViterbiDecoder_SSE_u16<K,R>::template update<uint64_t>(core, symbols, total_symbols);
+}
+
+template void update_sse_u8<7,2>(ViterbiDecoder_Core<7,2,uint8_t,int8_t>&, const int8_t*, const size_t);
+template void update_sse_u8<7,4>(ViterbiDecoder_Core<7,4,uint8_t,int8_t>&, const int8_t*, const size_t);
+template void update_sse_u8<9,2>(ViterbiDecoder_Core<9,2,uint8_t,int8_t>&, const int8_t*, const size_t);
+template void update_sse_u8<9,4>(ViterbiDecoder_Core<9,4,uint8_t,int8_t>&, const int8_t*, const size_t);
+template void update_sse_u8<15,6>(ViterbiDecoder_Core<15,6,uint8_t,int8_t>&, const int8_t*, const size_t);
+template void update_sse_u8<24,2>(ViterbiDecoder_Core<24,2,uint8_t,int8_t>&, const int8_t*, const size_t);
+template void update_sse_u16<7,2>(ViterbiDecoder_Core<7,2,uint16_t,int16_t>&, const int16_t*, const size_t);
+template void update_sse_u16<7,4>(ViterbiDecoder_Core<7,4,uint16_t,int16_t>&, const int16_t*, const size_t);
+template void update_sse_u16<9,2>(ViterbiDecoder_Core<9,2,uint16_t,int16_t>&, const int16_t*, const size_t);
+template void update_sse_u16<9,4>(ViterbiDecoder_Core<9,4,uint16_t,int16_t>&, const int16_t*, const size_t);
+template void update_sse_u16<15,6>(ViterbiDecoder_Core<15,6,uint16_t,int16_t>&, const int16_t*, const size_t);
+template void update_sse_u16<24,2>(ViterbiDecoder_Core<24,2,uint16_t,int16_t>&, const int16_t*, const size_t);
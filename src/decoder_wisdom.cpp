@@ -0,0 +1,194 @@
+#include "./decoder_wisdom.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "./timer.h"
+#include "./util.h"
+#include "viterbi/convolutional_encoder_shift_register.h"
+
+// Plain text so it can be inspected or edited by hand
+// header line then one entry per line:
+// K R precision total_input_bits engine update_ns chainback_ns
+// Files from other versions are ignored and rewritten by the next autotune
+static const char* WISDOM_HEADER = "viterbi_wisdom";
+constexpr int WISDOM_VERSION = 2;
+constexpr size_t MAX_ENGINE_NAME = 64;
+
+static bool get_precision_from_name(const char* name, DecoderPrecision& precision) {
+    for (const auto value: { DecoderPrecision::U8, DecoderPrecision::U16 }) {
+        if (strcmp(name, get_precision_name(value)) == 0) {
+            precision = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DecoderWisdom::load(const char* filename) {
+    FILE* fp = fopen(filename, "r");
+    if (fp == nullptr) return false;
+    char header[32];
+    int version = 0;
+    if ((fscanf(fp, "%31s %d", header, &version) != 2) || (strcmp(header, WISDOM_HEADER) != 0) || (version != WISDOM_VERSION)) {
+        fclose(fp);
+        return false;
+    }
+    while (true) {
+        size_t K, R, total_input_bits;
+        unsigned long long update_ns, chainback_ns;
+        char precision_name[16];
+        char engine[MAX_ENGINE_NAME];
+        const int total_read = fscanf(
+            fp, "%zu %zu %15s %zu %63s %llu %llu",
+            &K, &R, precision_name, &total_input_bits,
+            engine, &update_ns, &chainback_ns
+        );
+        if (total_read != 7) break;
+        WisdomEntry entry;
+        if (!get_precision_from_name(precision_name, entry.precision)) continue;
+        entry.K = K;
+        entry.R = R;
+        entry.total_input_bits = total_input_bits;
+        entry.engine = engine;
+        entry.update_ns = uint64_t(update_ns);
+        entry.chainback_ns = uint64_t(chainback_ns);
+        set(entry);
+    }
+    fclose(fp);
+    return true;
+}
+
+bool DecoderWisdom::save(const char* filename) const {
+    FILE* fp = fopen(filename, "w");
+    if (fp == nullptr) return false;
+    fprintf(fp, "%s %d\n", WISDOM_HEADER, WISDOM_VERSION);
+    for (const auto& entry: m_entries) {
+        fprintf(
+            fp, "%zu %zu %s %zu %s %llu %llu\n",
+            entry.K, entry.R, get_precision_name(entry.precision), entry.total_input_bits,
+            entry.engine.c_str(),
+            (unsigned long long)entry.update_ns, (unsigned long long)entry.chainback_ns
+        );
+    }
+    const bool is_error = ferror(fp) != 0;
+    fclose(fp);
+    return !is_error;
+}
+
+void DecoderWisdom::set(const WisdomEntry& entry) {
+    for (auto& other: m_entries) {
+        if (other.K == entry.K && other.R == entry.R && other.precision == entry.precision && other.total_input_bits == entry.total_input_bits) {
+            other = entry;
+            return;
+        }
+    }
+    m_entries.push_back(entry);
+}
+
+const WisdomEntry* DecoderWisdom::find(const size_t K, const size_t R, const DecoderPrecision precision, const size_t total_input_bits) const {
+    // Compare frame lengths by ratio since the crossover points scale with cache sizes
+    const WisdomEntry* best = nullptr;
+    double best_distance = 0.0;
+    for (const auto& entry: m_entries) {
+        if (entry.K != K || entry.R != R || entry.precision != precision) continue;
+        const double distance = fabs(log2(double(entry.total_input_bits+1u)) - log2(double(total_input_bits+1u)));
+        if (best == nullptr || distance < best_distance) {
+            best = &entry;
+            best_distance = distance;
+        }
+    }
+    return best;
+}
+
+static uint64_t get_median(std::vector<uint64_t>& values) {
+    if (values.empty()) return 0u;
+    const size_t middle = values.size()/2u;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    return values[middle];
+}
+
+std::vector<AutotuneCandidate> benchmark_decoder_candidates(
+    const size_t K, const size_t R, const int* poly, const DecoderPrecision precision,
+    const size_t total_input_bits, const float sampling_time, const size_t minimum_samples)
+{
+    // Frames are a whole number of bytes
+    const size_t total_input_bytes = total_input_bits/8u;
+    const size_t total_decode_bits = total_input_bytes*8u;
+    const size_t total_transmit_bits = total_decode_bits + (K-1u);
+    const size_t total_symbols = total_transmit_bits*R;
+    auto x_in = std::vector<uint8_t>(total_input_bytes);
+    auto x_out = std::vector<uint8_t>(total_input_bytes);
+    auto y_in = std::vector<int8_t>(total_symbols);
+    generate_random_bytes(x_in.data(), x_in.size());
+    using reg_t = uint32_t;
+    auto encoder = ConvolutionalEncoder_ShiftRegister<reg_t>(K, R, poly);
+    encode_data<int8_t>(&encoder, x_in.data(), x_in.size(), y_in.data(), y_in.size(), +127, -127);
+
+    std::vector<AutotuneCandidate> results;
+    std::vector<uint64_t> update_ns;
+    std::vector<uint64_t> chainback_ns;
+    for (const auto* candidate: get_decoder_candidates(K, R, precision)) {
+        auto decoder = candidate->create(poly, total_transmit_bits);
+        // First update touches freshly allocated decisions so leave it out
+        decoder->reset();
+        decoder->update(y_in.data(), y_in.size());
+        update_ns.clear();
+        chainback_ns.clear();
+        Timer total_time;
+        for (size_t i = 0; ; i++) {
+            const float elapsed_seconds = float(total_time.get_delta<std::chrono::milliseconds>())*1e-3f;
+            if ((elapsed_seconds > sampling_time) && (i > minimum_samples)) break;
+            decoder->reset();
+            {
+                Timer t;
+                decoder->update(y_in.data(), y_in.size());
+                update_ns.push_back(t.get_delta());
+            }
+            {
+                Timer t;
+                decoder->chainback(x_out.data(), total_decode_bits, 0u);
+                chainback_ns.push_back(t.get_delta());
+            }
+        }
+        AutotuneCandidate result;
+        result.decoder = candidate;
+        result.update_ns = get_median(update_ns);
+        result.chainback_ns = get_median(chainback_ns);
+        result.is_correct = get_total_bit_errors(x_in.data(), x_out.data(), x_in.size()) == 0u;
+        results.push_back(result);
+    }
+    return results;
+}
+
+bool get_autotune_winners(
+    const std::vector<AutotuneCandidate>& candidates,
+    const size_t K, const size_t R, const DecoderPrecision precision, const size_t total_input_bits,
+    WisdomEntry& entry)
+{
+    const AutotuneCandidate* best = nullptr;
+    for (const auto& candidate: candidates) {
+        if (!candidate.is_correct) continue;
+        if (best == nullptr || (candidate.update_ns + candidate.chainback_ns) < (best->update_ns + best->chainback_ns)) best = &candidate;
+    }
+    if (best == nullptr) return false;
+    entry.K = K;
+    entry.R = R;
+    entry.precision = precision;
+    entry.total_input_bits = total_input_bits;
+    entry.engine = best->decoder->name;
+    entry.update_ns = best->update_ns;
+    entry.chainback_ns = best->chainback_ns;
+    return true;
+}
+
+const DecoderEntry* find_tuned_decoder(const size_t K, const size_t R, const DecoderPrecision precision, const size_t total_input_bits) {
+    const auto* wisdom = DecoderWisdom::get().find(K, R, precision, total_input_bits);
+    if (wisdom != nullptr) {
+        // Wisdom may come from another machine or have engines masked out so only use it if it's still supported
+        for (const auto* candidate: get_decoder_candidates(K, R, precision)) {
+            if (wisdom->engine == candidate->name) return candidate;
+        }
+    }
+    return find_best_decoder(K, R, precision);
+}
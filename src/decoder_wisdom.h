@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "./decoder_registry.h"
+
+// Measured decoder choices for this machine, like FFTW wisdom
+// The registry priorities are only a guess since the fastest engine depends on K, R, frame length and the cpu
+// Autotuning benchmarks every candidate once and the winners are saved so later runs can skip measuring
+// Each engine is tuned with the one soft decision config it is registered with
+// since a coarser config is only faster through fewer renormalisations and still decodes noiseless frames
+// so picking configs on speed here would silently give up error correction
+
+struct WisdomEntry {
+    size_t K = 0;
+    size_t R = 0;
+    DecoderPrecision precision = DecoderPrecision::U8;
+    size_t total_input_bits = 0;
+    // A decoder's chainback reads the decisions written by its own update so the phases can't be mixed
+    // and the engine used is the fastest over both
+    std::string engine;
+    uint64_t update_ns = 0;         // median of the chosen engine
+    uint64_t chainback_ns = 0;
+};
+
+class DecoderWisdom
+{
+private:
+    std::vector<WisdomEntry> m_entries;
+    DecoderWisdom() {}
+    DecoderWisdom(const DecoderWisdom&) = delete;
+    DecoderWisdom(DecoderWisdom&&) = delete;
+    DecoderWisdom& operator=(const DecoderWisdom&) = delete;
+    DecoderWisdom& operator=(DecoderWisdom&&) = delete;
+public:
+    static
+    DecoderWisdom& get() {
+        static DecoderWisdom wisdom;
+        return wisdom;
+    }
+    // Entries from the file replace any existing entries with the same key
+    // Returns false if the file is missing or isn't a wisdom file
+    bool load(const char* filename);
+    bool save(const char* filename) const;
+    void set(const WisdomEntry& entry);
+    void clear() { m_entries.clear(); }
+    const std::vector<WisdomEntry>& get_entries() const { return m_entries; }
+    // Entry for the code with the closest frame length, nullptr if the code was never tuned
+    const WisdomEntry* find(const size_t K, const size_t R, const DecoderPrecision precision, const size_t total_input_bits) const;
+};
+
+struct AutotuneCandidate {
+    const DecoderEntry* decoder = nullptr;
+    uint64_t update_ns = 0;
+    uint64_t chainback_ns = 0;
+    bool is_correct = false;        // decoded a noiseless frame without errors
+};
+
+// Benchmarks every supported candidate on a random noiseless frame
+// Each candidate runs until both the sampling time and minimum number of samples are reached
+std::vector<AutotuneCandidate> benchmark_decoder_candidates(
+    const size_t K, const size_t R, const int* poly, const DecoderPrecision precision,
+    const size_t total_input_bits, const float sampling_time, const size_t minimum_samples);
+
+// Picks the winners from benchmark_decoder_candidates(), returns false if no candidate decoded correctly
+bool get_autotune_winners(
+    const std::vector<AutotuneCandidate>& candidates,
+    const size_t K, const size_t R, const DecoderPrecision precision, const size_t total_input_bits,
+    WisdomEntry& entry);
+
+// Decoder from the loaded wisdom if the cpu supports it otherwise the highest priority supported decoder
+const DecoderEntry* find_tuned_decoder(const size_t K, const size_t R, const DecoderPrecision precision, const size_t total_input_bits);
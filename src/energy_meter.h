@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#endif
+
+// Package energy from the Linux powercap interface to RAPL
+// Intel and recent AMD CPUs both expose their packages as /sys/class/powercap/intel-rapl:N
+// Counters only update about once a millisecond so short phases should be read as an average over many samples
+// On other platforms or when the files aren't readable (they are root only on newer kernels) nothing is measured
+class EnergyMeter
+{
+private:
+    struct Zone {
+        std::string energy_path;
+        uint64_t max_energy_uj;
+    };
+    std::vector<Zone> m_zones;
+    bool m_is_enabled;
+
+    static bool read_uint64(const char* path, uint64_t& value) {
+        FILE* fp = fopen(path, "r");
+        if (fp == nullptr) return false;
+        unsigned long long x = 0;
+        const bool is_read = fscanf(fp, "%llu", &x) == 1;
+        fclose(fp);
+        value = uint64_t(x);
+        return is_read;
+    }
+
+    EnergyMeter(): m_is_enabled(false) {
+#if defined(__linux__)
+        const char* root = "/sys/class/powercap";
+        DIR* dir = opendir(root);
+        if (dir == nullptr) return;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            // Only read top level packages since subzones like intel-rapl:0:0 are already included in them
+            const char* name = entry->d_name;
+            const char* prefix = "intel-rapl:";
+            if (strncmp(name, prefix, strlen(prefix)) != 0) continue;
+            if (strchr(name + strlen(prefix), ':') != nullptr) continue;
+            const std::string zone_path = std::string(root) + "/" + name;
+            Zone zone;
+            zone.energy_path = zone_path + "/energy_uj";
+            uint64_t energy_uj = 0;
+            if (!read_uint64(zone.energy_path.c_str(), energy_uj)) continue;
+            if (!read_uint64((zone_path + "/max_energy_range_uj").c_str(), zone.max_energy_uj)) continue;
+            m_zones.push_back(zone);
+        }
+        closedir(dir);
+#endif
+    }
+    EnergyMeter(const EnergyMeter&) = delete;
+    EnergyMeter(EnergyMeter&&) = delete;
+    EnergyMeter& operator=(const EnergyMeter&) = delete;
+    EnergyMeter& operator=(EnergyMeter&&) = delete;
+public:
+    static
+    EnergyMeter& get() {
+        static EnergyMeter meter;
+        return meter;
+    }
+
+    bool is_available() const { return !m_zones.empty(); }
+    bool is_enabled() const { return m_is_enabled; }
+    size_t get_total_zones() const { return m_zones.size(); }
+    void set_enabled(const bool is_enabled) { m_is_enabled = is_enabled && is_available(); }
+
+    // Raw counter value of each zone
+    std::vector<uint64_t> read() const {
+        std::vector<uint64_t> values;
+        if (!m_is_enabled) return values;
+        values.resize(m_zones.size(), 0);
+        for (size_t i = 0; i < m_zones.size(); i++) {
+            read_uint64(m_zones[i].energy_path.c_str(), values[i]);
+        }
+        return values;
+    }
+
+    // Energy used across all zones between two reads, accounting for counters wrapping around
+    uint64_t get_delta_uj(const std::vector<uint64_t>& start, const std::vector<uint64_t>& end) const {
+        uint64_t total = 0;
+        const size_t N = (start.size() < end.size()) ? start.size() : end.size();
+        for (size_t i = 0; i < N; i++) {
+            const uint64_t delta = (end[i] >= start[i]) ? (end[i] - start[i]) : (end[i] + m_zones[i].max_energy_uj - start[i]);
+            total += delta;
+        }
+        return total;
+    }
+};
+
+// Measures energy from construction until get_delta() like Timer does for elapsed time
+class EnergyCounter
+{
+private:
+    std::vector<uint64_t> m_start;
+public:
+    EnergyCounter() {
+        m_start = EnergyMeter::get().read();
+    }
+    uint64_t get_delta() {
+        auto& meter = EnergyMeter::get();
+        return meter.get_delta_uj(m_start, meter.read());
+    }
+};
@@ -7,6 +7,7 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include "./decision_store.h"
 
 // Match the interface for ka9q decoders to be like ours for testing
 template <
@@ -16,7 +17,10 @@ template <
     int (*vRK_init)(vRK*,int),
     void (*vRK_update)(vRK*, uint8_t*,int),
     int (*vRK_chainback)(vRK*,uint8_t*,uint32_t, uint32_t),
-    void (*vRK_delete)(vRK*)
+    void (*vRK_delete)(vRK*),
+    void (*vRK_set_decision_store)(vRK*,int),
+    unsigned int (*vRK_get_best_state)(vRK*),
+    void (*vRK_update_nibbles)(vRK*, const uint8_t*, int) = nullptr
 >
 class ka9q_viterbi_interface {
 public:
@@ -42,20 +46,41 @@ public:
         if (m_inner != nullptr) vRK_delete(m_inner);
         m_inner = nullptr;
     }
+    void set_decision_store(DecisionStorePolicy policy) {
+        vRK_set_decision_store(m_inner, int(policy));
+    }
     void reset() {
         vRK_init(m_inner, 0);
     }
-    void update(uint8_t* sym, size_t total_syms) {
+    // Symbols are signed like our decoders so no offset binary conversion pass is needed
+    void update(int8_t* sym, size_t total_syms) {
+        assert(total_syms % _R == 0);
+        const size_t total_bits = total_syms / _R;
+        vRK_update(m_inner, reinterpret_cast<uint8_t*>(sym), int(total_bits));
+    }
+    // Symbols are 4bit soft decisions packed two to a byte, see nibble_packing.h
+    void update_nibbles(const uint8_t* packed, size_t total_syms) {
+        static_assert(vRK_update_nibbles != nullptr, "Decoder doesn't support nibble packed symbols");
         assert(total_syms % _R == 0);
         const size_t total_bits = total_syms / _R;
-        vRK_update(m_inner, sym, int(total_bits));
+        vRK_update_nibbles(m_inner, packed, int(total_bits));
+    }
+    void chainback(uint8_t* data, size_t total_bits, uint32_t end_state=0) {
+        vRK_chainback(m_inner, data, uint32_t(total_bits), end_state);
+    }
+    // For unterminated streams start chainback from the state with the best path metric
+    // The last K-1 decoded bits are held in the returned state
+    uint32_t get_best_state() {
+        return uint32_t(vRK_get_best_state(m_inner));
     }
-    void chainback(uint8_t* data, size_t total_bits) {
-        vRK_chainback(m_inner, data, uint32_t(total_bits), 0);
+    uint32_t chainback_best_state(uint8_t* data, size_t total_bits) {
+        const uint32_t endstate = get_best_state();
+        vRK_chainback(m_inner, data, uint32_t(total_bits), endstate);
+        return endstate;
     }
 };
 
-using ka9q_viterbi27 = ka9q_viterbi_interface<7,2,v27,create_viterbi27_sse2,init_viterbi27_sse2,update_viterbi27_blk_sse2,chainback_viterbi27_sse2,delete_viterbi27_sse2>;
-using ka9q_viterbi29 = ka9q_viterbi_interface<9,2,v29,create_viterbi29_sse2,init_viterbi29_sse2,update_viterbi29_blk_sse2,chainback_viterbi29_sse2,delete_viterbi29_sse2>;
-using ka9q_viterbi615 = ka9q_viterbi_interface<15,6,v615,create_viterbi615_sse2,init_viterbi615_sse2,update_viterbi615_blk_sse2,chainback_viterbi615_sse2,delete_viterbi615_sse2>;
-using ka9q_viterbi224 = ka9q_viterbi_interface<24,2,v224,create_viterbi224_sse2,init_viterbi224_sse2,update_viterbi224_blk_sse2,chainback_viterbi224_sse2,delete_viterbi224_sse2>;
+using ka9q_viterbi27 = ka9q_viterbi_interface<7,2,v27,create_viterbi27_sse2,init_viterbi27_sse2,update_viterbi27_blk_sse2,chainback_viterbi27_sse2,delete_viterbi27_sse2,set_decision_store_viterbi27_sse2,get_best_state_viterbi27_sse2,update_viterbi27_blk_nibble_sse2>;
+using ka9q_viterbi29 = ka9q_viterbi_interface<9,2,v29,create_viterbi29_sse2,init_viterbi29_sse2,update_viterbi29_blk_sse2,chainback_viterbi29_sse2,delete_viterbi29_sse2,set_decision_store_viterbi29_sse2,get_best_state_viterbi29_sse2>;
+using ka9q_viterbi615 = ka9q_viterbi_interface<15,6,v615,create_viterbi615_sse2,init_viterbi615_sse2,update_viterbi615_blk_sse2,chainback_viterbi615_sse2,delete_viterbi615_sse2,set_decision_store_viterbi615_sse2,get_best_state_viterbi615_sse2>;
+using ka9q_viterbi224 = ka9q_viterbi_interface<24,2,v224,create_viterbi224_sse2,init_viterbi224_sse2,update_viterbi224_blk_sse2,chainback_viterbi224_sse2,delete_viterbi224_sse2,set_decision_store_viterbi224_sse2,get_best_state_viterbi224_sse2>;
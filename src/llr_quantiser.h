@@ -0,0 +1,135 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+// Convert floating point LLRs from a demodulator into the saturated soft decision symbols a decoder takes
+// symbol = clamp(round(llr*scale), -limit, +limit)
+// Use a negative scale if the LLRs are log(P(0)/P(1)) since our decoders take positive symbols as a 1
+struct LLR_Quantiser {
+    float scale;
+    float limit;
+};
+
+static inline int32_t quantise_llr_scalar(const float llr, const LLR_Quantiser& q) {
+    float x = llr*q.scale;
+    x = (x > q.limit) ? q.limit : x;
+    x = (x < -q.limit) ? -q.limit : x;
+    // use the same rounding mode as the vectorised conversion
+    return int32_t(_mm_cvtss_si32(_mm_set_ss(x)));
+}
+
+// Clamp before conversion so packing never has to saturate and both widths share the same code
+static void quantise_llr(const float* llr, int16_t* symbols, const size_t N, const LLR_Quantiser& q) {
+    size_t i = 0u;
+#if defined(__AVX2__)
+    {
+        const __m256 scale = _mm256_set1_ps(q.scale);
+        const __m256 upper = _mm256_set1_ps(q.limit);
+        const __m256 lower = _mm256_set1_ps(-q.limit);
+        auto convert = [&](const float* x) {
+            __m256 v = _mm256_mul_ps(_mm256_loadu_ps(x), scale);
+            v = _mm256_min_ps(_mm256_max_ps(v, lower), upper);
+            return _mm256_cvtps_epi32(v);
+        };
+        for (; (i+16u) <= N; i += 16u) {
+            const __m256i a = convert(&llr[i]);
+            const __m256i b = convert(&llr[i+8u]);
+            // packs operates within 128bit lanes so reorder 64bit blocks afterwards
+            const __m256i y = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0b11011000);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&symbols[i]), y);
+        }
+    }
+#endif
+    {
+        const __m128 scale = _mm_set1_ps(q.scale);
+        const __m128 upper = _mm_set1_ps(q.limit);
+        const __m128 lower = _mm_set1_ps(-q.limit);
+        auto convert = [&](const float* x) {
+            __m128 v = _mm_mul_ps(_mm_loadu_ps(x), scale);
+            v = _mm_min_ps(_mm_max_ps(v, lower), upper);
+            return _mm_cvtps_epi32(v);
+        };
+        for (; (i+8u) <= N; i += 8u) {
+            const __m128i y = _mm_packs_epi32(convert(&llr[i]), convert(&llr[i+4u]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&symbols[i]), y);
+        }
+    }
+    for (; i < N; i++) {
+        symbols[i] = int16_t(quantise_llr_scalar(llr[i], q));
+    }
+}
+
+static void quantise_llr(const float* llr, int8_t* symbols, const size_t N, const LLR_Quantiser& q) {
+    size_t i = 0u;
+#if defined(__AVX2__)
+    {
+        const __m256 scale = _mm256_set1_ps(q.scale);
+        const __m256 upper = _mm256_set1_ps(q.limit);
+        const __m256 lower = _mm256_set1_ps(-q.limit);
+        // packs leaves 32bit groups interleaved across lanes as (a0,b0,c0,d0,a1,b1,c1,d1)
+        const __m256i order = _mm256_setr_epi32(0,4,1,5,2,6,3,7);
+        auto convert = [&](const float* x) {
+            __m256 v = _mm256_mul_ps(_mm256_loadu_ps(x), scale);
+            v = _mm256_min_ps(_mm256_max_ps(v, lower), upper);
+            return _mm256_cvtps_epi32(v);
+        };
+        for (; (i+32u) <= N; i += 32u) {
+            const __m256i ab = _mm256_packs_epi32(convert(&llr[i]),     convert(&llr[i+8u]));
+            const __m256i cd = _mm256_packs_epi32(convert(&llr[i+16u]), convert(&llr[i+24u]));
+            const __m256i y = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(ab, cd), order);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&symbols[i]), y);
+        }
+    }
+#endif
+    {
+        const __m128 scale = _mm_set1_ps(q.scale);
+        const __m128 upper = _mm_set1_ps(q.limit);
+        const __m128 lower = _mm_set1_ps(-q.limit);
+        auto convert = [&](const float* x) {
+            __m128 v = _mm_mul_ps(_mm_loadu_ps(x), scale);
+            v = _mm_min_ps(_mm_max_ps(v, lower), upper);
+            return _mm_cvtps_epi32(v);
+        };
+        for (; (i+16u) <= N; i += 16u) {
+            const __m128i ab = _mm_packs_epi32(convert(&llr[i]),     convert(&llr[i+4u]));
+            const __m128i cd = _mm_packs_epi32(convert(&llr[i+8u]),  convert(&llr[i+12u]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&symbols[i]), _mm_packs_epi16(ab, cd));
+        }
+    }
+    for (; i < N; i++) {
+        symbols[i] = int8_t(quantise_llr_scalar(llr[i], q));
+    }
+}
+
+// Hard decisions packed 8 to a byte, symbol i is at bit (i%8) of byte (i/8)
+static void quantise_llr_hard_packed(const float* llr, uint8_t* output_bytes, const size_t N) {
+    size_t i = 0u;
+    const __m128 zero = _mm_setzero_ps();
+    for (; (i+8u) <= N; i += 8u) {
+        const int lo = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(&llr[i]), zero));
+        const int hi = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(&llr[i+4u]), zero));
+        output_bytes[i/8u] = uint8_t(lo | (hi << 4));
+    }
+    if (i == N) return;
+    uint8_t x = 0u;
+    for (size_t j = 0u; j < (N-i); j++) {
+        x |= uint8_t((llr[i+j] > 0.0f) ? (1u << j) : 0u);
+    }
+    output_bytes[i/8u] = x;
+}
+
+// Quantise a block at a time into a buffer that stays in L1 so the full frame of symbols never hits memory
+// update(symbols, total_symbols) is called with a multiple of R symbols
+template <size_t R, typename soft_t, size_t BLOCK_BITS = 256u, typename F>
+static void update_with_quantised_llr(const float* llr, const size_t total_symbols, const LLR_Quantiser& q, F&& update) {
+    constexpr size_t BLOCK_SYMBOLS = BLOCK_BITS*R;
+    alignas(32) soft_t block[BLOCK_SYMBOLS];
+    for (size_t i = 0u; i < total_symbols; i += BLOCK_SYMBOLS) {
+        const size_t remain = total_symbols-i;
+        const size_t total_block_symbols = (remain > BLOCK_SYMBOLS) ? BLOCK_SYMBOLS : remain;
+        quantise_llr(&llr[i], block, total_block_symbols, q);
+        update(block, total_block_symbols);
+    }
+}
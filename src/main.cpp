@@ -3,18 +3,40 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include <memory>
 #include <optional>
+#include <random>
+#include <type_traits>
+#include <utility>
 #include <vector>
+#include "./adaptive_scaling.h"
+#include "./alloc_tracker.h"
+#include "./awgn_channel.h"
+#include "./ber_sweep.h"
+#include "./convolutional_encoder_clmul.h"
 #include "./argparse.hpp"
+#include "./cpu_features.h"
+#include "./decision_store.h"
+#include "./decoder_registry.h"
+#include "./decoder_wisdom.h"
+#include "./energy_meter.h"
 #include "./ka9q_interface.h"
+#include "./llr_quantiser.h"
+#include "./metric_counters.h"
+#include "./nibble_packing.h"
+#include "./parity.h"
+#include "./perf_counters.h"
 #include "./span.h"
 #include "./spiral_interface.h"
 #include "./timer.h"
 #include "./util.h"
 #include "./viterbi_configs.h"
+#include "./viterbi_decoder_hard_packed.h"
+#include "./viterbi_decoder_hybrid.h"
+#include "./viterbi_decoder_jit.h"
 #include "viterbi/convolutional_encoder_shift_register.h"
 #include "viterbi/viterbi_branch_table.h"
 #include "viterbi/viterbi_decoder_config.h"
@@ -34,9 +56,51 @@ struct TestSample {
     uint64_t init_ns = 0;
     uint64_t update_symbols_ns = 0;
     uint64_t chainback_bits_ns = 0;
+    uint64_t best_state_ns = 0;
+    uint64_t init_cycles = 0;
+    uint64_t update_symbols_cycles = 0;
+    uint64_t chainback_bits_cycles = 0;
+    uint64_t best_state_cycles = 0;
+    uint64_t update_symbols_energy_uj = 0;
+    uint64_t chainback_bits_energy_uj = 0;
+    PerfCounts init_perf;
+    PerfCounts update_symbols_perf;
+    PerfCounts chainback_bits_perf;
+    PerfCounts best_state_perf;
+    AllocStats init_alloc;
+    AllocStats update_symbols_alloc;
+    AllocStats chainback_bits_alloc;
 };
 
 static std::vector<TestSample> samples;
+// Path metric counters of the last decoded frame for decoders that have them
+static std::optional<MetricCounters> frame_metric_counters;
+// Set when the counters were replayed in scalar code instead of counted inside the decoder
+static bool is_frame_metric_counters_simulated = false;
+// Heap usage of constructing the decoder under test
+static std::optional<AllocStats> create_alloc_stats;
+// Registry entry that a dispatched decoder resolved to
+static const char* dispatch_engine = nullptr;
+
+struct CreateSample {
+    uint64_t create_ns = 0;             // includes building the branch table
+    uint64_t branch_table_ns = 0;
+    uint64_t warmup_update_ns = 0;      // first update on a freshly created decoder
+    uint64_t destroy_ns = 0;
+};
+
+// Startup cost of decoders for tests that sample it
+static struct {
+    std::vector<CreateSample> samples;
+    bool has_branch_table = false;
+} create_benchmark;
+
+// Encoder tests have no decode phases so they are timed here instead
+// Their symbols are compared against the test frame's in place of decoded bit errors
+static struct {
+    std::vector<uint64_t> samples;
+    size_t total_symbol_errors = 0;
+} encode_benchmark;
 
 struct Test {
     size_t K;
@@ -49,6 +113,13 @@ struct Test {
     size_t minimum_samples;
     std::vector<uint8_t> x_in;
     std::vector<uint8_t> x_out;
+    std::vector<int8_t> y_int8;     // Full scale symbols shared by all ka9q and spiral decoders
+    // Received BPSK symbols when frames go through the noisy channel, each decoder quantises them to its own format
+    std::optional<float> channel_ebno_db;
+    std::vector<float> y_bpsk;
+    // Terminated noiseless frames always end with the zero state having the best path metric
+    // Noise or a stream cut off partway through the trellis can leave any state with the best metric
+    bool is_zero_best_state = true;
 };
 
 struct TestResult {
@@ -77,6 +148,75 @@ void print_array(tcb::span<const T> data, const std::function<U(const T&)> trans
     fprintf(fp_out, "]");
 }
 
+// Hardware counters for each phase are only written out if they could be opened
+void print_perf_counters() {
+    const auto& group = PerfCounterGroup::get();
+    struct Phase {
+        const char* name;
+        PerfCounts TestSample::*counts;
+    };
+    const Phase phases[] = {
+        { "init", &TestSample::init_perf },
+        { "update", &TestSample::update_symbols_perf },
+        { "chainback", &TestSample::chainback_bits_perf },
+        { "best_state", &TestSample::best_state_perf },
+    };
+    constexpr size_t TOTAL_PHASES = sizeof(phases)/sizeof(phases[0]);
+    fprintf(fp_out, "  \"perf_counters\": {\n");
+    for (size_t i = 0; i < TOTAL_PHASES; i++) {
+        const auto& phase = phases[i];
+        fprintf(fp_out, "    \"%s\": {\n", phase.name);
+        bool has_previous_counter = false;
+        for (size_t j = 0; j < TOTAL_PERF_COUNTERS; j++) {
+            if (!group.is_available(PerfCounterType(j))) continue;
+            if (has_previous_counter) fprintf(fp_out, ",\n");
+            has_previous_counter = true;
+            fprintf(fp_out, "      \"%s\": ", PERF_COUNTER_NAMES[j]);
+            print_array<TestSample, uint64_t>(samples, [&](const TestSample& sample) { return (sample.*phase.counts).values[j]; }, "%zu");
+        }
+        fprintf(fp_out, "\n    }%s\n", (i != (TOTAL_PHASES-1)) ? "," : "");
+    }
+    fprintf(fp_out, "  }");
+}
+
+void print_alloc_stats(const AllocStats& stats) {
+    fprintf(fp_out, "{ \"allocations\": %zu, \"bytes_allocated\": %zu, \"bytes_in_use\": %lld, \"rss_bytes\": %lld, \"peak_rss_bytes\": %zu }",
+        size_t(stats.allocations), size_t(stats.bytes_allocated),
+        (long long)(stats.bytes_in_use), (long long)(stats.rss_bytes), size_t(stats.peak_rss_bytes));
+}
+
+// Heap usage of each phase is taken from the first sample since that is when a fresh decoder touches its buffers
+// Later samples should reuse them so any allocations they make are summed into steady_allocations
+void print_memory() {
+    struct Phase {
+        const char* name;
+        AllocStats TestSample::*stats;
+    };
+    const Phase phases[] = {
+        { "reset", &TestSample::init_alloc },
+        { "update", &TestSample::update_symbols_alloc },
+        { "chainback", &TestSample::chainback_bits_alloc },
+    };
+    fprintf(fp_out, "  \"memory\": {\n");
+    if (create_alloc_stats.has_value()) {
+        fprintf(fp_out, "    \"create\": ");
+        print_alloc_stats(create_alloc_stats.value());
+        fprintf(fp_out, ",\n");
+        create_alloc_stats.reset();
+    }
+    uint64_t steady_allocations = 0u;
+    for (const auto& phase: phases) {
+        fprintf(fp_out, "    \"%s\": ", phase.name);
+        print_alloc_stats(samples.empty() ? AllocStats() : samples[0].*phase.stats);
+        fprintf(fp_out, ",\n");
+        for (size_t i = 1; i < samples.size(); i++) {
+            steady_allocations += (samples[i].*phase.stats).allocations;
+        }
+    }
+    fprintf(fp_out, "    \"steady_allocations\": %zu\n", size_t(steady_allocations));
+    fprintf(fp_out, "  }");
+}
+
 TestResult print_test(const char* name, const Test& test) {
     if (json_writer.has_previous_object) {
         fprintf(fp_out, ",\n");
@@ -86,6 +226,10 @@ TestResult print_test(const char* name, const Test& test) {
     fprintf(fp_out, "  \"name\": \"%s\",\n", name);
     fprintf(fp_out, "  \"K\": %zu,\n", test.K);
     fprintf(fp_out, "  \"R\": %zu,\n", test.R);
+    if (dispatch_engine != nullptr) {
+        fprintf(fp_out, "  \"engine\": \"%s\",\n", dispatch_engine);
+        dispatch_engine = nullptr;
+    }
     fprintf(fp_out, "  \"poly\": ");
     print_array<int>({ test.poly, test.R }, "%d");
     fprintf(fp_out, ",\n");
@@ -95,6 +239,9 @@ TestResult print_test(const char* name, const Test& test) {
     fprintf(fp_out, "  \"total_output_symbols\": %zu,\n", test.total_output_symbols);
     fprintf(fp_out, "  \"sampling_time\": %f,\n", test.sampling_time);
     fprintf(fp_out, "  \"minimum_samples\": %zu,\n", test.minimum_samples);
+    if (test.channel_ebno_db.has_value()) {
+        fprintf(fp_out, "  \"channel_ebno_db\": %f,\n", test.channel_ebno_db.value());
+    }
 
     fprintf(fp_out, "  \"total_samples\": %zu,\n", samples.size());
     fprintf(fp_out, "  \"init_ns\": ");
@@ -103,12 +250,92 @@ TestResult print_test(const char* name, const Test& test) {
     fprintf(fp_out, "  \"update_ns\": ");
     print_array<TestSample, uint64_t>(samples, [](const TestSample& sample) { return sample.update_symbols_ns; }, "%zu");
     fprintf(fp_out, ",\n");
+    if (frame_metric_counters.has_value()) {
+        const auto& counters = frame_metric_counters.value();
+        const double mean_spread = (counters.total_bits > 0u) ? double(counters.total_metric_spread)/double(counters.total_bits) : 0.0;
+        fprintf(fp_out, "  \"metric_counters\": {\n");
+        fprintf(fp_out, "    \"is_simulated\": %s,\n", is_frame_metric_counters_simulated ? "true" : "false");
+        fprintf(fp_out, "    \"total_bits\": %zu,\n", size_t(counters.total_bits));
+        fprintf(fp_out, "    \"renormalisations\": %zu,\n", size_t(counters.renormalisations));
+        fprintf(fp_out, "    \"saturated_metrics\": %zu,\n", size_t(counters.saturated_metrics));
+        fprintf(fp_out, "    \"max_metric_spread\": %zu,\n", size_t(counters.max_metric_spread));
+        fprintf(fp_out, "    \"mean_metric_spread\": %f\n", mean_spread);
+        fprintf(fp_out, "  },\n");
+        frame_metric_counters.reset();
+        is_frame_metric_counters_simulated = false;
+    }
     fprintf(fp_out, "  \"chainback_ns\": ");
     print_array<TestSample, uint64_t>(samples, [](const TestSample& sample) { return sample.chainback_bits_ns; }, "%zu");
     fprintf(fp_out, ",\n");
+    fprintf(fp_out, "  \"best_state_ns\": ");
+    print_array<TestSample, uint64_t>(samples, [](const TestSample& sample) { return sample.best_state_ns; }, "%zu");
+    fprintf(fp_out, ",\n");
+    if (!create_benchmark.samples.empty()) {
+        const auto& create_samples = create_benchmark.samples;
+        fprintf(fp_out, "  \"total_create_samples\": %zu,\n", create_samples.size());
+        fprintf(fp_out, "  \"create_ns\": ");
+        print_array<CreateSample, uint64_t>(create_samples, [](const CreateSample& sample) { return sample.create_ns; }, "%zu");
+        fprintf(fp_out, ",\n");
+        if (create_benchmark.has_branch_table) {
+            fprintf(fp_out, "  \"branch_table_ns\": ");
+            print_array<CreateSample, uint64_t>(create_samples, [](const CreateSample& sample) { return sample.branch_table_ns; }, "%zu");
+            fprintf(fp_out, ",\n");
+        }
+        fprintf(fp_out, "  \"warmup_update_ns\": ");
+        print_array<CreateSample, uint64_t>(create_samples, [](const CreateSample& sample) { return sample.warmup_update_ns; }, "%zu");
+        fprintf(fp_out, ",\n");
+        fprintf(fp_out, "  \"destroy_ns\": ");
+        print_array<CreateSample, uint64_t>(create_samples, [](const CreateSample& sample) { return sample.destroy_ns; }, "%zu");
+        fprintf(fp_out, ",\n");
+        create_benchmark.samples.clear();
+        create_benchmark.has_branch_table = false;
+    }
+    const bool is_encode_test = !encode_benchmark.samples.empty();
+    if (is_encode_test) {
+        fprintf(fp_out, "  \"total_encode_samples\": %zu,\n", encode_benchmark.samples.size());
+        fprintf(fp_out, "  \"encode_ns\": ");
+        print_array<uint64_t>(encode_benchmark.samples, "%zu");
+        fprintf(fp_out, ",\n");
+        encode_benchmark.samples.clear();
+    }
+    if (EnergyMeter::get().is_enabled()) {
+        fprintf(fp_out, "  \"update_energy_uj\": ");
+        print_array<TestSample, uint64_t>(samples, [](const TestSample& sample) { return sample.update_symbols_energy_uj; }, "%zu");
+        fprintf(fp_out, ",\n");
+        fprintf(fp_out, "  \"chainback_energy_uj\": ");
+        print_array<TestSample, uint64_t>(samples, [](const TestSample& sample) { return sample.chainback_bits_energy_uj; }, "%zu");
+        fprintf(fp_out, ",\n");
+    }
+    if (TscCalibration::is_available()) {
+        const auto& tsc = TscCalibration::get();
+        fprintf(fp_out, "  \"tsc_frequency_hz\": %f,\n", tsc.frequency_hz);
+        fprintf(fp_out, "  \"tsc_overhead_cycles\": %zu,\n", size_t(tsc.overhead_cycles));
+        fprintf(fp_out, "  \"init_cycles\": ");
+        print_array<TestSample, uint64_t>(samples, [](const TestSample& sample) { return sample.init_cycles; }, "%zu");
+        fprintf(fp_out, ",\n");
+        fprintf(fp_out, "  \"update_cycles\": ");
+        print_array<TestSample, uint64_t>(samples, [](const TestSample& sample) { return sample.update_symbols_cycles; }, "%zu");
+        fprintf(fp_out, ",\n");
+        fprintf(fp_out, "  \"chainback_cycles\": ");
+        print_array<TestSample, uint64_t>(samples, [](const TestSample& sample) { return sample.chainback_bits_cycles; }, "%zu");
+        fprintf(fp_out, ",\n");
+        fprintf(fp_out, "  \"best_state_cycles\": ");
+        print_array<TestSample, uint64_t>(samples, [](const TestSample& sample) { return sample.best_state_cycles; }, "%zu");
+        fprintf(fp_out, ",\n");
+    }
+    if (PerfCounterGroup::get().is_available()) {
+        print_perf_counters();
+        fprintf(fp_out, ",\n");
+    }
+    if (is_alloc_tracking_available()) {
+        print_memory();
+        fprintf(fp_out, ",\n");
+    }
 
-    const size_t total_bits = test.x_out.size()*8;
-    const size_t total_bit_errors = get_total_bit_errors(test.x_in.data(), test.x_out.data(), test.x_in.size());
+    const size_t total_bits = is_encode_test ? test.total_output_symbols : test.x_out.size()*8;
+    const size_t total_bit_errors = is_encode_test ?
+        encode_benchmark.total_symbol_errors :
+        get_total_bit_errors(test.x_in.data(), test.x_out.data(), test.x_in.size());
     const float bit_error_rate = float(total_bit_errors) / float(total_bits);
     fprintf(fp_out, "  \"total_bits\": %zu,\n", total_bits);
     fprintf(fp_out, "  \"total_bit_errors\": %zu,\n", total_bit_errors);
@@ -117,8 +344,47 @@ TestResult print_test(const char* name, const Test& test) {
     return { bit_error_rate };
 }
 
+// Encode the test frame with the fastest encoder the cpu supports
+template <typename T>
+void encode_test_frame(const Test& test, T* y_out, const size_t total_symbols, const T soft_decision_high, const T soft_decision_low) {
+    if (is_clmul_encoder_supported()) {
+        auto encoder = ConvolutionalEncoder_CLMUL(test.K, test.R, test.poly);
+        encoder.encode<T>(
+            test.x_in.data(), test.x_in.size(), y_out, total_symbols,
+            soft_decision_high, soft_decision_low
+        );
+    } else {
+        using reg_t = uint32_t;
+        auto encoder = ConvolutionalEncoder_ShiftRegister<reg_t>(test.K, test.R, test.poly);
+        encode_data<T>(
+            &encoder,
+            test.x_in.data(), test.x_in.size(), y_out, total_symbols,
+            soft_decision_high, soft_decision_low
+        );
+    }
+}
+
+// Symbols in a decoder's soft decision format
+// Noiseless frames are encoded straight to it while noisy frames are quantised from the received BPSK symbols
+template <typename soft_t>
+std::vector<soft_t> get_test_symbols(const Test& test, const soft_t soft_decision_high, const soft_t soft_decision_low) {
+    auto y_out = std::vector<soft_t>(test.total_output_symbols);
+    if (test.y_bpsk.empty()) {
+        encode_test_frame<soft_t>(test, y_out.data(), y_out.size(), soft_decision_high, soft_decision_low);
+        return y_out;
+    }
+    LLR_Quantiser quantiser;
+    quantiser.scale = float(soft_decision_high);
+    quantiser.limit = float(soft_decision_high);
+    quantise_llr(test.y_bpsk.data(), y_out.data(), y_out.size(), quantiser);
+    return y_out;
+}
+
 template <size_t K, size_t R>
-Test init_test(const int* poly, const size_t total_decode_bytes, const float sampling_time, const size_t minimum_samples) {
+Test init_test(
+    const int* poly, const size_t total_decode_bytes, const float sampling_time, const size_t minimum_samples,
+    const std::optional<float> channel_ebno_db = std::nullopt)
+{
     fprintf(fp_log, "[test_run]\n");
     fprintf(fp_log, "K=%zu, R=%zu\n", K, R);
     fprintf(fp_log, "total_input_bytes = %zu\n", total_decode_bytes);
@@ -142,29 +408,222 @@ Test init_test(const int* poly, const size_t total_decode_bytes, const float sam
     test.minimum_samples = minimum_samples;
     test.x_in = x_in;
     test.x_out.resize(total_decode_bytes);
+    if (channel_ebno_db.has_value()) {
+        fprintf(fp_log, "channel Eb/N0 = %.2f dB\n", channel_ebno_db.value());
+        test.channel_ebno_db = channel_ebno_db;
+        test.is_zero_best_state = false;
+        test.y_bpsk.resize(total_symbols);
+        encode_test_frame<float>(test, test.y_bpsk.data(), test.y_bpsk.size(), +1.0f, -1.0f);
+        auto channel = AWGN_Channel(0u);
+        channel.add_noise(test.y_bpsk.data(), test.y_bpsk.size(), AWGN_Channel::get_sigma(channel_ebno_db.value(), R));
+    }
+    // encode once since every third party decoder takes the same signed symbols
+    const auto config = get_ka9q_signed_config();
+    test.y_int8 = get_test_symbols<int8_t>(test, config.soft_decision_high, config.soft_decision_low);
     return test;
 }
 
-// test ours
-template <size_t K, size_t R, typename soft_t, typename error_t, class decoder_t>
-TestResult test_ours_single(const char* name, Test& test, Decoder_Config<soft_t, error_t> config) {
-    const size_t total_decode_bits = test.total_input_bytes*8;
-    const int* poly = test.poly;
-    const auto& x_in = test.x_in;
+// Cut the test frame off partway through the trellis like a stream that is decoded before it ends
+// The first half of the data is chained back from the best state and the K-1 bits after it are held in that state
+// Symbols are the start of the full frame's so decoders that take their own format truncate them the same way
+Test init_unterminated_test(const Test& test) {
+    auto cut = test;
+    cut.is_zero_best_state = false;
+    cut.total_input_bytes = test.total_input_bytes/2u;
+    cut.total_transmit_bits = cut.total_input_bytes*8u + test.K-1u;
+    cut.total_output_symbols = cut.total_transmit_bits*test.R;
+    cut.x_in.resize(cut.total_input_bytes);
+    cut.x_out.resize(cut.total_input_bytes);
+    cut.y_int8.resize(cut.total_output_symbols);
+    if (!cut.y_bpsk.empty()) cut.y_bpsk.resize(cut.total_output_symbols);
+    return cut;
+}
+
+// Repeatedly encode the test frame until the sampling time and minimum samples are reached
+// encode(y_out) writes full scale symbols which are checked against the scalar shift register encoder
+// rather than test.y_int8, since those come from the fastest encoder and may have been through the channel
+template <typename encode_t>
+void run_encode_samples(const char* name, const Test& test, encode_t&& encode) {
+    fprintf(fp_log, "- %s\r", name);
+    samples.clear();
+    encode_benchmark.samples.clear();
+    const auto config = get_ka9q_signed_config();
+    auto y_reference = std::vector<int8_t>(test.total_output_symbols);
+    {
+        using reg_t = uint32_t;
+        auto encoder = ConvolutionalEncoder_ShiftRegister<reg_t>(test.K, test.R, test.poly);
+        encode_data<int8_t>(
+            &encoder,
+            test.x_in.data(), test.x_in.size(), y_reference.data(), y_reference.size(),
+            config.soft_decision_high, config.soft_decision_low
+        );
+    }
+    auto y_out = std::vector<int8_t>(test.total_output_symbols);
+    Timer total_time;
+    for (size_t i = 0; ; i++) {
+        const float elapsed_seconds = float(total_time.get_delta<std::chrono::milliseconds>())*1e-3f;
+        if ((elapsed_seconds > test.sampling_time) && (i > test.minimum_samples)) break;
+        Timer t;
+        encode(y_out.data(), y_out.size());
+        encode_benchmark.samples.push_back(t.get_delta());
+    }
+    encode_benchmark.total_symbol_errors = 0;
+    for (size_t i = 0; i < y_out.size(); i++) {
+        if (y_out[i] != y_reference[i]) encode_benchmark.total_symbol_errors++;
+    }
+    auto times = encode_benchmark.samples;
+    std::sort(times.begin(), times.end());
+    const float bit_rate = float(test.total_input_bytes*8) / float(times[times.size()/2]) * 1e3f;
+    print_test(name, test);
+    fprintf(fp_log, "o %s (%.1f Mb/s)\n", name, bit_rate);
+}
+
+// Encoders run once per transmitted frame so time them over a range of frame sizes
+template <size_t K, size_t R>
+void test_encoders(const int* poly, const float sampling_time, const size_t minimum_samples) {
+    const size_t frame_sizes[] = { 64, 1024, 16384 };
+    const auto config = get_ka9q_signed_config();
+    for (const size_t total_input_bytes: frame_sizes) {
+        const auto test = init_test<K,R>(poly, total_input_bytes, sampling_time, minimum_samples);
+        using reg_t = uint32_t;
+        auto shift_register = ConvolutionalEncoder_ShiftRegister<reg_t>(K, R, poly);
+        run_encode_samples("encode_shift_register", test, [&](int8_t* y_out, const size_t total_symbols) {
+            shift_register.reset(0);
+            encode_data<int8_t>(
+                &shift_register,
+                test.x_in.data(), test.x_in.size(), y_out, total_symbols,
+                config.soft_decision_high, config.soft_decision_low
+            );
+        });
+        if (is_clmul_encoder_supported()) {
+            auto clmul = ConvolutionalEncoder_CLMUL(K, R, poly);
+            run_encode_samples("encode_clmul", test, [&](int8_t* y_out, const size_t total_symbols) {
+                clmul.encode<int8_t>(
+                    test.x_in.data(), test.x_in.size(), y_out, total_symbols,
+                    config.soft_decision_high, config.soft_decision_low
+                );
+            });
+        }
+    }
+}
+
+// Our decoder core doesn't expose its metric buffer so we search through the accumulated error of each state
+template <size_t K, size_t R, typename error_t, typename soft_t>
+size_t get_best_state(ViterbiDecoder_Core<K,R,error_t,soft_t>& core) {
+    constexpr size_t NUMSTATES = size_t(1) << (K-1u);
+    size_t best_state = 0;
+    uint64_t best_error = core.get_error(0);
+    for (size_t state = 1; state < NUMSTATES; state++) {
+        const uint64_t error = core.get_error(state);
+        if (error < best_error) {
+            best_error = error;
+            best_state = state;
+        }
+    }
+    return best_state;
+}
+
+static void check_best_state(const Test& test, const size_t best_state) {
+    if (!test.is_zero_best_state) return;
+    if (best_state != 0) {
+        fprintf(fp_log, "\nBest state search gave %zu for a terminated frame\n", best_state);
+    }
+}
+
+#if VITERBI_METRIC_COUNTERS
+// Our decoder core doesn't expose its metrics during update so replay its saturating arithmetic with the same config
+// This is a scalar model of the core rather than the core itself so its output is marked as simulated
+// This runs outside of the timed loop so counting doesn't skew the throughput it is compared against
+template <size_t K, size_t R, typename soft_t, typename error_t>
+MetricCounters replay_metric_counters(const int* poly, const Decoder_Config<soft_t, error_t>& config, const soft_t* symbols, const size_t total_symbols) {
+    constexpr size_t NUMSTATES = size_t(1) << (K-1u);
+    constexpr uint64_t CEILING = uint64_t(std::numeric_limits<error_t>::max());
+    const auto& decoder_config = config.decoder_config;
+    auto branch_table = std::vector<soft_t>(R*NUMSTATES/2u);
+    for (size_t s = 0u; s < NUMSTATES/2u; s++) {
+        for (size_t i = 0u; i < R; i++) {
+            const bool is_high = get_parity(uint32_t(s << 1u) & uint32_t(poly[i])) != 0u;
+            branch_table[i*NUMSTATES/2u + s] = is_high ? config.soft_decision_high : config.soft_decision_low;
+        }
+    }
+    auto old_metrics = std::vector<error_t>(NUMSTATES, decoder_config.initial_non_start_error);
+    auto new_metrics = std::vector<error_t>(NUMSTATES);
+    old_metrics[0] = decoder_config.initial_start_error;
+    auto saturating_add = [](const error_t a, const uint64_t b) {
+        const uint64_t x = uint64_t(a) + b;
+        return error_t((x > CEILING) ? CEILING : x);
+    };
+    MetricCounters counters;
+    for (size_t i = 0u; i < total_symbols; i += R) {
+        for (size_t s = 0u; s < NUMSTATES/2u; s++) {
+            uint64_t error = 0u;
+            for (size_t j = 0u; j < R; j++) {
+                const int64_t delta = int64_t(branch_table[j*NUMSTATES/2u + s]) - int64_t(symbols[i+j]);
+                error += uint64_t((delta < 0) ? -delta : delta);
+            }
+            const uint64_t inverse_error = uint64_t(decoder_config.soft_decision_max_error) - error;
+            const error_t m0 = saturating_add(old_metrics[s], error);
+            const error_t m1 = saturating_add(old_metrics[s+NUMSTATES/2u], inverse_error);
+            const error_t m2 = saturating_add(old_metrics[s], inverse_error);
+            const error_t m3 = saturating_add(old_metrics[s+NUMSTATES/2u], error);
+            new_metrics[2u*s]    = (m0 < m1) ? m0 : m1;
+            new_metrics[2u*s+1u] = (m2 < m3) ? m2 : m3;
+        }
+        const bool is_renormalised = new_metrics[0] >= decoder_config.renormalisation_threshold;
+        update_metric_counters<error_t>(counters, new_metrics.data(), NUMSTATES, error_t(CEILING), is_renormalised);
+        if (is_renormalised) {
+            error_t min = new_metrics[0];
+            for (const auto& x: new_metrics) min = (x < min) ? x : min;
+            for (auto& x: new_metrics) x -= min;
+        }
+        std::swap(old_metrics, new_metrics);
+    }
+    return counters;
+}
+#endif
+
+template <typename T, typename = void>
+struct has_metric_counters: std::false_type {};
+
+template <typename T>
+struct has_metric_counters<T, std::void_t<decltype(std::declval<T&>().get_metric_counters())>>: std::true_type {};
+
+// Repeatedly create, warm up and destroy a decoder until the sampling time and minimum samples are reached
+// create(sample) returns an owning pointer and records how long construction took into the sample
+template <typename create_t, typename warmup_t>
+void run_create_samples(const Test& test, create_t&& create, warmup_t&& warmup) {
+    Timer total_time;
+    create_benchmark.samples.clear();
+    for (size_t i = 0; ; i++) {
+        const float elapsed_seconds = float(total_time.get_delta<std::chrono::milliseconds>())*1e-3f;
+        if ((elapsed_seconds > test.sampling_time) && (i > test.minimum_samples)) break;
+        CreateSample sample;
+        auto decoder = create(sample);
+        {
+            Timer t;
+            warmup(*decoder);
+            sample.warmup_update_ns = t.get_delta();
+        }
+        {
+            Timer t;
+            decoder.reset();
+            sample.destroy_ns = t.get_delta();
+        }
+        create_benchmark.samples.push_back(sample);
+    }
+}
+
+// Sample each phase of a decoder until the sampling time and minimum samples are reached
+// Every timer and counter of a phase is wired in here so each test only supplies the phases
+template <typename reset_t, typename update_t, typename best_state_t, typename chainback_t>
+void collect_test_samples(
+    Test& test,
+    reset_t&& reset, update_t&& update, best_state_t&& get_best_state, chainback_t&& chainback)
+{
     auto& x_out = test.x_out;
-    using reg_t = uint32_t;
-    auto encoder = ConvolutionalEncoder_ShiftRegister<reg_t>(K, R, poly);
-    auto y_out = std::vector<soft_t>(test.total_output_symbols);
-    encode_data<soft_t>(
-        &encoder,
-        x_in.data(), x_in.size(), y_out.data(), y_out.size(),
-        config.soft_decision_high, config.soft_decision_low
-    );
-    auto branch_table = std::make_unique<ViterbiBranchTable<K,R,soft_t>>(poly, config.soft_decision_high, config.soft_decision_low);
-    auto core = std::make_unique<ViterbiDecoder_Core<K,R,error_t,soft_t>>(*branch_table, config.decoder_config);
-    core->set_traceback_length(total_decode_bits);
     Timer total_time;
     samples.clear();
+    size_t best_state = 0;
     for (size_t i = 0; ; i++) {
         const float elapsed_seconds = float(total_time.get_delta<std::chrono::milliseconds>())*1e-3f;
         if ((elapsed_seconds > test.sampling_time) && (i > test.minimum_samples)) break;
@@ -173,22 +632,111 @@ TestResult test_ours_single(const char* name, Test& test, Decoder_Config<soft_t,
             for (auto& x: x_out) x = 0x00;
         }
         {
+            AllocCounter alloc;
+            PerfCounters perf;
             Timer t;
-            core->reset();
+            TscTimer tsc;
+            reset();
+            sample.init_cycles = tsc.get_delta();
             sample.init_ns = t.get_delta();
+            sample.init_perf = perf.get_delta();
+            sample.init_alloc = alloc.get_delta();
         }
         {
+            EnergyCounter energy;
+            AllocCounter alloc;
+            PerfCounters perf;
             Timer t;
-            decoder_t::template update<uint64_t>(*core, y_out.data(), y_out.size());
+            TscTimer tsc;
+            update();
+            sample.update_symbols_cycles = tsc.get_delta();
             sample.update_symbols_ns = t.get_delta();
+            sample.update_symbols_perf = perf.get_delta();
+            sample.update_symbols_alloc = alloc.get_delta();
+            sample.update_symbols_energy_uj = energy.get_delta();
+        }
+        {
+            PerfCounters perf;
+            Timer t;
+            TscTimer tsc;
+            best_state = get_best_state();
+            sample.best_state_cycles = tsc.get_delta();
+            sample.best_state_ns = t.get_delta();
+            sample.best_state_perf = perf.get_delta();
         }
         {
+            EnergyCounter energy;
+            AllocCounter alloc;
+            PerfCounters perf;
             Timer t;
-            core->chainback(x_out.data(), total_decode_bits);
+            TscTimer tsc;
+            chainback();
+            sample.chainback_bits_cycles = tsc.get_delta();
             sample.chainback_bits_ns = t.get_delta();
+            sample.chainback_bits_perf = perf.get_delta();
+            sample.chainback_bits_alloc = alloc.get_delta();
+            sample.chainback_bits_energy_uj = energy.get_delta();
         }
         samples.push_back(sample);
     }
+    check_best_state(test, best_state);
+}
+
+template <typename reset_t, typename update_t, typename best_state_t, typename chainback_t>
+TestResult run_test_samples(
+    const char* name, Test& test,
+    reset_t&& reset, update_t&& update, best_state_t&& get_best_state, chainback_t&& chainback)
+{
+    collect_test_samples(test, reset, update, get_best_state, chainback);
+    return print_test(name, test);
+}
+
+// test ours
+template <size_t K, size_t R, typename soft_t, typename error_t, class decoder_t>
+TestResult test_ours_single(const char* name, Test& test, Decoder_Config<soft_t, error_t> config) {
+    const size_t total_decode_bits = test.total_input_bytes*8;
+    const int* poly = test.poly;
+    auto& x_out = test.x_out;
+    const auto y_out = get_test_symbols<soft_t>(test, config.soft_decision_high, config.soft_decision_low);
+    AllocCounter create_alloc;
+    auto branch_table = std::make_unique<ViterbiBranchTable<K,R,soft_t>>(poly, config.soft_decision_high, config.soft_decision_low);
+    auto core = std::make_unique<ViterbiDecoder_Core<K,R,error_t,soft_t>>(*branch_table, config.decoder_config);
+    core->set_traceback_length(total_decode_bits);
+    create_alloc_stats = create_alloc.get_delta();
+    collect_test_samples(test,
+        [&]() { core->reset(); },
+        [&]() { decoder_t::template update<uint64_t>(*core, y_out.data(), y_out.size()); },
+        [&]() { return get_best_state(*core); },
+        [&]() { core->chainback(x_out.data(), total_decode_bits); }
+    );
+#if VITERBI_METRIC_COUNTERS
+    frame_metric_counters = replay_metric_counters<K,R>(poly, config, y_out.data(), y_out.size());
+    is_frame_metric_counters_simulated = true;
+#endif
+    // Free the sampled decoder first since large constraint lengths would hold two sets of decisions
+    core.reset();
+    branch_table.reset();
+    struct Instance {
+        std::unique_ptr<ViterbiBranchTable<K,R,soft_t>> branch_table;
+        std::unique_ptr<ViterbiDecoder_Core<K,R,error_t,soft_t>> core;
+    };
+    run_create_samples(test,
+        [&](CreateSample& sample) {
+            auto instance = std::make_unique<Instance>();
+            Timer t;
+            instance->branch_table = std::make_unique<ViterbiBranchTable<K,R,soft_t>>(poly, config.soft_decision_high, config.soft_decision_low);
+            sample.branch_table_ns = t.get_delta();
+            instance->core = std::make_unique<ViterbiDecoder_Core<K,R,error_t,soft_t>>(*instance->branch_table, config.decoder_config);
+            instance->core->set_traceback_length(total_decode_bits);
+            sample.create_ns = t.get_delta();
+            return instance;
+        },
+        [&](Instance& instance) {
+            instance.core->reset();
+            decoder_t::template update<uint64_t>(*instance.core, y_out.data(), y_out.size());
+        }
+    );
+    create_benchmark.has_branch_table = true;
     return print_test(name, test);
 }
 
@@ -214,6 +762,26 @@ void test_ours(Test& test) {
         const auto result = test_ours_single<K,R,soft_t,error_t,decoder>("avx_u8", test, config);
         fprintf(fp_log, "o avx_u8 (%.3f)\n", result.bit_error_rate);
     }
+    {
+        fprintf(fp_log, "- sse_u8_hard8\r");
+        fflush(fp_log);
+        using soft_t = int8_t;
+        using error_t = uint8_t;
+        using decoder = ViterbiDecoder_SSE_u8<K,R>;
+        auto config = get_hard8_decoding_config(R);
+        const auto result = test_ours_single<K,R,soft_t,error_t,decoder>("sse_u8_hard8", test, config);
+        fprintf(fp_log, "o sse_u8_hard8 (%.3f)\n", result.bit_error_rate);
+    }
+    {
+        fprintf(fp_log, "- avx_u8_hard8\r");
+        fflush(fp_log);
+        using soft_t = int8_t;
+        using error_t = uint8_t;
+        using decoder = ViterbiDecoder_AVX_u8<K,R>;
+        auto config = get_hard8_decoding_config(R);
+        const auto result = test_ours_single<K,R,soft_t,error_t,decoder>("avx_u8_hard8", test, config);
+        fprintf(fp_log, "o avx_u8_hard8 (%.3f)\n", result.bit_error_rate);
+    }
     {
         fprintf(fp_log, "- sse_u16\r");
         fflush(fp_log);
@@ -236,65 +804,542 @@ void test_ours(Test& test) {
     }
 }
 
-template <size_t K, size_t R, typename decoder_t>
-TestResult test_third_party(const char* name, Test& test) {
+// Start from floating point LLRs and quantise them either as a separate pass over the frame
+// or one block at a time inside the update loop
+template <size_t K, size_t R, typename soft_t, typename error_t, class decoder_t>
+TestResult test_ours_llr_single(const char* name, Test& test, Decoder_Config<soft_t, error_t> config, const bool is_fused) {
     const size_t total_decode_bits = test.total_input_bytes*8;
     const int* poly = test.poly;
-    const auto& x_in = test.x_in;
-    auto& x_out = test.x_out;
     using reg_t = uint32_t;
     auto encoder = ConvolutionalEncoder_ShiftRegister<reg_t>(K, R, poly);
-    auto decoder = decoder_t(poly, test.total_transmit_bits);
-    auto config = get_ka9q_offset_binary_config();
-    auto y_out = std::vector<uint8_t>(test.total_output_symbols);
-    encode_data<uint8_t>(
-        &encoder,
-        x_in.data(), x_in.size(), y_out.data(), y_out.size(),
-        config.soft_decision_high, config.soft_decision_low
+    auto llr = test.y_bpsk;
+    if (llr.empty()) {
+        llr.resize(test.total_output_symbols);
+        encode_data<float>(&encoder, test.x_in.data(), test.x_in.size(), llr.data(), llr.size(), +1.0f, -1.0f);
+    }
+    LLR_Quantiser quantiser;
+    quantiser.scale = float(config.soft_decision_high);
+    quantiser.limit = float(config.soft_decision_high);
+    auto y_out = std::vector<soft_t>(is_fused ? 0 : test.total_output_symbols);
+    AllocCounter create_alloc;
+    auto branch_table = std::make_unique<ViterbiBranchTable<K,R,soft_t>>(poly, config.soft_decision_high, config.soft_decision_low);
+    auto core = std::make_unique<ViterbiDecoder_Core<K,R,error_t,soft_t>>(*branch_table, config.decoder_config);
+    core->set_traceback_length(total_decode_bits);
+    create_alloc_stats = create_alloc.get_delta();
+    return run_test_samples(
+        name, test,
+        [&]() { core->reset(); },
+        [&]() {
+            if (is_fused) {
+                update_with_quantised_llr<R,soft_t>(llr.data(), llr.size(), quantiser, [&](const soft_t* symbols, size_t total_symbols) {
+                    decoder_t::template update<uint64_t>(*core, symbols, total_symbols);
+                });
+            } else {
+                quantise_llr(llr.data(), y_out.data(), llr.size(), quantiser);
+                decoder_t::template update<uint64_t>(*core, y_out.data(), y_out.size());
+            }
+        },
+        [&]() { return get_best_state(*core); },
+        [&]() { core->chainback(test.x_out.data(), total_decode_bits); }
     );
-    Timer total_time;
-    samples.clear();
-    for (size_t i = 0; ; i++) {
-        const float elapsed_seconds = float(total_time.get_delta<std::chrono::milliseconds>())*1e-3f;
-        if ((elapsed_seconds > test.sampling_time) && (i > test.minimum_samples)) break;
-        TestSample sample;
-        {
-            for (auto& x: x_out) x = 0x00;
+}
+
+template <size_t K, size_t R>
+void test_ours_llr(Test& test) {
+    for (const bool is_fused: { false, true }) {
+        const char* name = is_fused ? "avx_u8_llr_fused" : "avx_u8_llr";
+        fprintf(fp_log, "- %s\r", name);
+        fflush(fp_log);
+        using decoder = ViterbiDecoder_AVX_u8<K,R>;
+        auto config = get_soft8_decoding_config(R);
+        const auto result = test_ours_llr_single<K,R,int8_t,uint8_t,decoder>(name, test, config, is_fused);
+        fprintf(fp_log, "o %s (%.3f)\n", name, result.bit_error_rate);
+    }
+    for (const bool is_fused: { false, true }) {
+        const char* name = is_fused ? "avx_u16_llr_fused" : "avx_u16_llr";
+        fprintf(fp_log, "- %s\r", name);
+        fflush(fp_log);
+        using decoder = ViterbiDecoder_AVX_u16<K,R>;
+        auto config = get_soft16_decoding_config(R);
+        const auto result = test_ours_llr_single<K,R,int16_t,uint16_t,decoder>(name, test, config, is_fused);
+        fprintf(fp_log, "o %s (%.3f)\n", name, result.bit_error_rate);
+    }
+}
+
+// Compare fixed soft8 scaling against adaptive scaling on a noisy channel at the same bit error rate
+template <size_t K, size_t R>
+void test_ours_adaptive(Test& test, const float ebno_db) {
+    using soft_t = int8_t;
+    using error_t = uint8_t;
+    using decoder_t = ViterbiDecoder_AVX_u8<K,R>;
+    const size_t total_decode_bits = test.total_input_bytes*8;
+    const int* poly = test.poly;
+    using reg_t = uint32_t;
+    auto encoder = ConvolutionalEncoder_ShiftRegister<reg_t>(K, R, poly);
+    auto llr = std::vector<float>(test.total_output_symbols);
+    encode_data<float>(&encoder, test.x_in.data(), test.x_in.size(), llr.data(), llr.size(), +1.0f, -1.0f);
+    auto channel = AWGN_Channel(0u);
+    channel.add_noise(llr.data(), llr.size(), AWGN_Channel::get_sigma(ebno_db, R));
+
+    SymbolStatistics statistics;
+    statistics.update(llr.data(), llr.size());
+    auto y_out = std::vector<soft_t>(test.total_output_symbols);
+    // Noise can leave any state with the best metric
+    auto noisy_test = test;
+    noisy_test.is_zero_best_state = false;
+    auto run = [&](const char* name, const int8_t magnitude) {
+        fprintf(fp_log, "- %s\r", name);
+        fflush(fp_log);
+        const auto config = get_scaled8_decoding_config(R, magnitude);
+        quantise_llr(llr.data(), y_out.data(), y_out.size(), AdaptiveSoftScaler::get_quantiser(statistics, magnitude));
+        AllocCounter create_alloc;
+        auto branch_table = std::make_unique<ViterbiBranchTable<K,R,soft_t>>(poly, config.soft_decision_high, config.soft_decision_low);
+        auto core = std::make_unique<ViterbiDecoder_Core<K,R,error_t,soft_t>>(*branch_table, config.decoder_config);
+        core->set_traceback_length(total_decode_bits);
+        create_alloc_stats = create_alloc.get_delta();
+        const auto result = run_test_samples(
+            name, noisy_test,
+            [&]() { core->reset(); },
+            [&]() { decoder_t::template update<uint64_t>(*core, y_out.data(), y_out.size()); },
+            [&]() { return get_best_state(*core); },
+            [&]() { core->chainback(noisy_test.x_out.data(), total_decode_bits); }
+        );
+        fprintf(fp_log, "o %s (%.3f) magnitude=%d\n", name, result.bit_error_rate, int(magnitude));
+    };
+
+    // Fixed scaling matches the soft8 config
+    AdaptiveScalingConfig scaling_config;
+    run("avx_u8_awgn_fixed", scaling_config.max_magnitude);
+
+    // Pilot frames have their own data and noise so the benchmarked frame is never seen during training
+    // Seed 0 is the benchmarked frame so pilots start from 1
+    struct PilotFrame {
+        std::vector<uint8_t> x_in;
+        std::vector<float> llr;
+        SymbolStatistics statistics;
+    };
+    std::vector<PilotFrame> pilots;
+    auto get_pilot = [&](const size_t index) -> const PilotFrame& {
+        while (pilots.size() <= index) {
+            const uint64_t seed = uint64_t(pilots.size()) + 1u;
+            PilotFrame pilot;
+            pilot.x_in.resize(test.x_in.size());
+            auto data_rng = std::mt19937_64(seed);
+            for (auto& x: pilot.x_in) x = uint8_t(data_rng());
+            pilot.llr.resize(test.total_output_symbols);
+            encoder.reset(0);
+            encode_data<float>(&encoder, pilot.x_in.data(), pilot.x_in.size(), pilot.llr.data(), pilot.llr.size(), +1.0f, -1.0f);
+            auto pilot_channel = AWGN_Channel(seed);
+            pilot_channel.add_noise(pilot.llr.data(), pilot.llr.size(), AWGN_Channel::get_sigma(ebno_db, R));
+            pilot.statistics.update(pilot.llr.data(), pilot.llr.size());
+            pilots.push_back(std::move(pilot));
         }
-        {
-            Timer t;
-            decoder.reset();
-            sample.init_ns = t.get_delta();
+        return pilots[index];
+    };
+    auto pilot_y = std::vector<soft_t>(test.total_output_symbols);
+    auto pilot_x_out = std::vector<uint8_t>(test.x_in.size());
+    int8_t training_magnitude = 0;
+    std::unique_ptr<ViterbiBranchTable<K,R,soft_t>> training_branch_table;
+    std::unique_ptr<ViterbiDecoder_Core<K,R,error_t,soft_t>> training_core;
+    AdaptiveSoftScaler scaler(scaling_config);
+    scaler.update(statistics, [&](const int8_t magnitude, const size_t frame) {
+        if (magnitude != training_magnitude) {
+            const auto config = get_scaled8_decoding_config(R, magnitude);
+            training_branch_table = std::make_unique<ViterbiBranchTable<K,R,soft_t>>(poly, config.soft_decision_high, config.soft_decision_low);
+            training_core = std::make_unique<ViterbiDecoder_Core<K,R,error_t,soft_t>>(*training_branch_table, config.decoder_config);
+            training_core->set_traceback_length(total_decode_bits);
+            training_magnitude = magnitude;
         }
-        {
-            Timer t;
-            decoder.update(y_out.data(), y_out.size());
-            sample.update_symbols_ns = t.get_delta();
+        const auto& pilot = get_pilot(frame);
+        quantise_llr(pilot.llr.data(), pilot_y.data(), pilot_y.size(), AdaptiveSoftScaler::get_quantiser(pilot.statistics, magnitude));
+        training_core->reset();
+        decoder_t::template update<uint64_t>(*training_core, pilot_y.data(), pilot_y.size());
+        // Some chainbacks only set bits so clear the output like the benchmark does
+        for (auto& x: pilot_x_out) x = 0x00;
+        training_core->chainback(pilot_x_out.data(), total_decode_bits);
+        return get_total_bit_errors(pilot.x_in.data(), pilot_x_out.data(), pilot.x_in.size());
+    });
+    fprintf(fp_log, "adaptive scaling trained on %zu pilot frames\n", pilots.size());
+    run("avx_u8_awgn_adaptive", scaler.get_magnitude());
+}
+
+// Compare u8 with u16 fallback against pure u8 and u16 kernels across noise levels
+// Symbols use the largest range the u8 kernel supports so that saturation can occur
+template <size_t K, size_t R>
+void test_hybrid(Test& test) {
+    constexpr int8_t soft_decision_max = int8_t(63u/R);
+    const size_t total_decode_bits = test.total_input_bytes*8;
+    const int* poly = test.poly;
+    using reg_t = uint32_t;
+    auto encoder = ConvolutionalEncoder_ShiftRegister<reg_t>(K, R, poly);
+    auto llr = std::vector<float>(test.total_output_symbols);
+    auto y_out = std::vector<int8_t>(test.total_output_symbols);
+    LLR_Quantiser quantiser;
+    quantiser.scale = float(soft_decision_max);
+    quantiser.limit = float(soft_decision_max);
+    struct Mode {
+        const char* name;
+        HybridDecoderMode mode;
+    };
+    const Mode modes[3] = {
+        { "hybrid_u8_only", HybridDecoderMode::U8_ONLY },
+        { "hybrid_u16_only", HybridDecoderMode::U16_ONLY },
+        { "hybrid", HybridDecoderMode::HYBRID },
+    };
+    // Noise can leave any state with the best metric
+    auto noisy_test = test;
+    noisy_test.is_zero_best_state = false;
+    for (const float ebno_db: { 2.0f, 4.0f, 8.0f }) {
+        encode_data<float>(&encoder, test.x_in.data(), test.x_in.size(), llr.data(), llr.size(), +1.0f, -1.0f);
+        auto channel = AWGN_Channel(0u);
+        channel.add_noise(llr.data(), llr.size(), AWGN_Channel::get_sigma(ebno_db, R));
+        quantise_llr(llr.data(), y_out.data(), y_out.size(), quantiser);
+        for (const auto& mode: modes) {
+            char name[64];
+            snprintf(name, sizeof(name), "%s_%gdB", mode.name, ebno_db);
+            fprintf(fp_log, "- %s\r", name);
+            fflush(fp_log);
+            AllocCounter create_alloc;
+            auto decoder = std::make_unique<ViterbiDecoder_Hybrid<K,R>>(poly, test.total_transmit_bits, soft_decision_max, mode.mode);
+            create_alloc_stats = create_alloc.get_delta();
+            const auto result = run_test_samples(
+                name, noisy_test,
+                [&]() { decoder->reset(); },
+                [&]() { decoder->update(y_out.data(), y_out.size()); },
+                [&]() { return decoder->get_best_state(); },
+                [&]() { decoder->chainback(noisy_test.x_out.data(), total_decode_bits); }
+            );
+            fprintf(fp_log, "o %s (%.3f) fallback_blocks=%zu\n", name, result.bit_error_rate, decoder->get_total_fallback_blocks());
         }
-        {
-            Timer t;
-            decoder.chainback(x_out.data(), total_decode_bits);
-            sample.chainback_bits_ns = t.get_delta();
+    }
+    // Stream cut off partway through the trellis is chained back from the best state of whichever kernel ran last
+    {
+        const char* name = "hybrid_unterminated";
+        fprintf(fp_log, "- %s\r", name);
+        fflush(fp_log);
+        auto cut_test = init_unterminated_test(test);
+        const size_t total_cut_bits = cut_test.total_input_bytes*8;
+        const auto y_cut = get_test_symbols<int8_t>(test, soft_decision_max, int8_t(-soft_decision_max));
+        AllocCounter create_alloc;
+        auto decoder = std::make_unique<ViterbiDecoder_Hybrid<K,R>>(poly, cut_test.total_transmit_bits, soft_decision_max, HybridDecoderMode::HYBRID);
+        create_alloc_stats = create_alloc.get_delta();
+        size_t best_state = 0;
+        const auto result = run_test_samples(
+            name, cut_test,
+            [&]() { decoder->reset(); },
+            [&]() { decoder->update(y_cut.data(), cut_test.total_output_symbols); },
+            [&]() { return best_state = decoder->get_best_state(); },
+            [&]() { decoder->chainback(cut_test.x_out.data(), total_cut_bits, best_state); }
+        );
+        fprintf(fp_log, "o %s (%.3f)\n", name, result.bit_error_rate);
+    }
+}
+
+// Hard decision symbols packed 8 to a byte instead of being expanded to hard8 soft symbols
+template <size_t K, size_t R>
+std::vector<uint8_t> encode_hard_packed(const Test& test) {
+    using reg_t = uint32_t;
+    auto encoder = ConvolutionalEncoder_ShiftRegister<reg_t>(K, R, test.poly);
+    auto y_out = std::vector<uint8_t>((test.total_output_symbols+7u)/8u);
+    if (test.y_bpsk.empty()) {
+        encode_data_hard_packed(&encoder, test.x_in.data(), test.x_in.size(), y_out.data(), y_out.size());
+    } else {
+        quantise_llr_hard_packed(test.y_bpsk.data(), y_out.data(), test.total_output_symbols);
+    }
+    return y_out;
+}
+
+template <size_t K, size_t R>
+TestResult test_hard_packed_single(const char* name, Test& test) {
+    const size_t total_decode_bits = test.total_input_bytes*8;
+    AllocCounter create_alloc;
+    auto decoder = std::make_unique<ViterbiDecoder_HardPacked<K,R>>(test.poly, test.total_transmit_bits);
+    create_alloc_stats = create_alloc.get_delta();
+    const auto y_out = encode_hard_packed<K,R>(test);
+    return run_test_samples(
+        name, test,
+        [&]() { decoder->reset(); },
+        [&]() { decoder->update(y_out.data(), test.total_output_symbols); },
+        [&]() { return decoder->get_best_state(); },
+        [&]() { decoder->chainback(test.x_out.data(), total_decode_bits); }
+    );
+}
+
+// Packed symbols are the start of the full frame's so the stream is cut off partway through the trellis
+template <size_t K, size_t R>
+TestResult test_hard_packed_unterminated(const char* name, const Test& test) {
+    auto cut_test = init_unterminated_test(test);
+    const size_t total_cut_bits = cut_test.total_input_bytes*8;
+    AllocCounter create_alloc;
+    auto decoder = std::make_unique<ViterbiDecoder_HardPacked<K,R>>(test.poly, cut_test.total_transmit_bits);
+    create_alloc_stats = create_alloc.get_delta();
+    const auto y_out = encode_hard_packed<K,R>(test);
+    size_t best_state = 0;
+    return run_test_samples(
+        name, cut_test,
+        [&]() { decoder->reset(); },
+        [&]() { decoder->update(y_out.data(), cut_test.total_output_symbols); },
+        [&]() { return best_state = decoder->get_best_state(); },
+        [&]() { decoder->chainback(cut_test.x_out.data(), total_cut_bits, best_state); }
+    );
+}
+
+template <size_t K, size_t R>
+void test_hard_packed(Test& test) {
+    {
+        fprintf(fp_log, "- simd_hard_packed\r");
+        fflush(fp_log);
+        const auto result = test_hard_packed_single<K,R>("simd_hard_packed", test);
+        fprintf(fp_log, "o simd_hard_packed (%.3f)\n", result.bit_error_rate);
+    }
+    {
+        fprintf(fp_log, "- simd_hard_packed_unterminated\r");
+        fflush(fp_log);
+        const auto result = test_hard_packed_unterminated<K,R>("simd_hard_packed_unterminated", test);
+        fprintf(fp_log, "o simd_hard_packed_unterminated (%.3f)\n", result.bit_error_rate);
+    }
+}
+
+// Decoder picked by the wisdom file or the registry priorities for the running cpu
+// Compare against the directly instantiated kernels to see the cost of the virtual calls and symbol rescaling
+template <size_t K, size_t R>
+void test_dispatch(Test& test) {
+    const size_t total_decode_bits = test.total_input_bytes*8;
+    const auto& y_out = test.y_int8;
+    struct Mode {
+        const char* name;
+        DecoderPrecision precision;
+    };
+    const Mode modes[2] = {
+        { "dispatch_u8", DecoderPrecision::U8 },
+        { "dispatch_u16", DecoderPrecision::U16 },
+    };
+    for (const auto& mode: modes) {
+        const auto* entry = find_tuned_decoder(K, R, mode.precision, total_decode_bits);
+        if (entry == nullptr) continue;
+        fprintf(fp_log, "- %s\r", mode.name);
+        fflush(fp_log);
+        AllocCounter create_alloc;
+        auto decoder = entry->create(test.poly, test.total_transmit_bits);
+        create_alloc_stats = create_alloc.get_delta();
+        dispatch_engine = entry->name;
+        const auto result = run_test_samples(
+            mode.name, test,
+            [&]() { decoder->reset(); },
+            [&]() { decoder->update(y_out.data(), y_out.size()); },
+            [&]() { return size_t(decoder->get_best_state()); },
+            [&]() { decoder->chainback(test.x_out.data(), total_decode_bits, 0u); }
+        );
+        fprintf(fp_log, "o %s=%s (%.3f)\n", mode.name, entry->name, result.bit_error_rate);
+    }
+}
+
+// Every registered engine through the type erased interface which covers the ka9q, spiral, ours and generated kernels
+// Each one decodes a stream cut off partway through the trellis by chaining back from its best state
+template <size_t K, size_t R>
+void test_unterminated(const Test& test) {
+    auto cut_test = init_unterminated_test(test);
+    const size_t total_cut_bits = cut_test.total_input_bytes*8;
+    const auto& y_out = cut_test.y_int8;
+    for (const auto precision: { DecoderPrecision::U8, DecoderPrecision::U16 }) {
+        for (const auto* entry: get_decoder_candidates(K, R, precision)) {
+            // Spiral decodes bits in pairs
+            if (!entry->is_incremental_update && ((cut_test.total_transmit_bits % 2u) != 0u)) continue;
+            char name[64];
+            snprintf(name, sizeof(name), "%s_unterminated", entry->name);
+            fprintf(fp_log, "- %s\r", name);
+            fflush(fp_log);
+            AllocCounter create_alloc;
+            auto decoder = entry->create(test.poly, cut_test.total_transmit_bits);
+            create_alloc_stats = create_alloc.get_delta();
+            uint32_t best_state = 0;
+            const auto result = run_test_samples(
+                name, cut_test,
+                [&]() { decoder->reset(); },
+                [&]() { decoder->update(y_out.data(), y_out.size()); },
+                [&]() { return size_t(best_state = decoder->get_best_state()); },
+                [&]() { decoder->chainback(cut_test.x_out.data(), total_cut_bits, best_state); }
+            );
+            fprintf(fp_log, "o %s (%.3f)\n", name, result.bit_error_rate);
         }
-        samples.push_back(sample);
     }
+}
+
+// Kernels generated for the code at runtime against the table driven kernels above
+// The first creation includes generating the kernel, later ones reuse it from the cache
+template <size_t K, size_t R>
+void test_jit(Test& test) {
+    const size_t total_decode_bits = test.total_input_bytes*8;
+    const auto& y_out = test.y_int8;
+    struct Mode {
+        const char* name;
+        DecoderPrecision precision;
+    };
+    const Mode modes[2] = {
+        { "jit_u8", DecoderPrecision::U8 },
+        { "jit_u16", DecoderPrecision::U16 },
+    };
+    for (const auto& mode: modes) {
+        if (!is_jit_code_supported(K, R, mode.precision)) continue;
+        fprintf(fp_log, "- %s\r", mode.name);
+        fflush(fp_log);
+        AllocCounter create_alloc;
+        auto decoder = std::make_unique<ViterbiDecoder_JIT>(K, R, test.poly, mode.precision, test.total_transmit_bits);
+        create_alloc_stats = create_alloc.get_delta();
+        const auto result = run_test_samples(
+            mode.name, test,
+            [&]() { decoder->reset(); },
+            [&]() { decoder->update(y_out.data(), y_out.size()); },
+            [&]() { return decoder->get_best_state(); },
+            [&]() { decoder->chainback(test.x_out.data(), total_decode_bits, 0u); }
+        );
+        fprintf(fp_log, "o %s (%.3f)\n", mode.name, result.bit_error_rate);
+    }
+}
+
+// Encode into 4bit soft decision symbols packed two to a byte
+template <size_t K, size_t R>
+std::vector<uint8_t> encode_nibbles(const Test& test) {
+    const auto y_out = get_test_symbols<int8_t>(test, NIBBLE_SOFT_DECISION_HIGH, NIBBLE_SOFT_DECISION_LOW);
+    auto y_packed = std::vector<uint8_t>((y_out.size()+1u)/2u);
+    pack_nibbles(y_out.data(), y_packed.data(), y_out.size());
+    return y_packed;
+}
+
+// Our decoders take unpacked symbols so nibbles are expanded a block at a time
+template <size_t K, size_t R, class decoder_t>
+TestResult test_ours_nibble_single(const char* name, Test& test) {
+    using soft_t = int8_t;
+    using error_t = uint8_t;
+    const size_t total_decode_bits = test.total_input_bytes*8;
+    const int* poly = test.poly;
+    const auto config = get_soft4_decoding_config(R);
+    const auto lut = get_nibble_lut_signed();
+    const auto y_packed = encode_nibbles<K,R>(test);
+    AllocCounter create_alloc;
+    auto branch_table = std::make_unique<ViterbiBranchTable<K,R,soft_t>>(poly, config.soft_decision_high, config.soft_decision_low);
+    auto core = std::make_unique<ViterbiDecoder_Core<K,R,error_t,soft_t>>(*branch_table, config.decoder_config);
+    core->set_traceback_length(total_decode_bits);
+    create_alloc_stats = create_alloc.get_delta();
+    return run_test_samples(
+        name, test,
+        [&]() { core->reset(); },
+        [&]() {
+            update_with_unpacked_nibbles<R>(y_packed.data(), test.total_output_symbols, lut, [&](const int8_t* symbols, size_t total_symbols) {
+                decoder_t::template update<uint64_t>(*core, symbols, total_symbols);
+            });
+        },
+        [&]() { return get_best_state(*core); },
+        [&]() { core->chainback(test.x_out.data(), total_decode_bits); }
+    );
+}
+
+// Compare 4bit soft decision symbols stored one per byte against two per byte
+template <size_t K, size_t R>
+void test_ours_nibble(Test& test) {
+    {
+        fprintf(fp_log, "- sse_u8_soft4\r");
+        fflush(fp_log);
+        using decoder = ViterbiDecoder_SSE_u8<K,R>;
+        auto config = get_soft4_decoding_config(R);
+        const auto result = test_ours_single<K,R,int8_t,uint8_t,decoder>("sse_u8_soft4", test, config);
+        fprintf(fp_log, "o sse_u8_soft4 (%.3f)\n", result.bit_error_rate);
+    }
+    {
+        fprintf(fp_log, "- sse_u8_nibble\r");
+        fflush(fp_log);
+        const auto result = test_ours_nibble_single<K,R,ViterbiDecoder_SSE_u8<K,R>>("sse_u8_nibble", test);
+        fprintf(fp_log, "o sse_u8_nibble (%.3f)\n", result.bit_error_rate);
+    }
+    {
+        fprintf(fp_log, "- avx_u8_soft4\r");
+        fflush(fp_log);
+        using decoder = ViterbiDecoder_AVX_u8<K,R>;
+        auto config = get_soft4_decoding_config(R);
+        const auto result = test_ours_single<K,R,int8_t,uint8_t,decoder>("avx_u8_soft4", test, config);
+        fprintf(fp_log, "o avx_u8_soft4 (%.3f)\n", result.bit_error_rate);
+    }
+    {
+        fprintf(fp_log, "- avx_u8_nibble\r");
+        fflush(fp_log);
+        const auto result = test_ours_nibble_single<K,R,ViterbiDecoder_AVX_u8<K,R>>("avx_u8_nibble", test);
+        fprintf(fp_log, "o avx_u8_nibble (%.3f)\n", result.bit_error_rate);
+    }
+}
+
+// ka9q decoders which unpack nibbles inside their update kernel
+template <size_t K, size_t R, typename decoder_t>
+void test_ka9q_nibble(Test& test) {
+    const char* name = "ka9q_nibble";
+    fprintf(fp_log, "- %s\r", name);
+    fflush(fp_log);
+    const size_t total_decode_bits = test.total_input_bytes*8;
+    AllocCounter create_alloc;
+    auto decoder = decoder_t(test.poly, test.total_transmit_bits);
+    create_alloc_stats = create_alloc.get_delta();
+    const auto y_packed = encode_nibbles<K,R>(test);
+    const auto result = run_test_samples(
+        name, test,
+        [&]() { decoder.reset(); },
+        [&]() { decoder.update_nibbles(y_packed.data(), test.total_output_symbols); },
+        [&]() { return decoder.get_best_state(); },
+        [&]() { decoder.chainback(test.x_out.data(), total_decode_bits); }
+    );
+    fprintf(fp_log, "o %s (%.3f)\n", name, result.bit_error_rate);
+}
+
+template <size_t K, size_t R, typename decoder_t>
+TestResult test_third_party(const char* name, Test& test, DecisionStorePolicy decision_store) {
+    const size_t total_decode_bits = test.total_input_bytes*8;
+    const int* poly = test.poly;
+    auto& x_out = test.x_out;
+    AllocCounter create_alloc;
+    auto decoder = decoder_t(poly, test.total_transmit_bits);
+    decoder.set_decision_store(decision_store);
+    create_alloc_stats = create_alloc.get_delta();
+    auto& y_out = test.y_int8;
+    collect_test_samples(test,
+        [&]() { decoder.reset(); },
+        [&]() { decoder.update(y_out.data(), y_out.size()); },
+        [&]() { return decoder.get_best_state(); },
+        [&]() { decoder.chainback(x_out.data(), total_decode_bits); }
+    );
+    if constexpr (VITERBI_METRIC_COUNTERS && has_metric_counters<decoder_t>::value) {
+        frame_metric_counters = decoder.get_metric_counters();
+    }
+    run_create_samples(test,
+        [&](CreateSample& sample) {
+            Timer t;
+            auto instance = std::make_unique<decoder_t>(poly, test.total_transmit_bits);
+            instance->set_decision_store(decision_store);
+            sample.create_ns = t.get_delta();
+            return instance;
+        },
+        [&](decoder_t& instance) {
+            instance.reset();
+            instance.update(y_out.data(), y_out.size());
+        }
+    );
     return print_test(name, test);
 }
 
 template <size_t K, size_t R, typename decoder_t>
-void test_ka9q(Test& test) {
-    fprintf(fp_log, "- kafq\r");
+void test_ka9q(Test& test, DecisionStorePolicy decision_store = DecisionStorePolicy::CACHED) {
+    const char* name = (decision_store == DecisionStorePolicy::STREAMING) ? "ka9q_stream" : "ka9q";
+    fprintf(fp_log, "- %s\r", name);
     fflush(fp_log);
-    const auto result = test_third_party<K,R,decoder_t>("ka9q", test);
-    fprintf(fp_log, "o kafq (%.3f)\n", result.bit_error_rate);
+    const auto result = test_third_party<K,R,decoder_t>(name, test, decision_store);
+    fprintf(fp_log, "o %s (%.3f)\n", name, result.bit_error_rate);
 }
 
 template <size_t K, size_t R, typename decoder_t>
-void test_spiral(Test& test) {
-    fprintf(fp_log, "- spiral\r");
+void test_spiral(Test& test, DecisionStorePolicy decision_store = DecisionStorePolicy::CACHED, const char* label = "spiral") {
+    char name[64];
+    snprintf(name, sizeof(name), "%s%s", label, (decision_store == DecisionStorePolicy::STREAMING) ? "_stream" : "");
+    fprintf(fp_log, "- %s\r", name);
     fflush(fp_log);
-    const auto result = test_third_party<K,R,decoder_t>("spiral", test);
-    fprintf(fp_log, "o spiral (%.3f)\n", result.bit_error_rate);
+    const auto result = test_third_party<K,R,decoder_t>(name, test, decision_store);
+    fprintf(fp_log, "o %s (%.3f)\n", name, result.bit_error_rate);
 }
 
 void init_parser(argparse::ArgumentParser& parser) {
@@ -313,12 +1358,99 @@ void init_parser(argparse::ArgumentParser& parser) {
         .metavar("OUTPUT_FILENAME")
         .nargs(1).required()
         .help("Filename to output sample data (defaults to stdout)");
+    parser.add_argument("--ebno")
+        .default_value(float(4.0f)).scan<'g', float>()
+        .metavar("EBNO_DB")
+        .nargs(1)
+        .help("Eb/N0 in dB of the noisy channel used to compare fixed and adaptive soft decision scaling");
+    parser.add_argument("--channel-ebno")
+        .scan<'g', float>()
+        .metavar("EBNO_DB")
+        .nargs(1)
+        .help("Pass every decoder test frame through a BPSK AWGN channel at this Eb/N0 in dB instead of decoding noiseless symbols");
+    parser.add_argument("--energy")
+        .default_value(false).implicit_value(true)
+        .help("Measure package energy of the update and chainback phases through Linux RAPL powercap");
+    parser.add_argument("--list-decoders")
+        .default_value(false).implicit_value(true)
+        .help("List every registered decoder, whether the cpu supports it and which one gets dispatched");
+    parser.add_argument("--wisdom")
+        .default_value(std::string("./data/wisdom.txt"))
+        .metavar("WISDOM_FILENAME")
+        .nargs(1)
+        .help("Decoder choices from a previous autotune which are loaded at startup");
+    parser.add_argument("--autotune")
+        .default_value(false).implicit_value(true)
+        .help("Benchmark every decoder for the benchmarked codes and save the fastest to the wisdom file");
+    parser.add_argument("--disable-avx2")
+        .default_value(false).implicit_value(true)
+        .help("Dispatch as if the cpu didn't support AVX2 to check the SSE fallbacks");
+    parser.add_argument("--long-frames")
+        .default_value(false).implicit_value(true)
+        .help("Run long frames whose decisions and symbols exceed the LLC to compare decision store policies and symbol packing");
+    parser.add_argument("--ber-sweep")
+        .default_value(false).implicit_value(true)
+        .help("Measure bit and frame error rates of every supported decoder for a code over a range of Eb/N0 instead of benchmarking");
+    parser.add_argument("--sweep-code")
+        .default_value(std::vector<size_t>{ 7, 2 }).scan<'u', size_t>()
+        .metavar("K R")
+        .nargs(2)
+        .help("Code to sweep from the benchmark codes");
+    parser.add_argument("--sweep-engine")
+        .default_value(std::string(""))
+        .metavar("ENGINE")
+        .nargs(1)
+        .help("Only sweep this decoder (defaults to every supported decoder)");
+    parser.add_argument("--sweep-ebno")
+        .default_value(std::vector<float>{ 1.0f, 5.0f, 0.5f }).scan<'g', float>()
+        .metavar("START STOP STEP")
+        .nargs(3)
+        .help("Eb/N0 points in dB to sweep");
+    parser.add_argument("--sweep-bit-errors")
+        .default_value(size_t(1000)).scan<'u', size_t>()
+        .metavar("TOTAL_ERRORS")
+        .nargs(1)
+        .help("Stop a point once this many bit errors are counted (0 to disable)");
+    parser.add_argument("--sweep-frame-errors")
+        .default_value(size_t(100)).scan<'u', size_t>()
+        .metavar("TOTAL_ERRORS")
+        .nargs(1)
+        .help("Stop a point once this many frame errors are counted (0 to disable)");
+    parser.add_argument("--sweep-max-frames")
+        .default_value(size_t(10000)).scan<'u', size_t>()
+        .metavar("TOTAL_FRAMES")
+        .nargs(1)
+        .help("Stop a point after this many frames");
+    parser.add_argument("--sweep-threads")
+        .default_value(size_t(0)).scan<'u', size_t>()
+        .metavar("TOTAL_THREADS")
+        .nargs(1)
+        .help("Number of threads to sweep with (defaults to every hardware thread)");
+    parser.add_argument("--sweep-output")
+        .default_value(std::string("./data/ber_sweep.json"))
+        .metavar("OUTPUT_FILENAME")
+        .nargs(1)
+        .help("Filename to output sweep results");
 }
 
 struct Args {
     float sampling_time;
     size_t minimum_samples;
     std::string output_filename;
+    std::string wisdom_filename;
+    bool is_long_frames;
+    bool is_energy;
+    bool is_list_decoders;
+    bool is_disable_avx2;
+    bool is_autotune;
+    float ebno_db;
+    std::optional<float> channel_ebno_db;
+    bool is_ber_sweep;
+    std::vector<size_t> sweep_code;
+    std::string sweep_engine;
+    std::vector<float> sweep_ebno_db;
+    BerSweepConfig sweep_config;
+    std::string sweep_output_filename;
 };
 
 Args get_args_from_parser(const argparse::ArgumentParser& parser) {
@@ -326,9 +1458,206 @@ Args get_args_from_parser(const argparse::ArgumentParser& parser) {
     args.sampling_time = parser.get<float>("--sampling-time");
     args.minimum_samples = parser.get<size_t>("--minimum-samples");
     args.output_filename = parser.get<std::string>("--output");
+    args.is_long_frames = parser.get<bool>("--long-frames");
+    args.is_energy = parser.get<bool>("--energy");
+    args.is_list_decoders = parser.get<bool>("--list-decoders");
+    args.is_disable_avx2 = parser.get<bool>("--disable-avx2");
+    args.wisdom_filename = parser.get<std::string>("--wisdom");
+    args.is_autotune = parser.get<bool>("--autotune");
+    args.ebno_db = parser.get<float>("--ebno");
+    args.channel_ebno_db = parser.present<float>("--channel-ebno");
+    args.is_ber_sweep = parser.get<bool>("--ber-sweep");
+    args.sweep_code = parser.get<std::vector<size_t>>("--sweep-code");
+    args.sweep_engine = parser.get<std::string>("--sweep-engine");
+    args.sweep_ebno_db = parser.get<std::vector<float>>("--sweep-ebno");
+    args.sweep_config.target_bit_errors = parser.get<size_t>("--sweep-bit-errors");
+    args.sweep_config.target_frame_errors = parser.get<size_t>("--sweep-frame-errors");
+    args.sweep_config.max_frames = parser.get<size_t>("--sweep-max-frames");
+    args.sweep_config.total_threads = parser.get<size_t>("--sweep-threads");
+    args.sweep_output_filename = parser.get<std::string>("--sweep-output");
     return args;
 }
 
+// Codes and frame lengths that the benchmark runs
+// The benchmark blocks in main(), autotuning, the sweep and --list-decoders all read them from here
+struct BenchmarkCode {
+    size_t K;
+    size_t R;
+    const int* poly;
+    size_t total_input_bytes;
+};
+
+static constexpr int POLY_K7_R2[2] = { 0x6d, 0x4f };
+static constexpr int POLY_K7_R4[4] = { 121, 117, 91, 111 };
+static constexpr int POLY_K9_R2[2] = { 0x1af, 0x11d };
+static constexpr int POLY_K9_R4[4] = { 501, 441, 331, 315 };
+static constexpr int POLY_K15_R6[6] = { 042631, 047245, 056507, 073363, 077267, 064537 };
+static constexpr int POLY_K24_R2[2] = { 062650457, 062650455 };
+
+static constexpr BenchmarkCode BENCHMARK_CODES[] = {
+    { 7, 2, POLY_K7_R2, 1024 },
+    { 7, 4, POLY_K7_R4, 1024 },
+    { 9, 2, POLY_K9_R2, 512 },
+    { 9, 4, POLY_K9_R4, 512 },
+    { 15, 6, POLY_K15_R6, 256 },
+    { 24, 2, POLY_K24_R2, 8 },
+};
+
+// Fails to compile if the code isn't benchmarked
+static constexpr const BenchmarkCode& get_benchmark_code(const size_t K, const size_t R) {
+    for (const auto& code: BENCHMARK_CODES) {
+        if (code.K == K && code.R == R) return code;
+    }
+    throw "Code isn't in BENCHMARK_CODES";
+}
+
+static bool run_autotune(const Args& args) {
+    auto& wisdom = DecoderWisdom::get();
+    for (const auto& code: BENCHMARK_CODES) {
+        const size_t total_input_bits = code.total_input_bytes*8;
+        for (const auto precision: { DecoderPrecision::U8, DecoderPrecision::U16 }) {
+            const auto candidates = benchmark_decoder_candidates(
+                code.K, code.R, code.poly, precision, total_input_bits,
+                args.sampling_time, args.minimum_samples
+            );
+            if (candidates.empty()) continue;
+            fprintf(fp_log, "[autotune] K=%zu R=%zu %s bits=%zu\n", code.K, code.R, get_precision_name(precision), total_input_bits);
+            for (const auto& candidate: candidates) {
+                fprintf(
+                    fp_log, "  %-12s update=%zuns chainback=%zuns%s\n",
+                    candidate.decoder->name, size_t(candidate.update_ns), size_t(candidate.chainback_ns),
+                    candidate.is_correct ? "" : " (decode failed)"
+                );
+            }
+            WisdomEntry entry;
+            if (!get_autotune_winners(candidates, code.K, code.R, precision, total_input_bits, entry)) continue;
+            fprintf(fp_log, "  selected=%s\n", entry.engine.c_str());
+            wisdom.set(entry);
+        }
+    }
+    if (!wisdom.save(args.wisdom_filename.c_str())) {
+        fprintf(stderr, "Failed to write wisdom file: '%s'\n", args.wisdom_filename.c_str());
+        return false;
+    }
+    fprintf(fp_log, "Saved %zu entries to '%s'\n", wisdom.get_entries().size(), args.wisdom_filename.c_str());
+    return true;
+}
+
+static void print_sweep_points(const std::vector<BerSweepPoint>& points) {
+    fprintf(fp_out, "  \"points\": [\n");
+    for (size_t i = 0; i < points.size(); i++) {
+        const auto& point = points[i];
+        fprintf(fp_out, "    { ");
+        fprintf(fp_out, "\"ebno_db\": %f, ", point.ebno_db);
+        fprintf(fp_out, "\"total_frames\": %zu, ", point.total_frames);
+        fprintf(fp_out, "\"total_frame_errors\": %zu, ", point.total_frame_errors);
+        fprintf(fp_out, "\"total_bits\": %zu, ", size_t(point.total_bits));
+        fprintf(fp_out, "\"total_bit_errors\": %zu, ", size_t(point.total_bit_errors));
+        fprintf(fp_out, "\"bit_error_rate\": %e, ", point.get_bit_error_rate());
+        fprintf(fp_out, "\"frame_error_rate\": %e, ", point.get_frame_error_rate());
+        fprintf(fp_out, "\"decode_ns\": %zu, ", size_t(point.decode_ns));
+        fprintf(fp_out, "\"elapsed_ns\": %zu", size_t(point.elapsed_ns));
+        fprintf(fp_out, " }%s\n", (i != (points.size()-1)) ? "," : "");
+    }
+    fprintf(fp_out, "  ]\n");
+}
+
+// Error rate curves of every supported decoder for one of the benchmark codes
+static bool run_sweep(const Args& args) {
+    const BenchmarkCode* code = nullptr;
+    for (const auto& other: BENCHMARK_CODES) {
+        if (other.K == args.sweep_code[0] && other.R == args.sweep_code[1]) code = &other;
+    }
+    if (code == nullptr) {
+        fprintf(stderr, "K=%zu R=%zu isn't one of the benchmark codes\n", args.sweep_code[0], args.sweep_code[1]);
+        return false;
+    }
+    const float ebno_start = args.sweep_ebno_db[0];
+    const float ebno_stop = args.sweep_ebno_db[1];
+    const float ebno_step = args.sweep_ebno_db[2];
+    if (ebno_step <= 0.0f) {
+        fprintf(stderr, "Eb/N0 step must be positive (%.3f)\n", ebno_step);
+        return false;
+    }
+    std::vector<float> ebno_db;
+    // stepped by index so rounding doesn't drop the last point
+    for (size_t i = 0; ; i++) {
+        const float value = ebno_start + float(i)*ebno_step;
+        if (value > (ebno_stop + ebno_step*1e-3f)) break;
+        ebno_db.push_back(value);
+    }
+    auto config = args.sweep_config;
+    config.total_input_bytes = code->total_input_bytes;
+    const size_t total_threads = get_ber_sweep_threads(config);
+    fprintf(fp_log, "[ber_sweep] K=%zu R=%zu bytes=%zu threads=%zu\n", code->K, code->R, config.total_input_bytes, total_threads);
+
+    fp_out = fopen(args.sweep_output_filename.c_str(), "w+");
+    if (fp_out == nullptr) {
+        fprintf(stderr, "Failed to open output file: '%s'\n", args.sweep_output_filename.c_str());
+        return false;
+    }
+    fprintf(fp_out, "[\n");
+    bool has_previous_object = false;
+    for (const auto precision: { DecoderPrecision::U8, DecoderPrecision::U16 }) {
+        for (const auto* entry: get_decoder_candidates(code->K, code->R, precision)) {
+            if (!args.sweep_engine.empty() && (args.sweep_engine != entry->name)) continue;
+            // Spiral decodes bits in pairs
+            if (!entry->is_incremental_update && (((config.total_input_bytes*8u + code->K-1u) % 2u) != 0u)) continue;
+            const auto points = run_ber_sweep(*entry, code->poly, ebno_db, config);
+            for (const auto& point: points) {
+                fprintf(
+                    fp_log, "  %-12s Eb/N0=%.2fdB BER=%.3e FER=%.3e frames=%zu total=%.1fMb/s decode=%.1fMb/s/thread\n",
+                    entry->name, point.ebno_db, point.get_bit_error_rate(), point.get_frame_error_rate(),
+                    point.total_frames, point.get_total_mbps(), point.get_decode_mbps()
+                );
+            }
+            if (has_previous_object) fprintf(fp_out, ",\n");
+            has_previous_object = true;
+            fprintf(fp_out, "{\n");
+            fprintf(fp_out, "  \"name\": \"%s\",\n", entry->name);
+            fprintf(fp_out, "  \"K\": %zu,\n", code->K);
+            fprintf(fp_out, "  \"R\": %zu,\n", code->R);
+            fprintf(fp_out, "  \"precision\": \"%s\",\n", get_precision_name(precision));
+            fprintf(fp_out, "  \"poly\": ");
+            print_array<int>({ code->poly, code->R }, "%d");
+            fprintf(fp_out, ",\n");
+            fprintf(fp_out, "  \"total_input_bytes\": %zu,\n", config.total_input_bytes);
+            fprintf(fp_out, "  \"total_threads\": %zu,\n", total_threads);
+            print_sweep_points(points);
+            fprintf(fp_out, "}");
+        }
+    }
+    fprintf(fp_out, "\n]\n");
+    fclose(fp_out);
+    fp_out = stdout;
+    if (!has_previous_object) {
+        fprintf(stderr, "No supported decoders to sweep for K=%zu R=%zu (see --list-decoders)\n", code->K, code->R);
+        return false;
+    }
+    return true;
+}
+
+static void list_decoders() {
+    const auto& cpu = CpuFeatures::get();
+    printf("cpu features:");
+    for (size_t i = 0; i < TOTAL_CPU_FEATURES; i++) {
+        if (cpu.has(uint32_t(1u) << i)) printf(" %s", CPU_FEATURE_NAMES[i]);
+    }
+    printf("\n");
+    for (const auto& code: BENCHMARK_CODES) {
+        for (const auto precision: { DecoderPrecision::U8, DecoderPrecision::U16 }) {
+            const auto candidates = get_decoder_candidates(code.K, code.R, precision, false);
+            if (candidates.empty()) continue;
+            const auto* best = find_tuned_decoder(code.K, code.R, precision, code.total_input_bytes*8);
+            printf("K=%zu R=%zu %s\n", code.K, code.R, get_precision_name(precision));
+            for (const auto* entry: candidates) {
+                const char* status = (entry == best) ? "selected" : (is_decoder_supported(*entry) ? "supported" : "unsupported");
+                printf("  %-12s priority=%-3d %s\n", entry->name, entry->priority, status);
+            }
+        }
+    }
+}
+
 int main(int argc, char** argv) {
     auto parser = argparse::ArgumentParser("run_benchmark", "0.1.0");
     parser.add_description("Run benchmark to compare ka9q, spiral and our Viterbi decoders");
@@ -349,6 +1678,22 @@ int main(int argc, char** argv) {
         fprintf(stderr, "Minimum number of samples must be non-zero\n");
         return 1;
     }
+    if (args.is_disable_avx2) {
+        CpuFeatures::get().disable(CPU_FEATURE_AVX2);
+    }
+    if (args.is_autotune) {
+        return run_autotune(args) ? 0 : 1;
+    }
+    if (DecoderWisdom::get().load(args.wisdom_filename.c_str())) {
+        fprintf(fp_log, "Loaded %zu decoder choices from '%s'\n", DecoderWisdom::get().get_entries().size(), args.wisdom_filename.c_str());
+    }
+    if (args.is_list_decoders) {
+        list_decoders();
+        return 0;
+    }
+    if (args.is_ber_sweep) {
+        return run_sweep(args) ? 0 : 1;
+    }
     if (!args.output_filename.empty()) {
         fp_out = fopen(args.output_filename.c_str(), "w+");
         if (fp_out == nullptr) {
@@ -358,64 +1703,163 @@ int main(int argc, char** argv) {
     }
     samples.reserve(4096);
     samples.clear();
+    if (args.is_energy) {
+        auto& energy_meter = EnergyMeter::get();
+        energy_meter.set_enabled(true);
+        if (energy_meter.is_enabled()) {
+            fprintf(fp_log, "Measuring energy over %zu RAPL package zones\n", energy_meter.get_total_zones());
+        } else {
+            fprintf(fp_log, "RAPL powercap isn't readable so energy won't be measured\n");
+        }
+    }
+    // Calibrate before any phase is timed since it takes a while
+    if (TscCalibration::is_available()) {
+        const auto& tsc = TscCalibration::get();
+        fprintf(fp_log, "TSC frequency = %.3f MHz, timer overhead = %zu cycles\n", tsc.frequency_hz*1e-6, size_t(tsc.overhead_cycles));
+    }
 
     fprintf(fp_out, "[\n");
     if (1) {
         constexpr size_t K = 7;
         constexpr size_t R = 2;
-        constexpr size_t total_input_bytes = 1024;
-        const int poly[2] = { 0x6d, 0x4f };
-        auto test = init_test<K,R>(poly, total_input_bytes, args.sampling_time, args.minimum_samples);
+        constexpr auto& code = get_benchmark_code(K, R);
+        constexpr size_t total_input_bytes = code.total_input_bytes;
+        const int* poly = code.poly;
+        test_encoders<K,R>(poly, args.sampling_time, args.minimum_samples);
+        auto test = init_test<K,R>(poly, total_input_bytes, args.sampling_time, args.minimum_samples, args.channel_ebno_db);
         test_ka9q<K,R,ka9q_viterbi27>(test);
         test_spiral<K,R,spiral27_i>(test);
+        test_spiral<K,R,spiral27_avx2_i>(test, DecisionStorePolicy::CACHED, "spiral_avx2");
         test_ours<K,R>(test);
+        test_hard_packed<K,R>(test);
+        test_dispatch<K,R>(test);
+        test_unterminated<K,R>(test);
+        test_jit<K,R>(test);
+        test_ours_llr<K,R>(test);
+        test_ours_adaptive<K,R>(test, args.ebno_db);
+        test_hybrid<K,R>(test);
     }
     if (1) {
         constexpr size_t K = 7;
         constexpr size_t R = 4;
-        constexpr size_t total_input_bytes = 1024;
-        const int poly[4] = { 121, 117, 91, 111 };
-        auto test = init_test<K,R>(poly, total_input_bytes, args.sampling_time, args.minimum_samples);
+        constexpr auto& code = get_benchmark_code(K, R);
+        constexpr size_t total_input_bytes = code.total_input_bytes;
+        const int* poly = code.poly;
+        test_encoders<K,R>(poly, args.sampling_time, args.minimum_samples);
+        auto test = init_test<K,R>(poly, total_input_bytes, args.sampling_time, args.minimum_samples, args.channel_ebno_db);
         test_spiral<K,R,spiral47_i>(test);
+        test_spiral<K,R,spiral47_avx2_i>(test, DecisionStorePolicy::CACHED, "spiral_avx2");
         test_ours<K,R>(test);
+        test_hard_packed<K,R>(test);
+        test_dispatch<K,R>(test);
+        test_unterminated<K,R>(test);
+        test_jit<K,R>(test);
+        test_ours_llr<K,R>(test);
+        test_ours_adaptive<K,R>(test, args.ebno_db);
+        test_hybrid<K,R>(test);
     }
     if (1) {
         constexpr size_t K = 9;
         constexpr size_t R = 2;
-        constexpr size_t total_input_bytes = 512;
-        const int poly[2] = { 0x1af, 0x11d };
-        auto test = init_test<K,R>(poly, total_input_bytes, args.sampling_time, args.minimum_samples);
+        constexpr auto& code = get_benchmark_code(K, R);
+        constexpr size_t total_input_bytes = code.total_input_bytes;
+        const int* poly = code.poly;
+        test_encoders<K,R>(poly, args.sampling_time, args.minimum_samples);
+        auto test = init_test<K,R>(poly, total_input_bytes, args.sampling_time, args.minimum_samples, args.channel_ebno_db);
         test_ka9q<K,R,ka9q_viterbi29>(test);
         test_spiral<K,R,spiral29_i>(test);
+        test_spiral<K,R,spiral29_avx2_i>(test, DecisionStorePolicy::CACHED, "spiral_avx2");
         test_ours<K,R>(test);
+        test_hard_packed<K,R>(test);
+        test_dispatch<K,R>(test);
+        test_unterminated<K,R>(test);
+        test_jit<K,R>(test);
+        test_ours_llr<K,R>(test);
+        test_ours_adaptive<K,R>(test, args.ebno_db);
+        test_hybrid<K,R>(test);
     }
     if (1) {
         constexpr size_t K = 9;
         constexpr size_t R = 4;
-        constexpr size_t total_input_bytes = 512;
-        const int poly[4] = { 501, 441, 331, 315 };
-        auto test = init_test<K,R>(poly, total_input_bytes, args.sampling_time, args.minimum_samples);
+        constexpr auto& code = get_benchmark_code(K, R);
+        constexpr size_t total_input_bytes = code.total_input_bytes;
+        const int* poly = code.poly;
+        test_encoders<K,R>(poly, args.sampling_time, args.minimum_samples);
+        auto test = init_test<K,R>(poly, total_input_bytes, args.sampling_time, args.minimum_samples, args.channel_ebno_db);
         test_spiral<K,R,spiral49_i>(test);
+        test_spiral<K,R,spiral49_avx2_i>(test, DecisionStorePolicy::CACHED, "spiral_avx2");
         test_ours<K,R>(test);
+        test_hard_packed<K,R>(test);
+        test_dispatch<K,R>(test);
+        test_unterminated<K,R>(test);
+        test_jit<K,R>(test);
+        test_ours_llr<K,R>(test);
+        test_ours_adaptive<K,R>(test, args.ebno_db);
+        test_hybrid<K,R>(test);
     }
     if (1) {
         constexpr size_t K = 15;
         constexpr size_t R = 6;
-        constexpr size_t total_input_bytes = 256;
-        const int poly[6] = { 042631, 047245, 056507, 073363, 077267, 064537 };
-        auto test = init_test<K,R>(poly, total_input_bytes, args.sampling_time, args.minimum_samples);
+        constexpr auto& code = get_benchmark_code(K, R);
+        constexpr size_t total_input_bytes = code.total_input_bytes;
+        const int* poly = code.poly;
+        test_encoders<K,R>(poly, args.sampling_time, args.minimum_samples);
+        auto test = init_test<K,R>(poly, total_input_bytes, args.sampling_time, args.minimum_samples, args.channel_ebno_db);
         test_ka9q<K,R,ka9q_viterbi615>(test);
         test_spiral<K,R,spiral615_i>(test);
+        test_spiral<K,R,spiral615_avx2_i>(test, DecisionStorePolicy::CACHED, "spiral_avx2");
         test_ours<K,R>(test);
+        test_hard_packed<K,R>(test);
+        test_dispatch<K,R>(test);
+        test_unterminated<K,R>(test);
+        test_jit<K,R>(test);
+        test_ours_llr<K,R>(test);
+        test_ours_adaptive<K,R>(test, args.ebno_db);
+        test_hybrid<K,R>(test);
     }
     if (1) {
         constexpr size_t K = 24;
         constexpr size_t R = 2;
-        constexpr size_t total_input_bytes = 8;
-        const int poly[2] = { 062650457, 062650455 };
-        auto test = init_test<K,R>(poly, total_input_bytes, args.sampling_time, args.minimum_samples);
+        constexpr auto& code = get_benchmark_code(K, R);
+        constexpr size_t total_input_bytes = code.total_input_bytes;
+        const int* poly = code.poly;
+        test_encoders<K,R>(poly, args.sampling_time, args.minimum_samples);
+        auto test = init_test<K,R>(poly, total_input_bytes, args.sampling_time, args.minimum_samples, args.channel_ebno_db);
         test_ka9q<K,R,ka9q_viterbi224>(test);
         test_ours<K,R>(test);
+        test_hard_packed<K,R>(test);
+        test_dispatch<K,R>(test);
+        test_unterminated<K,R>(test);
+        test_jit<K,R>(test);
+        test_ours_llr<K,R>(test);
+        test_ours_adaptive<K,R>(test, args.ebno_db);
+    }
+    // Decisions for these frames are far larger than the LLC
+    // Streaming them avoids evicting path metrics which are accessed on every bit
+    if (args.is_long_frames) {
+        constexpr size_t K = 7;
+        constexpr size_t R = 2;
+        constexpr size_t total_input_bytes = 1u << 19;
+        const int* poly = get_benchmark_code(K, R).poly;
+        auto test = init_test<K,R>(poly, total_input_bytes, args.sampling_time, args.minimum_samples, args.channel_ebno_db);
+        test_ka9q<K,R,ka9q_viterbi27>(test, DecisionStorePolicy::CACHED);
+        test_ka9q<K,R,ka9q_viterbi27>(test, DecisionStorePolicy::STREAMING);
+        test_spiral<K,R,spiral27_i>(test, DecisionStorePolicy::CACHED);
+        test_spiral<K,R,spiral27_i>(test, DecisionStorePolicy::STREAMING);
+        // Symbol bandwidth is significant for long frames so compare bytes against packed nibbles
+        test_ka9q_nibble<K,R,ka9q_viterbi27>(test);
+        test_ours_nibble<K,R>(test);
+    }
+    if (args.is_long_frames) {
+        constexpr size_t K = 15;
+        constexpr size_t R = 6;
+        constexpr size_t total_input_bytes = 4096;
+        const int* poly = get_benchmark_code(K, R).poly;
+        auto test = init_test<K,R>(poly, total_input_bytes, args.sampling_time, args.minimum_samples, args.channel_ebno_db);
+        test_ka9q<K,R,ka9q_viterbi615>(test, DecisionStorePolicy::CACHED);
+        test_ka9q<K,R,ka9q_viterbi615>(test, DecisionStorePolicy::STREAMING);
+        test_spiral<K,R,spiral615_i>(test, DecisionStorePolicy::CACHED);
+        test_spiral<K,R,spiral615_i>(test, DecisionStorePolicy::STREAMING);
     }
     fprintf(fp_out, "\n]\n");
     return 0;
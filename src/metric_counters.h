@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Counters for relating decoder throughput to the dynamics of its path metrics
+// These add a pass over every metric on every bit so they are compiled out unless VITERBI_METRIC_COUNTERS=1
+#ifndef VITERBI_METRIC_COUNTERS
+#define VITERBI_METRIC_COUNTERS 0
+#endif
+
+struct MetricCounters {
+    uint64_t total_bits = 0u;
+    uint64_t renormalisations = 0u;
+    uint64_t saturated_metrics = 0u;        // path metrics pinned at their ceiling after add-compare-select
+    uint64_t max_metric_spread = 0u;        // largest difference between the best and worst path metric
+    uint64_t total_metric_spread = 0u;      // divide by total_bits for the mean spread
+};
+
+// Call once per decoded bit with the new path metrics before they are renormalised
+template <typename T>
+inline void update_metric_counters(MetricCounters& counters, const T* metrics, const size_t N, const T ceiling, const bool is_renormalised) {
+    T min = metrics[0];
+    T max = metrics[0];
+    uint64_t total_saturated = 0u;
+    for (size_t i = 0u; i < N; i++) {
+        const T x = metrics[i];
+        min = (x < min) ? x : min;
+        max = (x > max) ? x : max;
+        total_saturated += (x == ceiling) ? 1u : 0u;
+    }
+    const uint64_t spread = uint64_t(max - min);
+    counters.total_bits++;
+    counters.renormalisations += is_renormalised ? 1u : 0u;
+    counters.saturated_metrics += total_saturated;
+    counters.max_metric_spread = (spread > counters.max_metric_spread) ? spread : counters.max_metric_spread;
+    counters.total_metric_spread += spread;
+}
+
+// For generated kernels that renormalise when the first metric exceeds a threshold
+#if VITERBI_METRIC_COUNTERS
+#define COUNT_METRICS_U8(counters, metrics, N, threshold) \
+    update_metric_counters<uint8_t>(*(counters), (const uint8_t*)(metrics), (N), 0xFF, ((const uint8_t*)(metrics))[0] > (threshold))
+#else
+#define COUNT_METRICS_U8(counters, metrics, N, threshold)
+#endif
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+// Soft decision symbols packed as 4bit signed values, two to a byte
+// Symbol i is in the low nibble of byte (i/2) when i is even and the high nibble when odd
+// Values are clamped to [-7,+7] so they are symmetric around the decision boundary
+constexpr int8_t NIBBLE_SOFT_DECISION_HIGH = +7;
+constexpr int8_t NIBBLE_SOFT_DECISION_LOW = -7;
+
+// Lookup tables from a nibble to the symbol value a decoder expects
+struct NibbleLUT {
+    alignas(16) int8_t values[16];
+};
+
+// Signed soft decision symbols used by our decoders
+static NibbleLUT get_nibble_lut_signed() {
+    NibbleLUT lut;
+    for (int i = 0; i < 16; i++) {
+        const int value = (i < 8) ? i : (i-16);
+        lut.values[i] = int8_t((value < NIBBLE_SOFT_DECISION_LOW) ? NIBBLE_SOFT_DECISION_LOW : value);
+    }
+    return lut;
+}
+
+// Signed soft decision symbols scaled to the full 8bit range used by ka9q decoders
+static NibbleLUT get_nibble_lut_full_scale() {
+    const auto signed_lut = get_nibble_lut_signed();
+    NibbleLUT lut;
+    constexpr int SCALE = 127;
+    constexpr int RANGE = int(NIBBLE_SOFT_DECISION_HIGH);
+    for (int i = 0; i < 16; i++) {
+        const int value = int(signed_lut.values[i]);
+        const int rounding = (value < 0) ? -(RANGE/2) : (RANGE/2);
+        lut.values[i] = int8_t((value*SCALE + rounding) / RANGE);
+    }
+    return lut;
+}
+
+static void pack_nibbles(const int8_t* symbols, uint8_t* packed, const size_t total_symbols) {
+    for (size_t i = 0u; i < total_symbols; i++) {
+        int8_t value = symbols[i];
+        if (value > NIBBLE_SOFT_DECISION_HIGH) value = NIBBLE_SOFT_DECISION_HIGH;
+        if (value < NIBBLE_SOFT_DECISION_LOW) value = NIBBLE_SOFT_DECISION_LOW;
+        const uint8_t nibble = uint8_t(value) & 0x0F;
+        if ((i % 2u) == 0u) {
+            packed[i/2u] = nibble;
+        } else {
+            packed[i/2u] |= uint8_t(nibble << 4);
+        }
+    }
+}
+
+// Expand packed nibbles through the lookup table using pshufb
+static void unpack_nibbles(const uint8_t* packed, int8_t* symbols, const size_t total_symbols, const NibbleLUT& lut) {
+    const size_t total_bytes = total_symbols/2u;
+    size_t i = 0u;
+#if defined(__AVX2__)
+    {
+        const __m256i lut_256 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(lut.values)));
+        const __m256i mask = _mm256_set1_epi8(0x0F);
+        for (; (i+32u) <= total_bytes; i += 32u) {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&packed[i]));
+            const __m256i lo = _mm256_shuffle_epi8(lut_256, _mm256_and_si256(x, mask));
+            const __m256i hi = _mm256_shuffle_epi8(lut_256, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+            // Unpack interleaves within each 128bit lane so swap the middle lanes back into order
+            const __m256i a = _mm256_unpacklo_epi8(lo, hi);
+            const __m256i b = _mm256_unpackhi_epi8(lo, hi);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&symbols[2u*i]),     _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&symbols[2u*i+32u]), _mm256_permute2x128_si256(a, b, 0x31));
+        }
+    }
+#endif
+    {
+        const __m128i lut_128 = _mm_load_si128(reinterpret_cast<const __m128i*>(lut.values));
+        const __m128i mask = _mm_set1_epi8(0x0F);
+        for (; (i+16u) <= total_bytes; i += 16u) {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&packed[i]));
+            const __m128i lo = _mm_shuffle_epi8(lut_128, _mm_and_si128(x, mask));
+            const __m128i hi = _mm_shuffle_epi8(lut_128, _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&symbols[2u*i]),     _mm_unpacklo_epi8(lo, hi));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&symbols[2u*i+16u]), _mm_unpackhi_epi8(lo, hi));
+        }
+    }
+    for (; i < total_bytes; i++) {
+        symbols[2u*i]    = lut.values[packed[i] & 0x0F];
+        symbols[2u*i+1u] = lut.values[packed[i] >> 4];
+    }
+    if ((total_symbols % 2u) == 1u) {
+        symbols[total_symbols-1u] = lut.values[packed[total_bytes] & 0x0F];
+    }
+}
+
+// For decoders that only take unpacked symbols, expand a block at a time into a buffer that stays in L1
+// update(symbols, total_symbols) is called with a multiple of R symbols
+template <size_t R, size_t BLOCK_BITS = 256u, typename F>
+static void update_with_unpacked_nibbles(const uint8_t* packed, const size_t total_symbols, const NibbleLUT& lut, F&& update) {
+    static_assert((BLOCK_BITS % 2u) == 0u, "Blocks must start on a byte boundary");
+    constexpr size_t BLOCK_SYMBOLS = BLOCK_BITS*R;
+    alignas(32) int8_t block[BLOCK_SYMBOLS];
+    for (size_t i = 0u; i < total_symbols; i += BLOCK_SYMBOLS) {
+        const size_t remain = total_symbols-i;
+        const size_t total_block_symbols = (remain > BLOCK_SYMBOLS) ? BLOCK_SYMBOLS : remain;
+        unpack_nibbles(&packed[i/2u], block, total_block_symbols, lut);
+        update(block, total_block_symbols);
+    }
+}
@@ -4,53 +4,42 @@
  */
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
+#include <type_traits>
 
-/// @brief Utility class for getting the parity of a primitive's bits
-///        Odd bits = 1, Even bits = 0
-class ParityTable 
-{
-private:
-    uint8_t* table;
-    ParityTable() {
-        constexpr size_t N = 256;
-        table = new uint8_t[N];
-        for (size_t i = 0u; i < N; i++) {
-            uint8_t parity = 0u;
-            uint8_t b = static_cast<uint8_t>(i);
-            for (size_t j = 0u; j < 8u; j++) {
-                parity ^= (b & 0b1);
-                b = b >> 1u;
-            }
-            table[i] = parity;
+struct ParityLUT {
+    uint8_t values[256];
+};
+
+constexpr ParityLUT make_parity_lut() {
+    ParityLUT lut{};
+    for (size_t i = 0u; i < 256u; i++) {
+        uint8_t parity = 0u;
+        uint8_t b = static_cast<uint8_t>(i);
+        for (size_t j = 0u; j < 8u; j++) {
+            parity ^= (b & 0b1);
+            b = b >> 1u;
         }
+        lut.values[i] = parity;
     }
-    ~ParityTable() {
-        delete [] table;
-    }
-    ParityTable(const ParityTable&) = delete;
-    ParityTable(ParityTable&&) = delete;
-    ParityTable& operator=(const ParityTable&) = delete;
-    ParityTable& operator=(ParityTable&&) = delete;
-public:
-    static 
-    const ParityTable& get() {
-        static ParityTable parity_table;
-        return parity_table;
-    }
+    return lut;
+}
 
-    uint8_t parse(uint8_t x) const {
-        return table[x];
-    }
+// Generated at compile time so it lives in .rodata instead of being allocated on first use
+inline constexpr ParityLUT PARITY_LUT = make_parity_lut();
 
-    template <typename T>
-    uint8_t parse(T x) const {
-        constexpr size_t N = sizeof(x);
-        size_t TOTAL_BITS = N*8;
-        while (TOTAL_BITS > 8u) {
-            TOTAL_BITS = TOTAL_BITS >> 1;
-            x = x ^ (x >> TOTAL_BITS);
-        }
-        return table[uint8_t(x & T(0xFF))];
+/// @brief Get the parity of a primitive's bits
+///        Odd bits = 1, Even bits = 0
+template <typename T>
+constexpr uint8_t get_parity(const T x) {
+    static_assert(std::is_integral<T>::value, "Parity is only defined for integers");
+    using U = typename std::make_unsigned<T>::type;
+    U y = static_cast<U>(x);
+    size_t TOTAL_BITS = sizeof(U)*8u;
+    while (TOTAL_BITS > 8u) {
+        TOTAL_BITS = TOTAL_BITS >> 1;
+        y = U(y ^ (y >> TOTAL_BITS));
     }
-};
+    return PARITY_LUT.values[uint8_t(y & U(0xFF))];
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware performance counters for a benchmark phase through a Linux perf_event_open group
+// The counters are unavailable on other platforms or when perf_event_paranoid or a container forbids them
+// In that case every count reads as zero and nothing is reported
+
+enum class PerfCounterType: size_t {
+    CYCLES = 0,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    DTLB_MISSES,
+    BRANCH_MISSES,
+};
+
+constexpr size_t TOTAL_PERF_COUNTERS = 6;
+
+static const char* const PERF_COUNTER_NAMES[TOTAL_PERF_COUNTERS] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses", "branch_misses",
+};
+
+struct PerfCounts {
+    uint64_t values[TOTAL_PERF_COUNTERS] = { 0 };
+};
+
+// All counters are opened once as a single group so they are scheduled onto the PMU together
+class PerfCounterGroup
+{
+private:
+    int m_fds[TOTAL_PERF_COUNTERS];
+    int m_group_index[TOTAL_PERF_COUNTERS];     // position of each counter in a group read, -1 if it couldn't be opened
+    size_t m_total_opened;
+#if defined(__linux__)
+    PerfCounterGroup(): m_total_opened(0) {
+        for (size_t i = 0u; i < TOTAL_PERF_COUNTERS; i++) {
+            m_fds[i] = -1;
+            m_group_index[i] = -1;
+        }
+        auto get_cache_config = [](uint64_t cache, uint64_t op, uint64_t result) {
+            return cache | (op << 8) | (result << 16);
+        };
+        const struct { uint32_t type; uint64_t config; } events[TOTAL_PERF_COUNTERS] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HW_CACHE, get_cache_config(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+            { PERF_TYPE_HW_CACHE, get_cache_config(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+            { PERF_TYPE_HW_CACHE, get_cache_config(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        };
+        int leader_fd = -1;
+        for (size_t i = 0u; i < TOTAL_PERF_COUNTERS; i++) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[i].type;
+            attr.config = events[i].config;
+            attr.disabled = (leader_fd == -1) ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            const int fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, leader_fd, 0));
+            // Without the first counter there is no group so give up on all of them
+            if (fd == -1) {
+                if (leader_fd == -1) return;
+                continue;
+            }
+            if (leader_fd == -1) leader_fd = fd;
+            m_fds[i] = fd;
+            m_group_index[i] = int(m_total_opened);
+            m_total_opened++;
+        }
+    }
+    ~PerfCounterGroup() {
+        for (size_t i = 0u; i < TOTAL_PERF_COUNTERS; i++) {
+            if (m_fds[i] != -1) close(m_fds[i]);
+        }
+    }
+#else
+    PerfCounterGroup(): m_total_opened(0) {
+        for (size_t i = 0u; i < TOTAL_PERF_COUNTERS; i++) {
+            m_fds[i] = -1;
+            m_group_index[i] = -1;
+        }
+    }
+#endif
+    PerfCounterGroup(const PerfCounterGroup&) = delete;
+    PerfCounterGroup(PerfCounterGroup&&) = delete;
+    PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+    PerfCounterGroup& operator=(PerfCounterGroup&&) = delete;
+public:
+    static
+    PerfCounterGroup& get() {
+        static PerfCounterGroup group;
+        return group;
+    }
+
+    bool is_available() const { return m_total_opened > 0u; }
+    bool is_available(const PerfCounterType type) const { return m_group_index[size_t(type)] != -1; }
+
+    void start() {
+#if defined(__linux__)
+        if (!is_available()) return;
+        ioctl(m_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    PerfCounts stop() {
+        PerfCounts counts;
+#if defined(__linux__)
+        if (!is_available()) return counts;
+        ioctl(m_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        // { nr, time_enabled, time_running, values[nr] }
+        uint64_t data[3 + TOTAL_PERF_COUNTERS] = { 0 };
+        if (read(m_fds[0], data, sizeof(data)) <= 0) return counts;
+        const uint64_t time_enabled = data[1];
+        const uint64_t time_running = data[2];
+        if (time_running == 0u) return counts;
+        // Scale up if the group was multiplexed with other users of the PMU
+        const double scale = double(time_enabled) / double(time_running);
+        for (size_t i = 0u; i < TOTAL_PERF_COUNTERS; i++) {
+            const int index = m_group_index[i];
+            if (index == -1) continue;
+            counts.values[i] = uint64_t(double(data[3+index]) * scale);
+        }
+#endif
+        return counts;
+    }
+};
+
+// Counts events from construction until get_delta() like Timer does for elapsed time
+class PerfCounters
+{
+public:
+    PerfCounters() {
+        PerfCounterGroup::get().start();
+    }
+    PerfCounts get_delta() {
+        return PerfCounterGroup::get().stop();
+    }
+};
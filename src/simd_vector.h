@@ -0,0 +1,183 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include <immintrin.h>
+
+// Thin wrapper over the x86 vector registers so a kernel can be written once for every width
+// Each width has the same set of static functions, the lane type is given by the suffix
+// Comparisons return a vector with every bit of a true lane set so they can be used as masks
+// Byte shuffles only move bytes within each 128bit lane like pshufb does
+// Interleaves work across the full width, i.e. interleave_lo takes the lower half of each input
+// Widths are picked at compile time from the instruction sets the translation unit is built for
+
+struct SimdVector128 {
+    using reg_t = __m128i;
+    static constexpr size_t WIDTH = 16;
+
+    static reg_t load(const void* x) { return _mm_load_si128(reinterpret_cast<const __m128i*>(x)); }
+    static reg_t loadu(const void* x) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(x)); }
+    static void store(void* x, reg_t a) { _mm_store_si128(reinterpret_cast<__m128i*>(x), a); }
+    static void storeu(void* x, reg_t a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(x), a); }
+    static reg_t zero() { return _mm_setzero_si128(); }
+    static reg_t set1_u8(uint8_t x) { return _mm_set1_epi8(char(x)); }
+    static reg_t set1_i16(int16_t x) { return _mm_set1_epi16(x); }
+    // Copies a 16 byte table into every 128bit lane for use with shuffle_u8
+    static reg_t broadcast_lane(const void* x) { return loadu(x); }
+
+    static reg_t bit_and(reg_t a, reg_t b) { return _mm_and_si128(a, b); }
+    static reg_t bit_or(reg_t a, reg_t b) { return _mm_or_si128(a, b); }
+    static reg_t bit_xor(reg_t a, reg_t b) { return _mm_xor_si128(a, b); }
+    static reg_t bit_andnot(reg_t a, reg_t b) { return _mm_andnot_si128(a, b); }    // ~a & b
+    // Bitwise select rather than blendv since AVX512VL compilers fuse it into a single vpternlog
+    static reg_t select(reg_t mask, reg_t if_true, reg_t if_false) {
+        return _mm_or_si128(_mm_and_si128(mask, if_true), _mm_andnot_si128(mask, if_false));
+    }
+
+    static reg_t add_u8(reg_t a, reg_t b) { return _mm_add_epi8(a, b); }
+    static reg_t sub_u8(reg_t a, reg_t b) { return _mm_sub_epi8(a, b); }
+    static reg_t min_u8(reg_t a, reg_t b) { return _mm_min_epu8(a, b); }
+    static reg_t avg_u8(reg_t a, reg_t b) { return _mm_avg_epu8(a, b); }
+    static reg_t cmpgt_i8(reg_t a, reg_t b) { return _mm_cmpgt_epi8(a, b); }
+    static reg_t shuffle_u8(reg_t table, reg_t index) { return _mm_shuffle_epi8(table, index); }
+    static uint64_t movemask_u8(reg_t a) { return uint64_t(uint32_t(_mm_movemask_epi8(a))); }
+    static reg_t interleave_lo_u8(reg_t a, reg_t b) { return _mm_unpacklo_epi8(a, b); }
+    static reg_t interleave_hi_u8(reg_t a, reg_t b) { return _mm_unpackhi_epi8(a, b); }
+
+    static reg_t add_i16(reg_t a, reg_t b) { return _mm_add_epi16(a, b); }
+    static reg_t sub_i16(reg_t a, reg_t b) { return _mm_sub_epi16(a, b); }
+    static reg_t min_i16(reg_t a, reg_t b) { return _mm_min_epi16(a, b); }
+    static reg_t cmpgt_i16(reg_t a, reg_t b) { return _mm_cmpgt_epi16(a, b); }
+    template <int N>
+    static reg_t srli_i16(reg_t a) { return _mm_srli_epi16(a, N); }
+    static reg_t interleave_lo_i16(reg_t a, reg_t b) { return _mm_unpacklo_epi16(a, b); }
+    static reg_t interleave_hi_i16(reg_t a, reg_t b) { return _mm_unpackhi_epi16(a, b); }
+};
+
+#if defined(__AVX2__)
+struct SimdVector256 {
+    using reg_t = __m256i;
+    static constexpr size_t WIDTH = 32;
+
+    static reg_t load(const void* x) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(x)); }
+    static reg_t loadu(const void* x) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x)); }
+    static void store(void* x, reg_t a) { _mm256_store_si256(reinterpret_cast<__m256i*>(x), a); }
+    static void storeu(void* x, reg_t a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(x), a); }
+    static reg_t zero() { return _mm256_setzero_si256(); }
+    static reg_t set1_u8(uint8_t x) { return _mm256_set1_epi8(char(x)); }
+    static reg_t set1_i16(int16_t x) { return _mm256_set1_epi16(x); }
+    static reg_t broadcast_lane(const void* x) { return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x))); }
+
+    static reg_t bit_and(reg_t a, reg_t b) { return _mm256_and_si256(a, b); }
+    static reg_t bit_or(reg_t a, reg_t b) { return _mm256_or_si256(a, b); }
+    static reg_t bit_xor(reg_t a, reg_t b) { return _mm256_xor_si256(a, b); }
+    static reg_t bit_andnot(reg_t a, reg_t b) { return _mm256_andnot_si256(a, b); }
+    static reg_t select(reg_t mask, reg_t if_true, reg_t if_false) {
+        return _mm256_or_si256(_mm256_and_si256(mask, if_true), _mm256_andnot_si256(mask, if_false));
+    }
+
+    static reg_t add_u8(reg_t a, reg_t b) { return _mm256_add_epi8(a, b); }
+    static reg_t sub_u8(reg_t a, reg_t b) { return _mm256_sub_epi8(a, b); }
+    static reg_t min_u8(reg_t a, reg_t b) { return _mm256_min_epu8(a, b); }
+    static reg_t avg_u8(reg_t a, reg_t b) { return _mm256_avg_epu8(a, b); }
+    static reg_t cmpgt_i8(reg_t a, reg_t b) { return _mm256_cmpgt_epi8(a, b); }
+    static reg_t shuffle_u8(reg_t table, reg_t index) { return _mm256_shuffle_epi8(table, index); }
+    static uint64_t movemask_u8(reg_t a) { return uint64_t(uint32_t(_mm256_movemask_epi8(a))); }
+    // unpack works within each 128bit lane so the halves are swapped back into order
+    static reg_t interleave_lo_u8(reg_t a, reg_t b) {
+        return _mm256_permute2x128_si256(_mm256_unpacklo_epi8(a, b), _mm256_unpackhi_epi8(a, b), 0x20);
+    }
+    static reg_t interleave_hi_u8(reg_t a, reg_t b) {
+        return _mm256_permute2x128_si256(_mm256_unpacklo_epi8(a, b), _mm256_unpackhi_epi8(a, b), 0x31);
+    }
+
+    static reg_t add_i16(reg_t a, reg_t b) { return _mm256_add_epi16(a, b); }
+    static reg_t sub_i16(reg_t a, reg_t b) { return _mm256_sub_epi16(a, b); }
+    static reg_t min_i16(reg_t a, reg_t b) { return _mm256_min_epi16(a, b); }
+    static reg_t cmpgt_i16(reg_t a, reg_t b) { return _mm256_cmpgt_epi16(a, b); }
+    template <int N>
+    static reg_t srli_i16(reg_t a) { return _mm256_srli_epi16(a, N); }
+    static reg_t interleave_lo_i16(reg_t a, reg_t b) {
+        return _mm256_permute2x128_si256(_mm256_unpacklo_epi16(a, b), _mm256_unpackhi_epi16(a, b), 0x20);
+    }
+    static reg_t interleave_hi_i16(reg_t a, reg_t b) {
+        return _mm256_permute2x128_si256(_mm256_unpacklo_epi16(a, b), _mm256_unpackhi_epi16(a, b), 0x31);
+    }
+};
+#endif
+
+#if defined(__AVX512BW__)
+struct SimdVector512 {
+    using reg_t = __m512i;
+    static constexpr size_t WIDTH = 64;
+
+    static reg_t load(const void* x) { return _mm512_load_si512(x); }
+    static reg_t loadu(const void* x) { return _mm512_loadu_si512(x); }
+    static void store(void* x, reg_t a) { _mm512_store_si512(x, a); }
+    static void storeu(void* x, reg_t a) { _mm512_storeu_si512(x, a); }
+    static reg_t zero() { return _mm512_setzero_si512(); }
+    static reg_t set1_u8(uint8_t x) { return _mm512_set1_epi8(char(x)); }
+    static reg_t set1_i16(int16_t x) { return _mm512_set1_epi16(x); }
+    // Zero masked form since gcc's unmasked broadcast passes an undefined register as the merge source
+    static reg_t broadcast_lane(const void* x) { return _mm512_maskz_broadcast_i32x4(__mmask16(0xFFFF), _mm_loadu_si128(reinterpret_cast<const __m128i*>(x))); }
+
+    static reg_t bit_and(reg_t a, reg_t b) { return _mm512_and_si512(a, b); }
+    static reg_t bit_or(reg_t a, reg_t b) { return _mm512_or_si512(a, b); }
+    static reg_t bit_xor(reg_t a, reg_t b) { return _mm512_xor_si512(a, b); }
+    static reg_t bit_andnot(reg_t a, reg_t b) { return _mm512_andnot_si512(a, b); }
+    static reg_t select(reg_t mask, reg_t if_true, reg_t if_false) {
+        return _mm512_ternarylogic_epi64(mask, if_true, if_false, 0xCA);
+    }
+
+    static reg_t add_u8(reg_t a, reg_t b) { return _mm512_add_epi8(a, b); }
+    static reg_t sub_u8(reg_t a, reg_t b) { return _mm512_sub_epi8(a, b); }
+    static reg_t min_u8(reg_t a, reg_t b) { return _mm512_min_epu8(a, b); }
+    static reg_t avg_u8(reg_t a, reg_t b) { return _mm512_avg_epu8(a, b); }
+    // Comparisons produce mask registers so expand them back into vectors
+    static reg_t cmpgt_i8(reg_t a, reg_t b) { return _mm512_movm_epi8(_mm512_cmpgt_epi8_mask(a, b)); }
+    static reg_t shuffle_u8(reg_t table, reg_t index) { return _mm512_shuffle_epi8(table, index); }
+    static uint64_t movemask_u8(reg_t a) { return uint64_t(_mm512_movepi8_mask(a)); }
+    // Select 128bit lanes of the per lane unpacks so the result is in order
+    static reg_t interleave_lo_u8(reg_t a, reg_t b) {
+        const __m512i index = _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11);
+        return _mm512_permutex2var_epi64(_mm512_unpacklo_epi8(a, b), index, _mm512_unpackhi_epi8(a, b));
+    }
+    static reg_t interleave_hi_u8(reg_t a, reg_t b) {
+        const __m512i index = _mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15);
+        return _mm512_permutex2var_epi64(_mm512_unpacklo_epi8(a, b), index, _mm512_unpackhi_epi8(a, b));
+    }
+
+    static reg_t add_i16(reg_t a, reg_t b) { return _mm512_add_epi16(a, b); }
+    static reg_t sub_i16(reg_t a, reg_t b) { return _mm512_sub_epi16(a, b); }
+    static reg_t min_i16(reg_t a, reg_t b) { return _mm512_min_epi16(a, b); }
+    static reg_t cmpgt_i16(reg_t a, reg_t b) { return _mm512_movm_epi16(_mm512_cmpgt_epi16_mask(a, b)); }
+    template <int N>
+    static reg_t srli_i16(reg_t a) { return _mm512_srli_epi16(a, N); }
+    static reg_t interleave_lo_i16(reg_t a, reg_t b) {
+        const __m512i index = _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11);
+        return _mm512_permutex2var_epi64(_mm512_unpacklo_epi16(a, b), index, _mm512_unpackhi_epi16(a, b));
+    }
+    static reg_t interleave_hi_i16(reg_t a, reg_t b) {
+        const __m512i index = _mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15);
+        return _mm512_permutex2var_epi64(_mm512_unpacklo_epi16(a, b), index, _mm512_unpackhi_epi16(a, b));
+    }
+};
+#endif
+
+// Widest vector available that holds at most MAX_BYTES
+// Kernels with fewer butterflies than a wide register holds fall back to a narrower one
+template <size_t MAX_BYTES>
+struct SimdVectorSelect {
+#if defined(__AVX512BW__)
+    using type = std::conditional_t<(MAX_BYTES >= 64), SimdVector512,
+                 std::conditional_t<(MAX_BYTES >= 32), SimdVector256, SimdVector128>>;
+#elif defined(__AVX2__)
+    using type = std::conditional_t<(MAX_BYTES >= 32), SimdVector256, SimdVector128>;
+#else
+    using type = SimdVector128;
+#endif
+};
+
+template <size_t MAX_BYTES>
+using SimdVectorWidest = typename SimdVectorSelect<MAX_BYTES>::type;
@@ -3,11 +3,18 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include "./decision_store.h"
+#include "./metric_counters.h"
 #include "spiral27.h"
 #include "spiral29.h"
 #include "spiral47.h"
 #include "spiral49.h"
 #include "spiral615.h"
+#include "spiral27_avx2.h"
+#include "spiral29_avx2.h"
+#include "spiral47_avx2.h"
+#include "spiral49_avx2.h"
+#include "spiral615_avx2.h"
 
 // Match the interface for ka9q decoders to be like ours for testing
 template <
@@ -17,7 +24,10 @@ template <
     int (*vRK_init)(vRK*,int),
     void (*vRK_update)(vRK*, uint8_t*,int),
     int (*vRK_chainback)(vRK*,uint8_t*,uint32_t, uint32_t),
-    void (*vRK_delete)(vRK*)
+    void (*vRK_delete)(vRK*),
+    void (*vRK_set_decision_store)(vRK*,int),
+    unsigned int (*vRK_get_best_state)(vRK*),
+    const MetricCounters* (*vRK_get_metric_counters)(vRK*)
 >
 class spiral_viterbi_interface {
 public:
@@ -43,21 +53,44 @@ public:
         if (m_inner != nullptr) vRK_delete(m_inner);
         m_inner = nullptr;
     }
+    void set_decision_store(DecisionStorePolicy policy) {
+        vRK_set_decision_store(m_inner, int(policy));
+    }
     void reset() {
         vRK_init(m_inner, 0);
     }
-    void update(uint8_t* sym, size_t total_syms) {
+    // Symbols are signed like our decoders so no offset binary conversion pass is needed
+    void update(int8_t* sym, size_t total_syms) {
         assert(total_syms % _R == 0);
         const size_t total_bits = total_syms / _R;
-        vRK_update(m_inner, sym, int(total_bits));
+        vRK_update(m_inner, reinterpret_cast<uint8_t*>(sym), int(total_bits));
+    }
+    void chainback(uint8_t* data, size_t total_bits, uint32_t end_state=0) {
+        vRK_chainback(m_inner, data, uint32_t(total_bits), end_state);
+    }
+    // For unterminated streams start chainback from the state with the best path metric
+    // The last K-1 decoded bits are held in the returned state
+    uint32_t get_best_state() {
+        return uint32_t(vRK_get_best_state(m_inner));
+    }
+    uint32_t chainback_best_state(uint8_t* data, size_t total_bits) {
+        const uint32_t endstate = get_best_state();
+        vRK_chainback(m_inner, data, uint32_t(total_bits), endstate);
+        return endstate;
     }
-    void chainback(uint8_t* data, size_t total_bits) {
-        vRK_chainback(m_inner, data, uint32_t(total_bits), 0);
+    // Only updated when built with VITERBI_METRIC_COUNTERS
+    const MetricCounters& get_metric_counters() {
+        return *vRK_get_metric_counters(m_inner);
     }
 };
 
-using spiral27_i = spiral_viterbi_interface<7,2,spiral27,create_spiral27,init_spiral27,update_spiral27,chainback_spiral27, delete_spiral27>;
-using spiral29_i = spiral_viterbi_interface<9,2,spiral29,create_spiral29,init_spiral29,update_spiral29,chainback_spiral29, delete_spiral29>;
-using spiral47_i = spiral_viterbi_interface<7,4,spiral47,create_spiral47,init_spiral47,update_spiral47,chainback_spiral47, delete_spiral47>;
-using spiral49_i = spiral_viterbi_interface<9,4,spiral49,create_spiral49,init_spiral49,update_spiral49,chainback_spiral49, delete_spiral49>;
-using spiral615_i = spiral_viterbi_interface<15,6,spiral615,create_spiral615,init_spiral615,update_spiral615,chainback_spiral615, delete_spiral615>;
+using spiral27_i = spiral_viterbi_interface<7,2,spiral27,create_spiral27,init_spiral27,update_spiral27,chainback_spiral27, delete_spiral27, set_decision_store_spiral27, get_best_state_spiral27, get_metric_counters_spiral27>;
+using spiral29_i = spiral_viterbi_interface<9,2,spiral29,create_spiral29,init_spiral29,update_spiral29,chainback_spiral29, delete_spiral29, set_decision_store_spiral29, get_best_state_spiral29, get_metric_counters_spiral29>;
+using spiral47_i = spiral_viterbi_interface<7,4,spiral47,create_spiral47,init_spiral47,update_spiral47,chainback_spiral47, delete_spiral47, set_decision_store_spiral47, get_best_state_spiral47, get_metric_counters_spiral47>;
+using spiral49_i = spiral_viterbi_interface<9,4,spiral49,create_spiral49,init_spiral49,update_spiral49,chainback_spiral49, delete_spiral49, set_decision_store_spiral49, get_best_state_spiral49, get_metric_counters_spiral49>;
+using spiral615_i = spiral_viterbi_interface<15,6,spiral615,create_spiral615,init_spiral615,update_spiral615,chainback_spiral615, delete_spiral615, set_decision_store_spiral615, get_best_state_spiral615, get_metric_counters_spiral615>;
+using spiral27_avx2_i = spiral_viterbi_interface<7,2,spiral27_avx2,create_spiral27_avx2,init_spiral27_avx2,update_spiral27_avx2,chainback_spiral27_avx2, delete_spiral27_avx2, set_decision_store_spiral27_avx2, get_best_state_spiral27_avx2, get_metric_counters_spiral27_avx2>;
+using spiral29_avx2_i = spiral_viterbi_interface<9,2,spiral29_avx2,create_spiral29_avx2,init_spiral29_avx2,update_spiral29_avx2,chainback_spiral29_avx2, delete_spiral29_avx2, set_decision_store_spiral29_avx2, get_best_state_spiral29_avx2, get_metric_counters_spiral29_avx2>;
+using spiral47_avx2_i = spiral_viterbi_interface<7,4,spiral47_avx2,create_spiral47_avx2,init_spiral47_avx2,update_spiral47_avx2,chainback_spiral47_avx2, delete_spiral47_avx2, set_decision_store_spiral47_avx2, get_best_state_spiral47_avx2, get_metric_counters_spiral47_avx2>;
+using spiral49_avx2_i = spiral_viterbi_interface<9,4,spiral49_avx2,create_spiral49_avx2,init_spiral49_avx2,update_spiral49_avx2,chainback_spiral49_avx2, delete_spiral49_avx2, set_decision_store_spiral49_avx2, get_best_state_spiral49_avx2, get_metric_counters_spiral49_avx2>;
+using spiral615_avx2_i = spiral_viterbi_interface<15,6,spiral615_avx2,create_spiral615_avx2,init_spiral615_avx2,update_spiral615_avx2,chainback_spiral615_avx2, delete_spiral615_avx2, set_decision_store_spiral615_avx2, get_best_state_spiral615_avx2, get_metric_counters_spiral615_avx2>;
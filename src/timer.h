@@ -19,3 +19,97 @@ public:
         return std::chrono::duration_cast<T>(dt_delta).count();
     }
 };
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TSC_TIMER_AVAILABLE 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#define TSC_TIMER_AVAILABLE 0
+#endif
+
+// Fenced timestamp counter reads so the measured region can't be reordered around them
+// lfence before rdtsc waits for earlier instructions, rdtscp followed by lfence holds back later ones
+static inline uint64_t read_tsc_start() {
+#if TSC_TIMER_AVAILABLE
+    _mm_lfence();
+    const uint64_t tsc = __rdtsc();
+    _mm_lfence();
+    return tsc;
+#else
+    return 0;
+#endif
+}
+
+static inline uint64_t read_tsc_end() {
+#if TSC_TIMER_AVAILABLE
+    unsigned int aux;
+    const uint64_t tsc = __rdtscp(&aux);
+    _mm_lfence();
+    return tsc;
+#else
+    return 0;
+#endif
+}
+
+// The timestamp counter ticks at a constant reference frequency regardless of frequency scaling
+// Measure that frequency and the cost of an empty start/end pair once per run
+class TscCalibration
+{
+public:
+    uint64_t overhead_cycles = 0;
+    double frequency_hz = 0.0;
+private:
+    TscCalibration() {
+#if TSC_TIMER_AVAILABLE
+        constexpr int TOTAL_OVERHEAD_TRIALS = 1024;
+        uint64_t min_overhead = UINT64_MAX;
+        for (int i = 0; i < TOTAL_OVERHEAD_TRIALS; i++) {
+            const uint64_t start = read_tsc_start();
+            const uint64_t end = read_tsc_end();
+            const uint64_t delta = end - start;
+            min_overhead = (delta < min_overhead) ? delta : min_overhead;
+        }
+        overhead_cycles = min_overhead;
+
+        constexpr auto CALIBRATION_TIME = std::chrono::milliseconds(50);
+        const auto time_start = std::chrono::steady_clock::now();
+        const uint64_t tsc_start = read_tsc_start();
+        auto time_end = time_start;
+        while ((time_end - time_start) < CALIBRATION_TIME) {
+            time_end = std::chrono::steady_clock::now();
+        }
+        const uint64_t tsc_end = read_tsc_end();
+        const double elapsed_seconds = std::chrono::duration<double>(time_end - time_start).count();
+        frequency_hz = double(tsc_end - tsc_start) / elapsed_seconds;
+#endif
+    }
+public:
+    static
+    const TscCalibration& get() {
+        static TscCalibration calibration;
+        return calibration;
+    }
+    static constexpr bool is_available() { return TSC_TIMER_AVAILABLE != 0; }
+};
+
+class TscTimer
+{
+private:
+    uint64_t m_start;
+public:
+    TscTimer() {
+        m_start = read_tsc_start();
+    }
+
+    // Reference cycles with the timer's own overhead removed
+    uint64_t get_delta() {
+        const uint64_t end = read_tsc_end();
+        const uint64_t delta = end - m_start;
+        const uint64_t overhead = TscCalibration::get().overhead_cycles;
+        return (delta > overhead) ? (delta - overhead) : 0;
+    }
+};
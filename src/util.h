@@ -1,7 +1,10 @@
 #pragma once
-#include <random>
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
 #include <stdint.h>
 #include <assert.h>
+#include <immintrin.h>
 #include "viterbi/convolutional_encoder.h"
 #include "./bitcount.h"
 
@@ -61,12 +64,93 @@ static size_t encode_data(
     return total_output_symbols;
 }
 
+// Encode into hard decision symbols packed 8 to a byte, symbol i is at bit (i%8) of byte (i/8)
+static size_t encode_data_hard_packed(
+    ConvolutionalEncoder* enc,
+    const uint8_t* input_bytes, const size_t total_input_bytes,
+    uint8_t* output_bytes, const size_t max_output_bytes)
+{
+    const size_t K = enc->K;
+    const size_t R = enc->R;
+
+    const size_t total_input_bits = total_input_bytes*8;
+    const size_t total_tail_bits = K-1;
+    const size_t total_output_symbols = (total_input_bits + total_tail_bits) * R;
+    assert(((total_output_symbols+7u)/8u) <= max_output_bytes);
+    for (size_t i = 0u; i < max_output_bytes; i++) {
+        output_bytes[i] = 0x00;
+    }
+
+    size_t curr_output_symbol = 0u;
+    auto push_symbols = [&](const uint8_t* buf, const size_t total_bits) {
+        for (size_t i = 0u; i < total_bits; i++) {
+            const uint8_t bit = (buf[i/8] >> (i%8)) & 0b1;
+            output_bytes[curr_output_symbol/8] |= uint8_t(bit << (curr_output_symbol%8));
+            curr_output_symbol++;
+        }
+    };
+
+    auto symbols = std::vector<uint8_t>(R);
+
+    // encode input bytes
+    for (size_t i = 0u; i < total_input_bytes; i++) {
+        enc->consume_byte(input_bytes[i], symbols.data());
+        push_symbols(symbols.data(), 8u*R);
+    }
+
+    // terminate tail at state 0
+    for (size_t i = 0u; i < total_tail_bits; ) {
+        const size_t remain_bits = total_tail_bits-i;
+        const size_t total_bits = (remain_bits > 8) ? 8 : remain_bits;
+        enc->consume_byte(0x00, symbols.data());
+        push_symbols(symbols.data(), total_bits*R);
+        i += total_bits;
+    }
+
+    assert(curr_output_symbol == total_output_symbols);
+    return total_output_symbols;
+}
+
+// Popcount of the xor with a nibble lookup (pshufb) summed by psadbw so whole vectors are counted at once
 static size_t get_total_bit_errors(const uint8_t* x0, const uint8_t* x1, const size_t N) {
-    auto& bitcount_table = BitcountTable::get();
     size_t total_errors = 0u;
-    for (size_t i = 0u; i < N; i++) {
+    size_t i = 0u;
+#if defined(__AVX2__)
+    {
+        const __m256i lut = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4, 0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+        const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+        __m256i sums = _mm256_setzero_si256();
+        for (; (i+32u) <= N; i += 32u) {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&x0[i]));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&x1[i]));
+            const __m256i x = _mm256_xor_si256(a, b);
+            const __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(x, nibble_mask));
+            const __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble_mask));
+            sums = _mm256_add_epi64(sums, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+        }
+        const __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+        total_errors += size_t(_mm_cvtsi128_si64(sum)) + size_t(_mm_extract_epi64(sum, 1));
+    }
+#endif
+#if defined(__SSSE3__) || defined(__AVX2__)
+    {
+        const __m128i lut = _mm_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+        const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+        __m128i sums = _mm_setzero_si128();
+        for (; (i+16u) <= N; i += 16u) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x0[i]));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x1[i]));
+            const __m128i x = _mm_xor_si128(a, b);
+            const __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(x, nibble_mask));
+            const __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(x, 4), nibble_mask));
+            sums = _mm_add_epi64(sums, _mm_sad_epu8(_mm_add_epi8(lo, hi), _mm_setzero_si128()));
+        }
+        total_errors += size_t(_mm_cvtsi128_si64(sums)) + size_t(_mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums)));
+    }
+#endif
+    for (; i < N; i++) {
         const uint8_t error_mask = x0[i] ^ x1[i];
-        const uint8_t bit_errors = bitcount_table.parse(error_mask);
+        const uint8_t bit_errors = get_bitcount(error_mask);
         total_errors += size_t(bit_errors);
     }
     return total_errors;
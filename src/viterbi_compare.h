@@ -0,0 +1,85 @@
+#ifndef VITERBI_COMPARE_H
+#define VITERBI_COMPARE_H
+
+/* Stable C interface over every decoder in the registry
+ * Services link libviterbi_compare and pick an engine by name at runtime to A/B test implementations
+ * Symbols are signed soft decisions spanning the full 8bit range, i.e. +127 for a 1 and -127 for a 0
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(VITERBI_COMPARE_BUILD)
+#define VITERBI_COMPARE_API __declspec(dllexport)
+#else
+#define VITERBI_COMPARE_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define VITERBI_COMPARE_API __attribute__((visibility("default")))
+#else
+#define VITERBI_COMPARE_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct viterbi_compare_decoder viterbi_compare_decoder;
+
+enum {
+    VITERBI_COMPARE_OK = 0,
+    VITERBI_COMPARE_ERROR_INVALID_ARGUMENT = -1,
+    VITERBI_COMPARE_ERROR_FRAME_OVERFLOW = -2,     /* more symbols or bits than the decoder was created for */
+    VITERBI_COMPARE_ERROR_FILE = -3,
+    VITERBI_COMPARE_ERROR_UNSUPPORTED = -4,         /* the engine can't do this, e.g. spiral splitting a frame over updates */
+    VITERBI_COMPARE_ERROR_INCOMPLETE_FRAME = -5,    /* chainback of more bits than have been updated */
+};
+
+enum {
+    VITERBI_COMPARE_PRECISION_U8 = 0,
+    VITERBI_COMPARE_PRECISION_U16 = 1,
+};
+
+/* Names of the engines the cpu supports for a code from fastest to slowest expected
+ * Writes up to max_names pointers to static strings and returns the total number available
+ */
+VITERBI_COMPARE_API size_t viterbi_compare_list_engines(size_t K, size_t R, const char** names, size_t max_names);
+
+/* Tuned engine choices from a wisdom file written by the benchmark's --autotune */
+VITERBI_COMPARE_API int viterbi_compare_load_wisdom(const char* filename);
+
+/* Decoder for frames of up to total_input_bits data bits followed by K-1 tail bits
+ * Returns NULL if the engine doesn't exist for the code, isn't supported by the cpu or allocation failed
+ */
+VITERBI_COMPARE_API viterbi_compare_decoder* viterbi_compare_create(size_t K, size_t R, const int* poly, size_t total_input_bits, const char* engine);
+
+/* Engine from the loaded wisdom otherwise the highest priority engine the cpu supports */
+VITERBI_COMPARE_API viterbi_compare_decoder* viterbi_compare_create_auto(size_t K, size_t R, const int* poly, size_t total_input_bits, int precision);
+
+VITERBI_COMPARE_API void viterbi_compare_destroy(viterbi_compare_decoder* decoder);
+
+VITERBI_COMPARE_API const char* viterbi_compare_get_engine(const viterbi_compare_decoder* decoder);
+
+/* Start a new frame */
+VITERBI_COMPARE_API int viterbi_compare_reset(viterbi_compare_decoder* decoder);
+
+/* Symbols can be given over several calls as long as each is a multiple of R
+ * Spiral engines need the whole frame in one call with an even number of bits
+ */
+VITERBI_COMPARE_API int viterbi_compare_update(viterbi_compare_decoder* decoder, const int8_t* symbols, size_t total_symbols);
+
+/* State with the lowest path metric for unterminated frames */
+VITERBI_COMPARE_API uint32_t viterbi_compare_get_best_state(viterbi_compare_decoder* decoder);
+
+/* Writes total_bits decoded bits packed MSB first into data tracing back from end_state, 0 for terminated frames
+ * Tracing back starts K-1 bits before the last update so total_bits+K-1 bits must have been updated since the reset
+ * otherwise VITERBI_COMPARE_ERROR_INCOMPLETE_FRAME is returned, e.g. an unterminated stream of N updated bits gives N-(K-1) bits
+ */
+VITERBI_COMPARE_API int viterbi_compare_chainback(viterbi_compare_decoder* decoder, uint8_t* data, size_t total_bits, uint32_t end_state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
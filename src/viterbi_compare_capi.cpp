@@ -0,0 +1,118 @@
+#include "./viterbi_compare.h"
+#include <exception>
+#include <memory>
+#include "./decoder_registry.h"
+#include "./decoder_wisdom.h"
+
+struct viterbi_compare_decoder {
+    const DecoderEntry* entry;
+    std::unique_ptr<DynamicDecoder> decoder;
+    size_t total_input_bits;
+    size_t total_transmit_bits;
+    size_t total_updated_bits;      // decoders don't bounds check their decisions buffer
+};
+
+// Exceptions can't cross the C boundary so a failed allocation becomes NULL
+static viterbi_compare_decoder* create_decoder(const DecoderEntry* entry, const int* poly, const size_t total_input_bits) {
+    if (entry == nullptr) return nullptr;
+    try {
+        auto decoder = std::make_unique<viterbi_compare_decoder>();
+        decoder->entry = entry;
+        decoder->total_input_bits = total_input_bits;
+        decoder->total_transmit_bits = total_input_bits + (entry->K-1u);
+        decoder->total_updated_bits = 0u;
+        decoder->decoder = entry->create(poly, decoder->total_transmit_bits);
+        decoder->decoder->reset();
+        return decoder.release();
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+}
+
+static bool is_valid_code(const size_t K, const size_t R, const int* poly, const size_t total_input_bits) {
+    return (K >= 2u) && (R >= 1u) && (poly != nullptr) && (total_input_bits > 0u);
+}
+
+size_t viterbi_compare_list_engines(size_t K, size_t R, const char** names, size_t max_names) {
+    size_t total_names = 0u;
+    for (const auto precision: { DecoderPrecision::U8, DecoderPrecision::U16 }) {
+        for (const auto* entry: get_decoder_candidates(K, R, precision)) {
+            if ((names != nullptr) && (total_names < max_names)) names[total_names] = entry->name;
+            total_names++;
+        }
+    }
+    return total_names;
+}
+
+int viterbi_compare_load_wisdom(const char* filename) {
+    if (filename == nullptr) return VITERBI_COMPARE_ERROR_INVALID_ARGUMENT;
+    try {
+        if (!DecoderWisdom::get().load(filename)) return VITERBI_COMPARE_ERROR_FILE;
+    } catch (const std::exception&) {
+        return VITERBI_COMPARE_ERROR_FILE;
+    }
+    return VITERBI_COMPARE_OK;
+}
+
+viterbi_compare_decoder* viterbi_compare_create(size_t K, size_t R, const int* poly, size_t total_input_bits, const char* engine) {
+    if (!is_valid_code(K, R, poly, total_input_bits) || (engine == nullptr)) return nullptr;
+    return create_decoder(find_decoder_by_name(K, R, engine), poly, total_input_bits);
+}
+
+viterbi_compare_decoder* viterbi_compare_create_auto(size_t K, size_t R, const int* poly, size_t total_input_bits, int precision) {
+    if (!is_valid_code(K, R, poly, total_input_bits)) return nullptr;
+    DecoderPrecision decoder_precision;
+    switch (precision) {
+    case VITERBI_COMPARE_PRECISION_U8:  decoder_precision = DecoderPrecision::U8; break;
+    case VITERBI_COMPARE_PRECISION_U16: decoder_precision = DecoderPrecision::U16; break;
+    default: return nullptr;
+    }
+    return create_decoder(find_tuned_decoder(K, R, decoder_precision, total_input_bits), poly, total_input_bits);
+}
+
+void viterbi_compare_destroy(viterbi_compare_decoder* decoder) {
+    delete decoder;
+}
+
+const char* viterbi_compare_get_engine(const viterbi_compare_decoder* decoder) {
+    if (decoder == nullptr) return nullptr;
+    return decoder->entry->name;
+}
+
+int viterbi_compare_reset(viterbi_compare_decoder* decoder) {
+    if (decoder == nullptr) return VITERBI_COMPARE_ERROR_INVALID_ARGUMENT;
+    decoder->decoder->reset();
+    decoder->total_updated_bits = 0u;
+    return VITERBI_COMPARE_OK;
+}
+
+int viterbi_compare_update(viterbi_compare_decoder* decoder, const int8_t* symbols, size_t total_symbols) {
+    if (decoder == nullptr) return VITERBI_COMPARE_ERROR_INVALID_ARGUMENT;
+    if (total_symbols == 0u) return VITERBI_COMPARE_OK;
+    const size_t R = decoder->entry->R;
+    if ((symbols == nullptr) || (total_symbols % R != 0u)) return VITERBI_COMPARE_ERROR_INVALID_ARGUMENT;
+    const size_t total_bits = total_symbols / R;
+    if (decoder->total_updated_bits + total_bits > decoder->total_transmit_bits) return VITERBI_COMPARE_ERROR_FRAME_OVERFLOW;
+    if (!decoder->entry->is_incremental_update) {
+        if ((decoder->total_updated_bits != 0u) || (total_bits % 2u != 0u)) return VITERBI_COMPARE_ERROR_UNSUPPORTED;
+    }
+    decoder->decoder->update(symbols, total_symbols);
+    decoder->total_updated_bits += total_bits;
+    return VITERBI_COMPARE_OK;
+}
+
+uint32_t viterbi_compare_get_best_state(viterbi_compare_decoder* decoder) {
+    if (decoder == nullptr) return 0u;
+    return decoder->decoder->get_best_state();
+}
+
+int viterbi_compare_chainback(viterbi_compare_decoder* decoder, uint8_t* data, size_t total_bits, uint32_t end_state) {
+    if ((decoder == nullptr) || (data == nullptr)) return VITERBI_COMPARE_ERROR_INVALID_ARGUMENT;
+    if (total_bits > decoder->total_input_bits) return VITERBI_COMPARE_ERROR_FRAME_OVERFLOW;
+    // Otherwise chainback would read decisions from before the reset or before the buffer
+    if (total_bits + (decoder->entry->K-1u) > decoder->total_updated_bits) return VITERBI_COMPARE_ERROR_INCOMPLETE_FRAME;
+    const uint32_t total_states = uint32_t(1u) << (decoder->entry->K-1u);
+    if (end_state >= total_states) return VITERBI_COMPARE_ERROR_INVALID_ARGUMENT;
+    decoder->decoder->chainback(data, total_bits, end_state);
+    return VITERBI_COMPARE_OK;
+}
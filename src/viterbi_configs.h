@@ -10,12 +10,12 @@ struct Decoder_Config {
     ViterbiDecoder_Config<error_t> decoder_config;
 };
 
-// All ka9q decoders use 0 and 255 as their soft decision symbol values
-// This is becauses it uses XOR to perform conditional negation
-static Decoder_Config<uint8_t, uint8_t> get_ka9q_offset_binary_config() {
+// All ka9q and spiral decoders take signed soft decision symbols spanning the full 8bit range
+// Their branch tables flip the sign bit so that XOR converts to offset binary and performs conditional negation
+static Decoder_Config<int8_t, uint8_t> get_ka9q_signed_config() {
     // ViterbiDecoder_Config<uint8_t> config; // we dont care about these parameters for ka9q
-    const uint8_t SOFT_DECISION_HIGH = 255;
-    const uint8_t SOFT_DECISION_LOW = 0;
+    const int8_t SOFT_DECISION_HIGH = +127;
+    const int8_t SOFT_DECISION_LOW = -127;
     return { SOFT_DECISION_HIGH, SOFT_DECISION_LOW, {} };
 }
 
@@ -63,3 +63,36 @@ static Decoder_Config<int8_t, uint8_t> get_hard8_decoding_config(const size_t co
 
     return { soft_decision_high, soft_decision_low, config };
 }
+
+// 4bit soft decision symbols which are packed two to a byte
+static Decoder_Config<int8_t, uint8_t> get_soft4_decoding_config(const size_t code_rate) {
+    const int8_t soft_decision_high = +7;
+    const int8_t soft_decision_low  = -7;
+    const uint8_t max_error = uint8_t(soft_decision_high-soft_decision_low) * uint8_t(code_rate);
+    const uint8_t error_margin = max_error * uint8_t(2u);
+
+    ViterbiDecoder_Config<uint8_t> config;
+    config.soft_decision_max_error = max_error;
+    config.initial_start_error = std::numeric_limits<uint8_t>::min();
+    config.initial_non_start_error = config.initial_start_error + error_margin;
+    config.renormalisation_threshold = std::numeric_limits<uint8_t>::max() - error_margin;
+
+    return { soft_decision_high, soft_decision_low, config };
+}
+
+// Symbols in the range [-magnitude, +magnitude] with thresholds regenerated to match
+// The magnitude must leave room for the error margin, i.e. 4*magnitude*code_rate < 256
+static Decoder_Config<int8_t, uint8_t> get_scaled8_decoding_config(const size_t code_rate, const int8_t magnitude) {
+    const int8_t soft_decision_high = +magnitude;
+    const int8_t soft_decision_low  = -magnitude;
+    const uint8_t max_error = uint8_t(soft_decision_high-soft_decision_low) * uint8_t(code_rate);
+    const uint8_t error_margin = max_error * uint8_t(2u);
+
+    ViterbiDecoder_Config<uint8_t> config;
+    config.soft_decision_max_error = max_error;
+    config.initial_start_error = std::numeric_limits<uint8_t>::min();
+    config.initial_non_start_error = config.initial_start_error + error_margin;
+    config.renormalisation_threshold = std::numeric_limits<uint8_t>::max() - error_margin;
+
+    return { soft_decision_high, soft_decision_low, config };
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+#include "./argmin.h"
+#include "./parity.h"
+#include "./simd_vector.h"
+
+// Viterbi decoder for bit packed hard decision symbols
+// Written against simd_vector.h so it uses the widest registers that still leave two butterfly blocks per bit,
+// since each bit depends on the previous one a single block per bit would leave the cpu waiting on latency
+// Symbols are read straight from the received bitstream with symbol i at bit (i%8) of byte (i/8)
+// Branch metrics are the hamming distance between the received and expected codewords (XOR then popcount)
+// Since a branch metric is at most R the metric spread is bounded by R*(K-1), so we can
+// use modular 8bit arithmetic like ka9q and never renormalise
+template <size_t _K, size_t _R, class simd_t = SimdVectorWidest<(size_t(1) << (_K-1u))/4u>>
+class ViterbiDecoder_HardPacked
+{
+public:
+    static constexpr size_t K = _K;
+    static constexpr size_t R = _R;
+    static constexpr size_t NUMSTATES = size_t(1) << (K-1u);
+    static constexpr size_t SIMD_WIDTH = simd_t::WIDTH;
+    static constexpr size_t TOTAL_BUTTERFLY_BLOCKS = NUMSTATES/2u/SIMD_WIDTH;
+    static constexpr size_t DECISION_BYTES = NUMSTATES/8u;
+    static_assert(K >= 6u, "Need at least 16 butterflies to fill a SIMD register");
+    static_assert(NUMSTATES/2u >= SIMD_WIDTH, "Need enough butterflies to fill the chosen SIMD register");
+    static_assert(R >= 1u && R <= 8u, "Codeword must fit in a byte");
+    static_assert(R*(K-1u) < 128u, "Metric spread must fit in a signed byte for modular arithmetic");
+    // Initial bias for non starting states, this must leave room for the metric spread
+    static constexpr uint8_t INITIAL_BIAS = uint8_t(((127u - R*(K-1u)) < 63u) ? (127u - R*(K-1u)) : 63u);
+private:
+    uint8_t* m_branch_table;        // Expected codeword for each butterfly
+    uint8_t* m_metrics;             // Holds old and new path metrics
+    uint8_t* m_old_metrics;
+    uint8_t* m_new_metrics;
+    uint8_t* m_decisions;
+    size_t m_max_decoded_bits;
+    size_t m_current_decoded_bit;
+public:
+    ViterbiDecoder_HardPacked(const int* poly, const size_t max_decoded_bits)
+    : m_max_decoded_bits(max_decoded_bits), m_current_decoded_bit(0)
+    {
+        m_branch_table = reinterpret_cast<uint8_t*>(_mm_malloc(NUMSTATES/2u, SIMD_WIDTH));
+        m_metrics = reinterpret_cast<uint8_t*>(_mm_malloc(2u*NUMSTATES, SIMD_WIDTH));
+        m_decisions = reinterpret_cast<uint8_t*>(_mm_malloc(max_decoded_bits*DECISION_BYTES, SIMD_WIDTH));
+        auto* codewords = m_branch_table;
+        for (size_t state = 0u; state < NUMSTATES/2u; state++) {
+            uint8_t codeword = 0u;
+            for (size_t i = 0u; i < R; i++) {
+                const uint8_t bit = get_parity(uint32_t((2u*state) & uint32_t(poly[i])));
+                codeword |= uint8_t(bit << i);
+            }
+            codewords[state] = codeword;
+        }
+        reset();
+    }
+    ~ViterbiDecoder_HardPacked() {
+        _mm_free(m_branch_table);
+        _mm_free(m_metrics);
+        _mm_free(m_decisions);
+    }
+    ViterbiDecoder_HardPacked(const ViterbiDecoder_HardPacked&) = delete;
+    ViterbiDecoder_HardPacked(ViterbiDecoder_HardPacked&&) = delete;
+    ViterbiDecoder_HardPacked& operator=(const ViterbiDecoder_HardPacked&) = delete;
+    ViterbiDecoder_HardPacked& operator=(ViterbiDecoder_HardPacked&&) = delete;
+
+    void reset(const size_t starting_state = 0u) {
+        m_old_metrics = &m_metrics[0];
+        m_new_metrics = &m_metrics[NUMSTATES];
+        auto* metrics = m_old_metrics;
+        for (size_t i = 0u; i < NUMSTATES; i++) {
+            metrics[i] = INITIAL_BIAS;
+        }
+        metrics[starting_state % NUMSTATES] = 0u;
+        m_current_decoded_bit = 0u;
+    }
+
+    // syms contains total_symbols hard decision bits starting at bit 0 of syms[0]
+    void update(const uint8_t* syms, const size_t total_symbols) {
+        assert(total_symbols % R == 0u);
+        const size_t total_bits = total_symbols / R;
+        assert((m_current_decoded_bit + total_bits) <= m_max_decoded_bits);
+        const size_t total_bytes = (total_symbols+7u)/8u;
+        using V = simd_t;
+        // Popcount of each nibble
+        alignas(16) static const uint8_t POPCOUNT_LUT[16] = { 0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4 };
+        const auto popcount_lut = V::broadcast_lane(POPCOUNT_LUT);
+        const auto nibble_mask = V::set1_u8(0x0F);
+        const auto max_branch_metric = V::set1_u8(uint8_t(R));
+        constexpr uint32_t CODEWORD_MASK = (uint32_t(1) << R) - 1u;
+        // Decisions are written as bytes which could alias the members so keep the pointers local
+        uint8_t* old_metrics = m_old_metrics;
+        uint8_t* new_metrics = m_new_metrics;
+        uint8_t* decision = &m_decisions[m_current_decoded_bit*DECISION_BYTES];
+
+        for (size_t bit = 0u; bit < total_bits; bit++) {
+            // Extract codeword which may straddle a byte boundary
+            const size_t symbol_offset = bit*R;
+            const size_t byte_offset = symbol_offset / 8u;
+            const uint32_t lo = syms[byte_offset];
+            const uint32_t hi = ((byte_offset+1u) < total_bytes) ? syms[byte_offset+1u] : 0u;
+            const uint32_t codeword = ((lo | (hi << 8u)) >> (symbol_offset % 8u)) & CODEWORD_MASK;
+            const auto received = V::set1_u8(uint8_t(codeword));
+
+            for (size_t i = 0u; i < TOTAL_BUTTERFLY_BLOCKS; i++) {
+                // Hamming distance between received and expected codewords
+                const auto error_bits = V::bit_xor(V::load(&m_branch_table[i*SIMD_WIDTH]), received);
+                auto metric = V::shuffle_u8(popcount_lut, V::bit_and(error_bits, nibble_mask));
+                if constexpr (R > 4u) {
+                    const auto upper_bits = V::bit_and(V::template srli_i16<4>(error_bits), nibble_mask);
+                    metric = V::add_u8(metric, V::shuffle_u8(popcount_lut, upper_bits));
+                }
+                const auto m_metric = V::sub_u8(max_branch_metric, metric);
+
+                // Add branch metrics to path metrics
+                const auto old0 = V::load(&old_metrics[i*SIMD_WIDTH]);
+                const auto old1 = V::load(&old_metrics[(TOTAL_BUTTERFLY_BLOCKS+i)*SIMD_WIDTH]);
+                const auto m0 = V::add_u8(old0, metric);
+                const auto m1 = V::add_u8(old1, m_metric);
+                const auto m2 = V::add_u8(old0, m_metric);
+                const auto m3 = V::add_u8(old1, metric);
+
+                // Compare and select using modular arithmetic
+                const auto decision0 = V::cmpgt_i8(V::sub_u8(m0, m1), V::zero());
+                const auto decision1 = V::cmpgt_i8(V::sub_u8(m2, m3), V::zero());
+                const auto survivor0 = V::select(decision0, m1, m0);
+                const auto survivor1 = V::select(decision1, m3, m2);
+
+                // Pack decisions so that each bit corresponds to a new state
+                const uint64_t decision_lo = V::movemask_u8(V::interleave_lo_u8(decision0, decision1));
+                const uint64_t decision_hi = V::movemask_u8(V::interleave_hi_u8(decision0, decision1));
+                memcpy(&decision[(2u*i)*SIMD_WIDTH/8u], &decision_lo, SIMD_WIDTH/8u);
+                memcpy(&decision[(2u*i+1u)*SIMD_WIDTH/8u], &decision_hi, SIMD_WIDTH/8u);
+
+                V::store(&new_metrics[(2u*i)*SIMD_WIDTH], V::interleave_lo_u8(survivor0, survivor1));
+                V::store(&new_metrics[(2u*i+1u)*SIMD_WIDTH], V::interleave_hi_u8(survivor0, survivor1));
+            }
+            uint8_t* tmp = old_metrics;
+            old_metrics = new_metrics;
+            new_metrics = tmp;
+            decision += DECISION_BYTES;
+        }
+        m_old_metrics = old_metrics;
+        m_new_metrics = new_metrics;
+        m_current_decoded_bit += total_bits;
+    }
+
+    // Decoded bits are written MSB first, the K-1 tail bits following the data are skipped
+    void chainback(uint8_t* data, const size_t total_bits, const size_t end_state = 0u) {
+        assert((total_bits + K-1u) <= m_current_decoded_bit);
+        auto get_decision = [this](const size_t bit, const size_t state) {
+            return (m_decisions[bit*DECISION_BYTES + state/8u] >> (state%8u)) & 0b1;
+        };
+        size_t state = end_state % NUMSTATES;
+        size_t curr_bit = m_current_decoded_bit;
+        // Walk back through the tail to the state after the last data bit
+        for (size_t i = 0u; i < (K-1u); i++) {
+            curr_bit--;
+            state = (state >> 1) | (size_t(get_decision(curr_bit, state)) << (K-2u));
+        }
+        uint8_t data_byte = 0u;
+        for (size_t i = total_bits; i-- > 0u; ) {
+            curr_bit--;
+            data_byte = uint8_t((data_byte >> 1) | ((state & 0b1) << 7));
+            if ((i % 8u) == 0u) data[i/8u] = data_byte;
+            state = (state >> 1) | (size_t(get_decision(curr_bit, state)) << (K-2u));
+        }
+    }
+
+    size_t get_best_state() const {
+        return argmin_u8_modular(m_old_metrics, NUMSTATES);
+    }
+};
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+#include "./argmin.h"
+#include "./parity.h"
+
+// Viterbi decoder which runs a u8 kernel and falls back to a u16 kernel for blocks where the u8 metrics saturate
+// - Saturation is tracked with a sticky vector flag which is only checked at the end of each block
+// - The u8 metrics are saved at the start of each block so an affected block can be redecoded with u16 metrics
+// - After a u16 block the metrics are narrowed back to u8 if their spread is small enough
+// Both kernels write decisions in the same layout so chainback doesn't care which kernel produced them
+// Symbols are signed soft decisions in [-soft_decision_max, +soft_decision_max]
+enum class HybridDecoderMode: int {
+    U8_ONLY = 0,    // never fall back, saturated metrics are used as is
+    U16_ONLY = 1,
+    HYBRID = 2,
+};
+
+template <size_t _K, size_t _R, size_t _BLOCK_BITS = 128u>
+class ViterbiDecoder_Hybrid
+{
+public:
+    static constexpr size_t K = _K;
+    static constexpr size_t R = _R;
+    static constexpr size_t BLOCK_BITS = _BLOCK_BITS;
+    static constexpr size_t NUMSTATES = size_t(1) << (K-1u);
+    static constexpr size_t DECISION_BYTES = NUMSTATES/8u;
+    static constexpr size_t TOTAL_BLOCKS_U8 = NUMSTATES/2u/16u;
+    static constexpr size_t TOTAL_BLOCKS_U16 = NUMSTATES/2u/8u;
+    static_assert(K >= 6u, "Need at least 16 butterflies to fill a SIMD register");
+private:
+    const HybridDecoderMode m_mode;
+    const int8_t m_soft_decision_max;
+    uint8_t m_max_error_u8;
+    int16_t m_max_error_u16;
+    uint8_t m_renormalisation_threshold_u8;
+    int16_t m_renormalisation_threshold_u16;
+    // Expected codeword bit of each butterfly as a conditional negation mask (0 or -1)
+    __m128i* m_branch_table_u8;     // [R][TOTAL_BLOCKS_U8]
+    __m128i* m_branch_table_u16;    // [R][TOTAL_BLOCKS_U16]
+    __m128i* m_metrics_u8;
+    __m128i* m_metrics_u16;
+    __m128i* m_old_metrics_u8;
+    __m128i* m_new_metrics_u8;
+    __m128i* m_old_metrics_u16;
+    __m128i* m_new_metrics_u16;
+    __m128i* m_saved_metrics_u8;
+    uint8_t* m_decisions;
+    const size_t m_max_decoded_bits;
+    size_t m_current_decoded_bit;
+    bool m_is_u16;
+    size_t m_total_fallback_blocks;
+public:
+    ViterbiDecoder_Hybrid(const int* poly, const size_t max_decoded_bits, const int8_t soft_decision_max, const HybridDecoderMode mode)
+    : m_mode(mode), m_soft_decision_max(soft_decision_max),
+      m_max_decoded_bits(max_decoded_bits), m_current_decoded_bit(0), m_is_u16(false), m_total_fallback_blocks(0)
+    {
+        // Renormalisation leaves room for twice the maximum error of a bit
+        assert((4u*size_t(soft_decision_max)*R) <= 255u);
+        m_max_error_u8 = uint8_t(2u*size_t(soft_decision_max)*R);
+        m_max_error_u16 = int16_t(m_max_error_u8);
+        m_renormalisation_threshold_u8 = uint8_t(255u - 2u*size_t(m_max_error_u8));
+        m_renormalisation_threshold_u16 = int16_t(INT16_MAX - 2*m_max_error_u16);
+
+        m_branch_table_u8 = reinterpret_cast<__m128i*>(_mm_malloc(R*NUMSTATES/2u, sizeof(__m128i)));
+        m_branch_table_u16 = reinterpret_cast<__m128i*>(_mm_malloc(R*NUMSTATES, sizeof(__m128i)));
+        m_metrics_u8 = reinterpret_cast<__m128i*>(_mm_malloc(2u*NUMSTATES, sizeof(__m128i)));
+        m_metrics_u16 = reinterpret_cast<__m128i*>(_mm_malloc(4u*NUMSTATES, sizeof(__m128i)));
+        m_saved_metrics_u8 = reinterpret_cast<__m128i*>(_mm_malloc(NUMSTATES, sizeof(__m128i)));
+        m_decisions = reinterpret_cast<uint8_t*>(_mm_malloc(max_decoded_bits*DECISION_BYTES, sizeof(__m128i)));
+
+        auto* table_u8 = reinterpret_cast<int8_t*>(m_branch_table_u8);
+        auto* table_u16 = reinterpret_cast<int16_t*>(m_branch_table_u16);
+        for (size_t i = 0u; i < R; i++) {
+            for (size_t state = 0u; state < NUMSTATES/2u; state++) {
+                const uint8_t bit = get_parity(uint32_t((2u*state) & uint32_t(poly[i])));
+                table_u8[i*NUMSTATES/2u + state] = bit ? -1 : 0;
+                table_u16[i*NUMSTATES/2u + state] = bit ? -1 : 0;
+            }
+        }
+        reset();
+    }
+    ~ViterbiDecoder_Hybrid() {
+        _mm_free(m_branch_table_u8);
+        _mm_free(m_branch_table_u16);
+        _mm_free(m_metrics_u8);
+        _mm_free(m_metrics_u16);
+        _mm_free(m_saved_metrics_u8);
+        _mm_free(m_decisions);
+    }
+    ViterbiDecoder_Hybrid(const ViterbiDecoder_Hybrid&) = delete;
+    ViterbiDecoder_Hybrid(ViterbiDecoder_Hybrid&&) = delete;
+    ViterbiDecoder_Hybrid& operator=(const ViterbiDecoder_Hybrid&) = delete;
+    ViterbiDecoder_Hybrid& operator=(ViterbiDecoder_Hybrid&&) = delete;
+
+    void reset(const size_t starting_state = 0u) {
+        m_old_metrics_u8 = &m_metrics_u8[0];
+        m_new_metrics_u8 = &m_metrics_u8[NUMSTATES/16u];
+        m_old_metrics_u16 = &m_metrics_u16[0];
+        m_new_metrics_u16 = &m_metrics_u16[NUMSTATES/8u];
+        m_is_u16 = (m_mode == HybridDecoderMode::U16_ONLY);
+        if (m_is_u16) {
+            auto* metrics = reinterpret_cast<int16_t*>(m_old_metrics_u16);
+            for (size_t i = 0u; i < NUMSTATES; i++) metrics[i] = int16_t(2*m_max_error_u16);
+            metrics[starting_state % NUMSTATES] = 0;
+        } else {
+            auto* metrics = reinterpret_cast<uint8_t*>(m_old_metrics_u8);
+            for (size_t i = 0u; i < NUMSTATES; i++) metrics[i] = uint8_t(2u*m_max_error_u8);
+            metrics[starting_state % NUMSTATES] = 0u;
+        }
+        m_current_decoded_bit = 0u;
+        m_total_fallback_blocks = 0u;
+    }
+
+    void update(const int8_t* syms, const size_t total_symbols) {
+        assert(total_symbols % R == 0u);
+        const size_t total_bits = total_symbols / R;
+        assert((m_current_decoded_bit + total_bits) <= m_max_decoded_bits);
+        for (size_t bit = 0u; bit < total_bits; bit += BLOCK_BITS) {
+            const size_t remain = total_bits-bit;
+            const size_t block_bits = (remain > BLOCK_BITS) ? BLOCK_BITS : remain;
+            update_block(&syms[bit*R], block_bits);
+            m_current_decoded_bit += block_bits;
+        }
+    }
+
+    // Decoded bits are written MSB first, the K-1 tail bits following the data are skipped
+    void chainback(uint8_t* data, const size_t total_bits, const size_t end_state = 0u) {
+        assert((total_bits + K-1u) <= m_current_decoded_bit);
+        auto get_decision = [this](const size_t bit, const size_t state) {
+            return (m_decisions[bit*DECISION_BYTES + state/8u] >> (state%8u)) & 0b1;
+        };
+        size_t state = end_state % NUMSTATES;
+        size_t curr_bit = m_current_decoded_bit;
+        for (size_t i = 0u; i < (K-1u); i++) {
+            curr_bit--;
+            state = (state >> 1) | (size_t(get_decision(curr_bit, state)) << (K-2u));
+        }
+        uint8_t data_byte = 0u;
+        for (size_t i = total_bits; i-- > 0u; ) {
+            curr_bit--;
+            data_byte = uint8_t((data_byte >> 1) | ((state & 0b1) << 7));
+            if ((i % 8u) == 0u) data[i/8u] = data_byte;
+            state = (state >> 1) | (size_t(get_decision(curr_bit, state)) << (K-2u));
+        }
+    }
+
+    // For unterminated streams start chainback from the state with the best path metric
+    // Metrics are saturating unsigned while on the u8 kernel and non-negative saturating signed on the u16 kernel
+    size_t get_best_state() const {
+        if (m_is_u16) return argmin_i16(reinterpret_cast<const int16_t*>(m_old_metrics_u16), NUMSTATES);
+        return argmin_u8(reinterpret_cast<const uint8_t*>(m_old_metrics_u8), NUMSTATES);
+    }
+
+    size_t get_total_fallback_blocks() const { return m_total_fallback_blocks; }
+private:
+    void update_block(const int8_t* syms, const size_t total_bits) {
+        uint8_t* decisions = &m_decisions[m_current_decoded_bit*DECISION_BYTES];
+        if (!m_is_u16) {
+            if (m_mode == HybridDecoderMode::U8_ONLY) {
+                update_u8(syms, decisions, total_bits);
+                return;
+            }
+            memcpy(m_saved_metrics_u8, m_old_metrics_u8, NUMSTATES);
+            const bool is_saturated = update_u8(syms, decisions, total_bits);
+            if (!is_saturated) return;
+            // Redecode the block from the saved metrics with wider metrics
+            widen_metrics(reinterpret_cast<const uint8_t*>(m_saved_metrics_u8));
+            m_is_u16 = true;
+            m_total_fallback_blocks++;
+        }
+        update_u16(syms, decisions, total_bits);
+        if (m_mode == HybridDecoderMode::HYBRID) {
+            m_is_u16 = !try_narrow_metrics();
+        }
+    }
+
+    // Returns true if any path metric saturated
+    bool update_u8(const int8_t* syms, uint8_t* decisions, const size_t total_bits) {
+        // Wrapping arithmetic is fine since the final error is in [0,max_error]
+        const __m128i bias = _mm_set1_epi8(char(uint8_t(size_t(m_soft_decision_max)*R)));
+        const __m128i max_error = _mm_set1_epi8(char(m_max_error_u8));
+        const __m128i saturated = _mm_set1_epi8(char(0xFF));
+        __m128i sticky = _mm_setzero_si128();
+        for (size_t bit = 0u; bit < total_bits; bit++) {
+            __m128i sym[R];
+            for (size_t j = 0u; j < R; j++) sym[j] = _mm_set1_epi8(syms[bit*R+j]);
+            auto* decision = reinterpret_cast<uint16_t*>(&decisions[bit*DECISION_BYTES]);
+            for (size_t i = 0u; i < TOTAL_BLOCKS_U8; i++) {
+                // Conditionally negate symbols to get the error from the expected codeword
+                __m128i metric = bias;
+                for (size_t j = 0u; j < R; j++) {
+                    const __m128i mask = m_branch_table_u8[j*TOTAL_BLOCKS_U8+i];
+                    metric = _mm_add_epi8(metric, _mm_sub_epi8(_mm_xor_si128(sym[j], mask), mask));
+                }
+                const __m128i m_metric = _mm_sub_epi8(max_error, metric);
+
+                const __m128i m0 = _mm_adds_epu8(m_old_metrics_u8[i], metric);
+                const __m128i m1 = _mm_adds_epu8(m_old_metrics_u8[TOTAL_BLOCKS_U8+i], m_metric);
+                const __m128i m2 = _mm_adds_epu8(m_old_metrics_u8[i], m_metric);
+                const __m128i m3 = _mm_adds_epu8(m_old_metrics_u8[TOTAL_BLOCKS_U8+i], metric);
+                const __m128i survivor0 = _mm_min_epu8(m0, m1);
+                const __m128i survivor1 = _mm_min_epu8(m2, m3);
+                const __m128i decision0 = _mm_cmpeq_epi8(survivor0, m1);
+                const __m128i decision1 = _mm_cmpeq_epi8(survivor1, m3);
+                sticky = _mm_or_si128(sticky, _mm_cmpeq_epi8(survivor0, saturated));
+                sticky = _mm_or_si128(sticky, _mm_cmpeq_epi8(survivor1, saturated));
+
+                decision[2u*i]    = uint16_t(_mm_movemask_epi8(_mm_unpacklo_epi8(decision0, decision1)));
+                decision[2u*i+1u] = uint16_t(_mm_movemask_epi8(_mm_unpackhi_epi8(decision0, decision1)));
+                m_new_metrics_u8[2u*i]    = _mm_unpacklo_epi8(survivor0, survivor1);
+                m_new_metrics_u8[2u*i+1u] = _mm_unpackhi_epi8(survivor0, survivor1);
+            }
+            __m128i* tmp = m_old_metrics_u8;
+            m_old_metrics_u8 = m_new_metrics_u8;
+            m_new_metrics_u8 = tmp;
+
+            const auto* metrics = reinterpret_cast<const uint8_t*>(m_old_metrics_u8);
+            if (metrics[0] >= m_renormalisation_threshold_u8) {
+                __m128i min = m_old_metrics_u8[0];
+                for (size_t i = 1u; i < NUMSTATES/16u; i++) min = _mm_min_epu8(min, m_old_metrics_u8[i]);
+                min = _mm_min_epu8(min, _mm_srli_si128(min, 8));
+                min = _mm_min_epu8(min, _mm_srli_si128(min, 4));
+                min = _mm_min_epu8(min, _mm_srli_si128(min, 2));
+                min = _mm_min_epu8(min, _mm_srli_si128(min, 1));
+                min = _mm_set1_epi8(char(_mm_cvtsi128_si32(min) & 0xFF));
+                for (size_t i = 0u; i < NUMSTATES/16u; i++) m_old_metrics_u8[i] = _mm_subs_epu8(m_old_metrics_u8[i], min);
+            }
+        }
+        return _mm_movemask_epi8(sticky) != 0;
+    }
+
+    // SSE2 only has signed 16bit min so metrics are kept in [0,INT16_MAX] like ka9q
+    void update_u16(const int8_t* syms, uint8_t* decisions, const size_t total_bits) {
+        const __m128i bias = _mm_set1_epi16(int16_t(size_t(m_soft_decision_max)*R));
+        const __m128i max_error = _mm_set1_epi16(m_max_error_u16);
+        for (size_t bit = 0u; bit < total_bits; bit++) {
+            __m128i sym[R];
+            for (size_t j = 0u; j < R; j++) sym[j] = _mm_set1_epi16(int16_t(syms[bit*R+j]));
+            auto* decision = reinterpret_cast<uint16_t*>(&decisions[bit*DECISION_BYTES]);
+            for (size_t i = 0u; i < TOTAL_BLOCKS_U16; i++) {
+                __m128i metric = bias;
+                for (size_t j = 0u; j < R; j++) {
+                    const __m128i mask = m_branch_table_u16[j*TOTAL_BLOCKS_U16+i];
+                    metric = _mm_add_epi16(metric, _mm_sub_epi16(_mm_xor_si128(sym[j], mask), mask));
+                }
+                const __m128i m_metric = _mm_sub_epi16(max_error, metric);
+
+                const __m128i m0 = _mm_adds_epi16(m_old_metrics_u16[i], metric);
+                const __m128i m1 = _mm_adds_epi16(m_old_metrics_u16[TOTAL_BLOCKS_U16+i], m_metric);
+                const __m128i m2 = _mm_adds_epi16(m_old_metrics_u16[i], m_metric);
+                const __m128i m3 = _mm_adds_epi16(m_old_metrics_u16[TOTAL_BLOCKS_U16+i], metric);
+                const __m128i survivor0 = _mm_min_epi16(m0, m1);
+                const __m128i survivor1 = _mm_min_epi16(m2, m3);
+                const __m128i decision0 = _mm_cmpeq_epi16(survivor0, m1);
+                const __m128i decision1 = _mm_cmpeq_epi16(survivor1, m3);
+
+                // Narrow interleaved decisions to bytes so each new state gets a single bit
+                const __m128i packed = _mm_packs_epi16(_mm_unpacklo_epi16(decision0, decision1), _mm_unpackhi_epi16(decision0, decision1));
+                decision[i] = uint16_t(_mm_movemask_epi8(packed));
+                m_new_metrics_u16[2u*i]    = _mm_unpacklo_epi16(survivor0, survivor1);
+                m_new_metrics_u16[2u*i+1u] = _mm_unpackhi_epi16(survivor0, survivor1);
+            }
+            __m128i* tmp = m_old_metrics_u16;
+            m_old_metrics_u16 = m_new_metrics_u16;
+            m_new_metrics_u16 = tmp;
+
+            const auto* metrics = reinterpret_cast<const int16_t*>(m_old_metrics_u16);
+            if (metrics[0] >= m_renormalisation_threshold_u16) {
+                const __m128i min = _mm_set1_epi16(get_min_u16());
+                for (size_t i = 0u; i < NUMSTATES/8u; i++) m_old_metrics_u16[i] = _mm_subs_epi16(m_old_metrics_u16[i], min);
+            }
+        }
+    }
+
+    int16_t get_min_u16() const {
+        __m128i min = m_old_metrics_u16[0];
+        for (size_t i = 1u; i < NUMSTATES/8u; i++) min = _mm_min_epi16(min, m_old_metrics_u16[i]);
+        min = _mm_min_epi16(min, _mm_srli_si128(min, 8));
+        min = _mm_min_epi16(min, _mm_srli_si128(min, 4));
+        min = _mm_min_epi16(min, _mm_srli_si128(min, 2));
+        return int16_t(_mm_extract_epi16(min, 0));
+    }
+
+    void widen_metrics(const uint8_t* metrics_u8) {
+        const __m128i zero = _mm_setzero_si128();
+        const auto* src = reinterpret_cast<const __m128i*>(metrics_u8);
+        for (size_t i = 0u; i < NUMSTATES/16u; i++) {
+            m_old_metrics_u16[2u*i]    = _mm_unpacklo_epi8(src[i], zero);
+            m_old_metrics_u16[2u*i+1u] = _mm_unpackhi_epi8(src[i], zero);
+        }
+    }
+
+    // Go back to u8 metrics if they fit below the renormalisation threshold once the minimum is removed
+    bool try_narrow_metrics() {
+        const int16_t min = get_min_u16();
+        const __m128i min_v = _mm_set1_epi16(min);
+        __m128i max = _mm_setzero_si128();
+        for (size_t i = 0u; i < NUMSTATES/8u; i++) max = _mm_max_epi16(max, _mm_sub_epi16(m_old_metrics_u16[i], min_v));
+        max = _mm_max_epi16(max, _mm_srli_si128(max, 8));
+        max = _mm_max_epi16(max, _mm_srli_si128(max, 4));
+        max = _mm_max_epi16(max, _mm_srli_si128(max, 2));
+        if (_mm_extract_epi16(max, 0) >= int(m_renormalisation_threshold_u8)) return false;
+        for (size_t i = 0u; i < NUMSTATES/16u; i++) {
+            const __m128i lo = _mm_sub_epi16(m_old_metrics_u16[2u*i], min_v);
+            const __m128i hi = _mm_sub_epi16(m_old_metrics_u16[2u*i+1u], min_v);
+            m_old_metrics_u8[i] = _mm_packus_epi16(lo, hi);
+        }
+        return true;
+    }
+};
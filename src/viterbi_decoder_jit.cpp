@@ -0,0 +1,492 @@
+#include "./viterbi_decoder_jit.h"
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+#include <immintrin.h>
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include "./argmin.h"
+#include "./parity.h"
+#include "./x86_emitter.h"
+
+// Fully unrolled so the code grows with the number of states, past this the kernel stops fitting in the instruction cache
+constexpr size_t MAX_UNROLLED_BLOCKS = 64;
+// Symbols are kept in xmm0 to xmm(R-1) and xmm7 holds zero
+constexpr size_t MAX_CODE_RATE = 7;
+
+// Quantisation of the branch metrics for a code
+struct JitMetricFormat {
+    size_t lanes;               // butterflies per register
+    size_t metric_size;         // bytes per path metric
+    bool is_average;            // U8 with R a power of two averages symbols like ka9q, otherwise symbols are summed
+    uint8_t shift;              // U8 only, right shift that keeps the metric spread under 128
+    uint32_t max_branch_metric;
+    uint32_t initial_bias;
+};
+
+static bool is_power_of_two(const size_t x) {
+    return (x != 0u) && ((x & (x-1u)) == 0u);
+}
+
+static JitMetricFormat get_metric_format(const size_t K, const size_t R, const DecoderPrecision precision) {
+    JitMetricFormat format;
+    if (precision == DecoderPrecision::U8) {
+        format.lanes = 16u;
+        format.metric_size = 1u;
+        format.is_average = is_power_of_two(R);
+        const uint32_t total_symbols = format.is_average ? 1u : uint32_t(R);
+        format.shift = 0u;
+        while ((format.shift < 7u) && (total_symbols*(255u >> format.shift)*(K-1u) >= 128u)) format.shift++;
+        format.max_branch_metric = total_symbols*(255u >> format.shift);
+        const uint32_t spread = format.max_branch_metric*uint32_t(K-1u);
+        format.initial_bias = (spread < 127u) ? std::min(63u, 127u-spread) : 0u;
+    } else {
+        format.lanes = 8u;
+        format.metric_size = 2u;
+        format.is_average = false;
+        format.shift = 0u;
+        format.max_branch_metric = 255u*uint32_t(R);
+        const uint32_t spread = format.max_branch_metric*uint32_t(K-1u);
+        format.initial_bias = (spread < 32767u) ? std::min(16383u, 32767u-spread) : 0u;
+    }
+    return format;
+}
+
+bool is_jit_supported() {
+    return X86_EMITTER_SUPPORTED != 0;
+}
+
+bool is_jit_code_supported(const size_t K, const size_t R, const DecoderPrecision precision) {
+    if (!is_jit_supported()) return false;
+    if ((R < 1u) || (R > MAX_CODE_RATE) || (K < 2u) || (K > 32u)) return false;
+    const auto format = get_metric_format(K, R, precision);
+    const size_t total_butterflies = size_t(1) << (K-2u);
+    if (total_butterflies < format.lanes) return false;
+    if ((total_butterflies / format.lanes) > MAX_UNROLLED_BLOCKS) return false;
+    // Branch metrics must be quantised to at least a bit and the spread must fit the modular arithmetic
+    const uint32_t spread = format.max_branch_metric*uint32_t(K-1u);
+    if (precision == DecoderPrecision::U8) return (format.max_branch_metric > 0u) && (spread < 128u);
+    return spread < 32768u;
+}
+
+class JitKernel
+{
+public:
+    using kernel_t = void (*)(JitKernelArgs*);
+    std::unique_ptr<ExecutableMemory> memory;
+    kernel_t kernel = nullptr;
+};
+
+void run_jit_kernel(const JitKernel& kernel, JitKernelArgs& args) {
+    kernel.kernel(&args);
+}
+
+size_t get_jit_kernel_size(const JitKernel& kernel) {
+    return kernel.memory->size();
+}
+
+#if X86_EMITTER_SUPPORTED
+
+// Register assignment of the generated update loop
+// Only registers that are caller saved in both the System V and Windows x64 conventions are used
+constexpr Gpr REG_SYMBOLS = Gpr::R8;
+constexpr Gpr REG_TOTAL_BITS = Gpr::R9;
+constexpr Gpr REG_OLD_METRICS = Gpr::R10;
+constexpr Gpr REG_NEW_METRICS = Gpr::RDX;
+constexpr Gpr REG_DECISIONS = Gpr::RAX;
+constexpr Gpr REG_SCRATCH = Gpr::RCX;
+#if defined(_WIN32)
+constexpr Gpr REG_ARGS = Gpr::RCX;
+#else
+constexpr Gpr REG_ARGS = Gpr::RDI;
+#endif
+constexpr Xmm XMM_ZERO = 7u;
+// Branch metrics of the four branches of each butterfly, these become the candidate path metrics
+constexpr Xmm XMM_BRANCH[4] = { 8u, 9u, 10u, 11u };
+constexpr Xmm XMM_TEMP[4] = { 12u, 13u, 14u, 15u };
+// The averaging tree takes one temporary per level so averaged rates are at most 2^4
+static_assert(MAX_CODE_RATE < (size_t(1) << std::size(XMM_TEMP)), "Not enough temporaries for the averaging tree");
+
+class JitKernelGenerator
+{
+private:
+    const size_t K;
+    const size_t R;
+    const std::vector<uint32_t> m_poly;
+    const JitMetricFormat m_format;
+    const size_t m_total_blocks;
+    X86Emitter m_emitter;
+public:
+    JitKernelGenerator(const size_t K_, const size_t R_, const int* poly, const DecoderPrecision precision)
+    : K(K_), R(R_), m_poly(get_poly(poly, K_, R_)), m_format(get_metric_format(K_, R_, precision)),
+      m_total_blocks((size_t(1) << (K_-2u)) / m_format.lanes)
+    {}
+
+    std::vector<uint8_t> generate() {
+        auto& e = m_emitter;
+#if defined(_WIN32)
+        // xmm6 to xmm15 are callee saved on windows
+        // There is no unwind info registered for the kernel but nothing it calls can throw
+        constexpr int32_t STACK_SIZE = 10*16 + 8;
+        e.sub(Gpr::RSP, STACK_SIZE);
+        for (Xmm i = 0; i < 10; i++) e.movdqa(x86_mem(Gpr::RSP, 16*int32_t(i)), Xmm(6u+i));
+#endif
+        e.mov(REG_SYMBOLS, x86_mem(REG_ARGS, int32_t(offsetof(JitKernelArgs, symbols))));
+        e.mov(REG_TOTAL_BITS, x86_mem(REG_ARGS, int32_t(offsetof(JitKernelArgs, total_bits))));
+        e.mov(REG_OLD_METRICS, x86_mem(REG_ARGS, int32_t(offsetof(JitKernelArgs, old_metrics))));
+        e.mov(REG_NEW_METRICS, x86_mem(REG_ARGS, int32_t(offsetof(JitKernelArgs, new_metrics))));
+        e.mov(REG_DECISIONS, x86_mem(REG_ARGS, int32_t(offsetof(JitKernelArgs, decisions))));
+        e.sse(SseOp::PXOR, XMM_ZERO, XMM_ZERO);
+        e.test(REG_TOTAL_BITS, REG_TOTAL_BITS);
+        const size_t jump_end = e.jz_forward();
+
+        const size_t loop_start = e.get_position();
+        emit_symbol_splats();
+        for (size_t block = 0; block < m_total_blocks; block++) {
+            emit_butterfly_block(block);
+        }
+        e.add(REG_DECISIONS, int32_t(size_t(1) << (K-4u)));
+        e.xchg(REG_OLD_METRICS, REG_NEW_METRICS);
+        e.dec(REG_TOTAL_BITS);
+        e.jnz(loop_start);
+
+        e.bind(jump_end);
+#if defined(_WIN32)
+        for (Xmm i = 0; i < 10; i++) e.movdqa(Xmm(6u+i), x86_mem(Gpr::RSP, 16*int32_t(i)));
+        e.add(Gpr::RSP, STACK_SIZE);
+#endif
+        e.ret();
+        return e.finalize();
+    }
+private:
+    static std::vector<uint32_t> get_poly(const int* poly, const size_t K, const size_t R) {
+        const uint32_t mask = uint32_t((uint64_t(1) << K) - 1u);
+        std::vector<uint32_t> values(R);
+        for (size_t i = 0; i < R; i++) values[i] = uint32_t(poly[i]) & mask;
+        return values;
+    }
+
+    bool is_u8() const { return m_format.metric_size == 1u; }
+    SseOp get_add() const { return is_u8() ? SseOp::PADDB : SseOp::PADDW; }
+    SseOp get_sub() const { return is_u8() ? SseOp::PSUBB : SseOp::PSUBW; }
+    SseOp get_cmpgt() const { return is_u8() ? SseOp::PCMPGTB : SseOp::PCMPGTW; }
+
+    // Every lane set to the same value
+    X86Mem get_broadcast(const uint32_t value) {
+        X86Emitter::Constant constant;
+        for (size_t i = 0; i < 16u; i += m_format.metric_size) {
+            constant[i] = uint8_t(value);
+            if (m_format.metric_size == 2u) constant[i+1u] = uint8_t(value >> 8);
+        }
+        return m_emitter.constant(constant);
+    }
+
+    // Symbol x as an unsigned byte XORed with this gives the distance to the expected bit
+    // 0x80 turns it into offset binary which is the distance to a 0, 0x7F also negates it for the distance to a 1
+    X86Mem get_symbol_pattern(const size_t block, const size_t symbol, const uint32_t branch) {
+        X86Emitter::Constant constant;
+        constant.fill(0u);
+        for (size_t lane = 0; lane < m_format.lanes; lane++) {
+            const uint32_t butterfly = uint32_t(block*m_format.lanes + lane);
+            const uint32_t reg = (butterfly << 1) | (branch & 0b01) | ((branch >> 1) << (K-1u));
+            const uint8_t bit = get_parity(reg & m_poly[symbol]);
+            constant[lane*m_format.metric_size] = bit ? 0x7F : 0x80;
+        }
+        return m_emitter.constant(constant);
+    }
+
+    void emit_symbol_splats() {
+        auto& e = m_emitter;
+        const int32_t splat = is_u8() ? 0x01010101 : 0x00010001;
+        for (size_t i = 0; i < R; i++) {
+            e.movzx8(REG_SCRATCH, x86_mem(REG_SYMBOLS, int32_t(i)));
+            e.imul(REG_SCRATCH, REG_SCRATCH, splat);
+            e.movd(Xmm(i), REG_SCRATCH);
+            e.pshufd(Xmm(i), Xmm(i), 0u);
+        }
+        e.add(REG_SYMBOLS, int32_t(R));
+    }
+
+    void emit_symbol_distance(const Xmm dst, const size_t block, const size_t symbol, const uint32_t branch) {
+        m_emitter.movdqa(dst, Xmm(symbol));
+        m_emitter.sse(SseOp::PXOR, dst, get_symbol_pattern(block, symbol, branch));
+    }
+
+    // There's no packed bytes right shift so shift words and mask
+    void emit_quantise(const Xmm dst) {
+        if (m_format.shift == 0u) return;
+        m_emitter.psrlw(dst, m_format.shift);
+        m_emitter.sse(SseOp::PAND, dst, get_broadcast(0xFFu >> m_format.shift));
+    }
+
+    // Averaging tree over symbols [first, first+count) into dst with one temporary per level
+    void emit_average(const Xmm dst, const size_t block, const uint32_t branch, const size_t first, const size_t count, const size_t depth) {
+        if (count == 1u) {
+            emit_symbol_distance(dst, block, first, branch);
+            return;
+        }
+        const size_t half = count/2u;
+        // is_average is only set for R <= MAX_CODE_RATE so this never clamps, but the compiler can't see the bound
+        assert(depth < std::size(XMM_TEMP));
+        const Xmm temp = XMM_TEMP[std::min(depth, std::size(XMM_TEMP)-1u)];
+        emit_average(dst, block, branch, first, half, depth+1u);
+        emit_average(temp, block, branch, first+half, half, depth+1u);
+        m_emitter.sse(SseOp::PAVGB, dst, temp);
+    }
+
+    void emit_branch_metric(const Xmm dst, const size_t block, const uint32_t branch) {
+        if (m_format.is_average) {
+            emit_average(dst, block, branch, 0u, R, 0u);
+            emit_quantise(dst);
+            return;
+        }
+        emit_symbol_distance(dst, block, 0u, branch);
+        emit_quantise(dst);
+        for (size_t i = 1; i < R; i++) {
+            emit_symbol_distance(XMM_TEMP[0], block, i, branch);
+            emit_quantise(XMM_TEMP[0]);
+            m_emitter.sse(get_add(), dst, XMM_TEMP[0]);
+        }
+    }
+
+    // Which symbols of a branch have their expected bit flipped relative to the 0th branch
+    // Branches are numbered by the bits that enter the register, bit 0 is the decoded bit and bit 1 the bit leaving
+    uint32_t get_flipped_symbols(const uint32_t branch) const {
+        uint32_t flipped = 0u;
+        for (size_t i = 0; i < R; i++) {
+            uint32_t reg = 0u;
+            if (branch & 0b01) reg |= 1u;
+            if (branch & 0b10) reg |= uint32_t(1u) << (K-1u);
+            flipped |= uint32_t(get_parity(reg & m_poly[i])) << i;
+        }
+        return flipped;
+    }
+
+    void emit_butterfly_block(const size_t block) {
+        auto& e = m_emitter;
+        // XMM_BRANCH holds the branches from old state j to 2j, j+N/2 to 2j, j to 2j+1, j+N/2 to 2j+1
+        constexpr uint32_t BRANCHES[4] = { 0b00, 0b10, 0b01, 0b11 };
+        const uint32_t all_flipped = (uint32_t(1) << R) - 1u;
+        for (size_t i = 0; i < 4; i++) {
+            const uint32_t flipped = get_flipped_symbols(BRANCHES[i]);
+            // A copy is cheaper than a complement so look for an equal metric first
+            int equal = -1;
+            int complement = -1;
+            for (size_t j = 0; j < i; j++) {
+                const uint32_t diff = flipped ^ get_flipped_symbols(BRANCHES[j]);
+                if ((diff == 0u) && (equal < 0)) equal = int(j);
+                if ((diff == all_flipped) && (complement < 0)) complement = int(j);
+            }
+            if (equal >= 0) {
+                e.movdqa(XMM_BRANCH[i], XMM_BRANCH[equal]);
+            } else if (complement >= 0) {
+                e.movdqa(XMM_BRANCH[i], get_broadcast(m_format.max_branch_metric));
+                e.sse(get_sub(), XMM_BRANCH[i], XMM_BRANCH[complement]);
+            } else {
+                emit_branch_metric(XMM_BRANCH[i], block, BRANCHES[i]);
+            }
+        }
+
+        // Add branch metrics to path metrics
+        const Xmm old0 = XMM_TEMP[0];
+        const Xmm old1 = XMM_TEMP[1];
+        e.movdqa(old0, x86_mem(REG_OLD_METRICS, int32_t(16u*block)));
+        e.movdqa(old1, x86_mem(REG_OLD_METRICS, int32_t(16u*(m_total_blocks+block))));
+        e.sse(get_add(), XMM_BRANCH[0], old0);
+        e.sse(get_add(), XMM_BRANCH[1], old1);
+        e.sse(get_add(), XMM_BRANCH[2], old0);
+        e.sse(get_add(), XMM_BRANCH[3], old1);
+
+        // Compare and select using modular arithmetic
+        // survivor = m0 - ((m0-m1) & decision) picks m1 when m0 > m1
+        const Xmm diff = XMM_TEMP[2];
+        const Xmm decision0 = XMM_TEMP[3];
+        const Xmm decision1 = XMM_BRANCH[1];
+        const Xmm survivor0 = XMM_BRANCH[0];
+        const Xmm survivor1 = XMM_BRANCH[2];
+        e.movdqa(diff, XMM_BRANCH[0]);
+        e.sse(get_sub(), diff, XMM_BRANCH[1]);
+        e.movdqa(decision0, diff);
+        e.sse(get_cmpgt(), decision0, XMM_ZERO);
+        e.sse(SseOp::PAND, diff, decision0);
+        e.sse(get_sub(), survivor0, diff);
+        e.movdqa(diff, XMM_BRANCH[2]);
+        e.sse(get_sub(), diff, XMM_BRANCH[3]);
+        e.movdqa(decision1, diff);
+        e.sse(get_cmpgt(), decision1, XMM_ZERO);
+        e.sse(SseOp::PAND, diff, decision1);
+        e.sse(get_sub(), survivor1, diff);
+
+        // Pack decisions so that each bit corresponds to a new state
+        const Xmm temp = XMM_TEMP[2];
+        if (is_u8()) {
+            e.movdqa(temp, decision0);
+            e.sse(SseOp::PUNPCKLBW, temp, decision1);
+            e.pmovmskb(REG_SCRATCH, temp);
+            e.mov16(x86_mem(REG_DECISIONS, int32_t(4u*block)), REG_SCRATCH);
+            e.sse(SseOp::PUNPCKHBW, decision0, decision1);
+            e.pmovmskb(REG_SCRATCH, decision0);
+            e.mov16(x86_mem(REG_DECISIONS, int32_t(4u*block+2u)), REG_SCRATCH);
+        } else {
+            e.movdqa(temp, decision0);
+            e.sse(SseOp::PUNPCKLWD, temp, decision1);
+            e.sse(SseOp::PUNPCKHWD, decision0, decision1);
+            e.sse(SseOp::PACKSSWB, temp, decision0);
+            e.pmovmskb(REG_SCRATCH, temp);
+            e.mov16(x86_mem(REG_DECISIONS, int32_t(2u*block)), REG_SCRATCH);
+        }
+
+        // Store surviving metrics interleaved so new states 2j and 2j+1 are adjacent
+        const SseOp unpack_lo = is_u8() ? SseOp::PUNPCKLBW : SseOp::PUNPCKLWD;
+        const SseOp unpack_hi = is_u8() ? SseOp::PUNPCKHBW : SseOp::PUNPCKHWD;
+        e.movdqa(temp, survivor0);
+        e.sse(unpack_lo, temp, survivor1);
+        e.movdqa(x86_mem(REG_NEW_METRICS, int32_t(32u*block)), temp);
+        e.sse(unpack_hi, survivor0, survivor1);
+        e.movdqa(x86_mem(REG_NEW_METRICS, int32_t(32u*block+16u)), survivor0);
+    }
+};
+
+static std::shared_ptr<const JitKernel> create_jit_kernel(const size_t K, const size_t R, const int* poly, const DecoderPrecision precision) {
+    auto code = JitKernelGenerator(K, R, poly, precision).generate();
+    auto kernel = std::make_shared<JitKernel>();
+    kernel->memory = std::make_unique<ExecutableMemory>(code);
+    kernel->kernel = reinterpret_cast<JitKernel::kernel_t>(const_cast<void*>(kernel->memory->get()));
+    return kernel;
+}
+
+#else
+
+static std::shared_ptr<const JitKernel> create_jit_kernel(const size_t, const size_t, const int*, const DecoderPrecision) {
+    throw std::runtime_error("Generated kernels are only supported on x86-64");
+}
+
+#endif
+
+// Services decode many customer specific codes so kernels are kept for the lifetime of the process
+class JitKernelCache
+{
+private:
+    using key_t = std::tuple<size_t, size_t, DecoderPrecision, std::vector<uint32_t>>;
+    std::mutex m_mutex;
+    std::map<key_t, std::shared_ptr<const JitKernel>> m_kernels;
+    JitKernelCache() {}
+public:
+    static JitKernelCache& get() {
+        static JitKernelCache cache;
+        return cache;
+    }
+    JitKernelCache(const JitKernelCache&) = delete;
+    JitKernelCache(JitKernelCache&&) = delete;
+    JitKernelCache& operator=(const JitKernelCache&) = delete;
+    JitKernelCache& operator=(JitKernelCache&&) = delete;
+
+    std::shared_ptr<const JitKernel> get_kernel(const size_t K, const size_t R, const int* poly, const DecoderPrecision precision) {
+        const uint32_t mask = uint32_t((uint64_t(1) << K) - 1u);
+        std::vector<uint32_t> masked_poly(R);
+        for (size_t i = 0; i < R; i++) masked_poly[i] = uint32_t(poly[i]) & mask;
+        auto key = key_t(K, R, precision, std::move(masked_poly));
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_kernels.find(key);
+        if (it != m_kernels.end()) return it->second;
+        auto kernel = create_jit_kernel(K, R, poly, precision);
+        m_kernels.emplace(std::move(key), kernel);
+        return kernel;
+    }
+};
+
+std::shared_ptr<const JitKernel> get_jit_kernel(const size_t K, const size_t R, const int* poly, const DecoderPrecision precision) {
+    if (!is_jit_code_supported(K, R, precision)) throw std::invalid_argument("Code is not supported by the generated kernels");
+    return JitKernelCache::get().get_kernel(K, R, poly, precision);
+}
+
+ViterbiDecoder_JIT::ViterbiDecoder_JIT(const size_t K, const size_t R, const int* poly, const DecoderPrecision precision, const size_t max_decoded_bits)
+: m_K(K), m_R(R), m_precision(precision),
+  m_total_states(size_t(1) << (K-1u)),
+  m_metric_size(get_metric_format(K, R, precision).metric_size),
+  m_decision_bytes(m_total_states/8u),
+  m_kernel(get_jit_kernel(K, R, poly, precision)),
+  m_max_decoded_bits(max_decoded_bits), m_current_decoded_bit(0u)
+{
+    m_metrics = reinterpret_cast<uint8_t*>(_mm_malloc(2u*m_total_states*m_metric_size, 16u));
+    m_decisions = reinterpret_cast<uint8_t*>(_mm_malloc(max_decoded_bits*m_decision_bytes, 16u));
+    reset();
+}
+
+ViterbiDecoder_JIT::~ViterbiDecoder_JIT() {
+    _mm_free(m_metrics);
+    _mm_free(m_decisions);
+}
+
+void ViterbiDecoder_JIT::reset(const size_t starting_state) {
+    const auto format = get_metric_format(m_K, m_R, m_precision);
+    m_old_metrics = &m_metrics[0];
+    m_new_metrics = &m_metrics[m_total_states*m_metric_size];
+    if (m_metric_size == 1u) {
+        memset(m_old_metrics, int(format.initial_bias), m_total_states);
+        m_old_metrics[starting_state % m_total_states] = 0u;
+    } else {
+        auto* metrics = reinterpret_cast<uint16_t*>(m_old_metrics);
+        for (size_t i = 0; i < m_total_states; i++) metrics[i] = uint16_t(format.initial_bias);
+        metrics[starting_state % m_total_states] = 0u;
+    }
+    m_current_decoded_bit = 0u;
+}
+
+void ViterbiDecoder_JIT::update(const int8_t* symbols, const size_t total_symbols) {
+    assert(total_symbols % m_R == 0u);
+    const size_t total_bits = total_symbols / m_R;
+    assert((m_current_decoded_bit + total_bits) <= m_max_decoded_bits);
+    JitKernelArgs args;
+    args.symbols = symbols;
+    args.total_bits = total_bits;
+    args.old_metrics = m_old_metrics;
+    args.new_metrics = m_new_metrics;
+    args.decisions = &m_decisions[m_current_decoded_bit*m_decision_bytes];
+    run_jit_kernel(*m_kernel, args);
+    // The kernel swaps its metric pointers every bit
+    if (total_bits % 2u != 0u) std::swap(m_old_metrics, m_new_metrics);
+    m_current_decoded_bit += total_bits;
+}
+
+void ViterbiDecoder_JIT::chainback(uint8_t* data, const size_t total_bits, const size_t end_state) {
+    assert((total_bits + m_K-1u) <= m_current_decoded_bit);
+    auto get_decision = [this](const size_t bit, const size_t state) {
+        return (m_decisions[bit*m_decision_bytes + state/8u] >> (state%8u)) & 0b1;
+    };
+    size_t state = end_state % m_total_states;
+    size_t curr_bit = m_current_decoded_bit;
+    // Walk back through the tail to the state after the last data bit
+    for (size_t i = 0u; i < (m_K-1u); i++) {
+        curr_bit--;
+        state = (state >> 1) | (size_t(get_decision(curr_bit, state)) << (m_K-2u));
+    }
+    uint8_t data_byte = 0u;
+    for (size_t i = total_bits; i-- > 0u; ) {
+        curr_bit--;
+        data_byte = uint8_t((data_byte >> 1) | ((state & 0b1) << 7));
+        if ((i % 8u) == 0u) data[i/8u] = data_byte;
+        state = (state >> 1) | (size_t(get_decision(curr_bit, state)) << (m_K-2u));
+    }
+}
+
+size_t ViterbiDecoder_JIT::get_best_state() const {
+    if (m_metric_size == 1u) return argmin_u8_modular(m_old_metrics, m_total_states);
+    // Metrics are only meaningful relative to each other since the spread is under 32768
+    const auto* metrics = reinterpret_cast<const uint16_t*>(m_old_metrics);
+    size_t best_state = 0u;
+    int16_t best_metric = 0;
+    for (size_t i = 1u; i < m_total_states; i++) {
+        const int16_t metric = int16_t(uint16_t(metrics[i] - metrics[0]));
+        if (metric < best_metric) {
+            best_metric = metric;
+            best_state = i;
+        }
+    }
+    return best_state;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include "./decoder_registry.h"
+
+// Viterbi decoder whose update loop is generated at runtime for one code
+// Table driven kernels load the expected codewords of every butterfly from memory because the polynomials
+// are only known at runtime, here they are folded into the generated code instead:
+// - The butterflies of a bit are fully unrolled so each block's codeword pattern is a pooled constant
+// - The sign flip of the signed symbols is folded into the same constant
+// - Branch metrics that are equal to or the complement of one already computed are reused
+//   for any polynomial rather than assuming the first and last taps are set
+// Kernels only use SSE2 and are cached per code so creating more decoders for a code is cheap
+//
+// Symbols are signed soft decisions spanning the full 8bit range, i.e. +127 for a 1 and -127 for a 0
+// U8 quantises the branch metrics so the path metric spread fits modular 8bit arithmetic like ka9q
+// U16 keeps the full 8bit symbols and uses modular 16bit arithmetic, neither ever renormalises
+
+struct JitKernelArgs {
+    const int8_t* symbols;
+    size_t total_bits;
+    uint8_t* old_metrics;
+    uint8_t* new_metrics;
+    uint8_t* decisions;
+};
+
+class JitKernel;
+
+// False on non x86-64 builds
+bool is_jit_supported();
+
+// Whether a kernel can be generated for the code, larger codes would unroll into too much code
+bool is_jit_code_supported(const size_t K, const size_t R, const DecoderPrecision precision);
+
+// Generates or reuses the kernel for a code, thread safe
+// Throws std::invalid_argument for unsupported codes and std::runtime_error if code can't be made executable
+std::shared_ptr<const JitKernel> get_jit_kernel(const size_t K, const size_t R, const int* poly, const DecoderPrecision precision);
+
+void run_jit_kernel(const JitKernel& kernel, JitKernelArgs& args);
+
+// Size of the generated code and constant pool in bytes
+size_t get_jit_kernel_size(const JitKernel& kernel);
+
+class ViterbiDecoder_JIT
+{
+private:
+    const size_t m_K;
+    const size_t m_R;
+    const DecoderPrecision m_precision;
+    const size_t m_total_states;
+    const size_t m_metric_size;         // bytes per path metric
+    const size_t m_decision_bytes;
+    std::shared_ptr<const JitKernel> m_kernel;
+    uint8_t* m_metrics;
+    uint8_t* m_old_metrics;
+    uint8_t* m_new_metrics;
+    uint8_t* m_decisions;
+    size_t m_max_decoded_bits;
+    size_t m_current_decoded_bit;
+public:
+    ViterbiDecoder_JIT(const size_t K, const size_t R, const int* poly, const DecoderPrecision precision, const size_t max_decoded_bits);
+    ~ViterbiDecoder_JIT();
+    ViterbiDecoder_JIT(const ViterbiDecoder_JIT&) = delete;
+    ViterbiDecoder_JIT(ViterbiDecoder_JIT&&) = delete;
+    ViterbiDecoder_JIT& operator=(const ViterbiDecoder_JIT&) = delete;
+    ViterbiDecoder_JIT& operator=(ViterbiDecoder_JIT&&) = delete;
+
+    void reset(const size_t starting_state = 0u);
+    void update(const int8_t* symbols, const size_t total_symbols);
+    // Decoded bits are written MSB first, the K-1 tail bits following the data are skipped
+    void chainback(uint8_t* data, const size_t total_bits, const size_t end_state = 0u);
+    size_t get_best_state() const;
+};
@@ -0,0 +1,263 @@
+#include "./x86_emitter.h"
+#include <assert.h>
+#include <string.h>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static constexpr uint8_t get_id(const Gpr x) { return uint8_t(x); }
+
+static bool is_int8(const int32_t x) { return (x >= -128) && (x <= 127); }
+
+X86Mem X86Emitter::constant(const Constant& value) {
+    for (size_t i = 0; i < m_constants.size(); i++) {
+        if (m_constants[i] == value) {
+            X86Mem mem;
+            mem.constant = int(i);
+            return mem;
+        }
+    }
+    m_constants.push_back(value);
+    X86Mem mem;
+    mem.constant = int(m_constants.size()-1u);
+    return mem;
+}
+
+void X86Emitter::emit32(const uint32_t x) {
+    for (size_t i = 0; i < 4; i++) emit(uint8_t(x >> (8u*i)));
+}
+
+// Omitted when it would be 0x40 unless the instruction needs it
+void X86Emitter::rex(const bool w, const uint8_t reg, const uint8_t base, const bool is_forced) {
+    const uint8_t value = uint8_t(0x40 | (w ? 0x08 : 0x00) | ((reg >> 3) << 2) | (base >> 3));
+    if (value != 0x40 || is_forced) emit(value);
+}
+
+uint8_t X86Emitter::get_base(const X86Mem& mem) const {
+    return (mem.constant >= 0) ? 0u : get_id(mem.base);
+}
+
+void X86Emitter::modrm_reg(const uint8_t reg, const uint8_t rm) {
+    emit(uint8_t(0xC0 | ((reg & 7u) << 3) | (rm & 7u)));
+}
+
+void X86Emitter::modrm_mem(const uint8_t reg, const X86Mem& mem) {
+    if (mem.constant >= 0) {
+        emit(uint8_t(((reg & 7u) << 3) | 0b101));
+        m_fixups.push_back({ m_code.size(), mem.constant });
+        emit32(0u);
+        return;
+    }
+    const uint8_t base = get_id(mem.base) & 7u;
+    // rbp and r13 with no displacement would encode rip relative
+    uint8_t mod = 0b10;
+    if (mem.disp == 0 && base != 0b101) mod = 0b00;
+    else if (is_int8(mem.disp)) mod = 0b01;
+    emit(uint8_t((mod << 6) | ((reg & 7u) << 3) | base));
+    // rsp and r12 need a sib byte
+    if (base == 0b100) emit(0x24);
+    if (mod == 0b01) emit(uint8_t(int8_t(mem.disp)));
+    if (mod == 0b10) emit32(uint32_t(mem.disp));
+}
+
+void X86Emitter::sse(const SseOp op, const Xmm dst, const Xmm src) {
+    emit(0x66);
+    rex(false, dst, src);
+    emit(0x0F);
+    emit(uint8_t(op));
+    modrm_reg(dst, src);
+}
+
+void X86Emitter::sse(const SseOp op, const Xmm dst, const X86Mem& src) {
+    emit(0x66);
+    rex(false, dst, get_base(src));
+    emit(0x0F);
+    emit(uint8_t(op));
+    modrm_mem(dst, src);
+}
+
+void X86Emitter::movdqa(const X86Mem& dst, const Xmm src) {
+    emit(0x66);
+    rex(false, src, get_base(dst));
+    emit(0x0F);
+    emit(0x7F);
+    modrm_mem(src, dst);
+}
+
+void X86Emitter::psrlw(const Xmm dst, const uint8_t shift) {
+    emit(0x66);
+    rex(false, 0u, dst);
+    emit(0x0F);
+    emit(0x71);
+    modrm_reg(2u, dst);
+    emit(shift);
+}
+
+void X86Emitter::pshufd(const Xmm dst, const Xmm src, const uint8_t order) {
+    emit(0x66);
+    rex(false, dst, src);
+    emit(0x0F);
+    emit(0x70);
+    modrm_reg(dst, src);
+    emit(order);
+}
+
+void X86Emitter::movd(const Xmm dst, const Gpr src) {
+    emit(0x66);
+    rex(false, dst, get_id(src));
+    emit(0x0F);
+    emit(0x6E);
+    modrm_reg(dst, get_id(src));
+}
+
+void X86Emitter::pmovmskb(const Gpr dst, const Xmm src) {
+    emit(0x66);
+    rex(false, get_id(dst), src);
+    emit(0x0F);
+    emit(0xD7);
+    modrm_reg(get_id(dst), src);
+}
+
+void X86Emitter::mov(const Gpr dst, const X86Mem& src) {
+    rex(true, get_id(dst), get_base(src));
+    emit(0x8B);
+    modrm_mem(get_id(dst), src);
+}
+
+void X86Emitter::mov16(const X86Mem& dst, const Gpr src) {
+    emit(0x66);
+    rex(false, get_id(src), get_base(dst));
+    emit(0x89);
+    modrm_mem(get_id(src), dst);
+}
+
+void X86Emitter::movzx8(const Gpr dst, const X86Mem& src) {
+    rex(false, get_id(dst), get_base(src));
+    emit(0x0F);
+    emit(0xB6);
+    modrm_mem(get_id(dst), src);
+}
+
+void X86Emitter::imul(const Gpr dst, const Gpr src, const int32_t imm) {
+    rex(false, get_id(dst), get_id(src));
+    emit(0x69);
+    modrm_reg(get_id(dst), get_id(src));
+    emit32(uint32_t(imm));
+}
+
+void X86Emitter::add(const Gpr dst, const int32_t imm) {
+    rex(true, 0u, get_id(dst));
+    emit(0x81);
+    modrm_reg(0u, get_id(dst));
+    emit32(uint32_t(imm));
+}
+
+void X86Emitter::sub(const Gpr dst, const int32_t imm) {
+    rex(true, 0u, get_id(dst));
+    emit(0x81);
+    modrm_reg(5u, get_id(dst));
+    emit32(uint32_t(imm));
+}
+
+void X86Emitter::xchg(const Gpr a, const Gpr b) {
+    rex(true, get_id(a), get_id(b));
+    emit(0x87);
+    modrm_reg(get_id(a), get_id(b));
+}
+
+void X86Emitter::dec(const Gpr dst) {
+    rex(true, 0u, get_id(dst));
+    emit(0xFF);
+    modrm_reg(1u, get_id(dst));
+}
+
+void X86Emitter::test(const Gpr a, const Gpr b) {
+    rex(true, get_id(b), get_id(a));
+    emit(0x85);
+    modrm_reg(get_id(b), get_id(a));
+}
+
+void X86Emitter::jnz(const size_t target) {
+    emit(0x0F);
+    emit(0x85);
+    const int64_t rel = int64_t(target) - int64_t(m_code.size() + 4u);
+    emit32(uint32_t(int32_t(rel)));
+}
+
+size_t X86Emitter::jz_forward() {
+    emit(0x0F);
+    emit(0x84);
+    const size_t jump = m_code.size();
+    emit32(0u);
+    return jump;
+}
+
+void X86Emitter::bind(const size_t jump) {
+    const int32_t rel = int32_t(int64_t(m_code.size()) - int64_t(jump + 4u));
+    memcpy(&m_code[jump], &rel, sizeof(rel));
+}
+
+void X86Emitter::ret() {
+    emit(0xC3);
+}
+
+std::vector<uint8_t> X86Emitter::finalize() const {
+    auto code = m_code;
+    while (code.size() % 16u != 0u) code.push_back(0xCC);
+    const size_t pool_offset = code.size();
+    for (const auto& value: m_constants) {
+        code.insert(code.end(), value.begin(), value.end());
+    }
+    for (const auto& fixup: m_fixups) {
+        const size_t target = pool_offset + size_t(fixup.constant)*16u;
+        // Relative to the end of the rel32 field since no instruction has an immediate after it
+        const int32_t rel = int32_t(int64_t(target) - int64_t(fixup.offset + 4u));
+        memcpy(&code[fixup.offset], &rel, sizeof(rel));
+    }
+    return code;
+}
+
+ExecutableMemory::ExecutableMemory(const std::vector<uint8_t>& code)
+: m_data(nullptr), m_size(0u)
+{
+    // Pages are writable while copying then only executable so they are never both
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const size_t page_size = size_t(info.dwPageSize);
+    m_size = ((code.size() + page_size - 1u) / page_size) * page_size;
+    m_data = VirtualAlloc(nullptr, m_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (m_data == nullptr) throw std::runtime_error("Failed to allocate pages for generated code");
+    memcpy(m_data, code.data(), code.size());
+    DWORD old_protect;
+    if (!VirtualProtect(m_data, m_size, PAGE_EXECUTE_READ, &old_protect)) {
+        VirtualFree(m_data, 0, MEM_RELEASE);
+        throw std::runtime_error("Failed to make generated code executable");
+    }
+    FlushInstructionCache(GetCurrentProcess(), m_data, m_size);
+#else
+    const size_t page_size = size_t(sysconf(_SC_PAGESIZE));
+    m_size = ((code.size() + page_size - 1u) / page_size) * page_size;
+    void* data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) throw std::runtime_error("Failed to allocate pages for generated code");
+    m_data = data;
+    memcpy(m_data, code.data(), code.size());
+    if (mprotect(m_data, m_size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(m_data, m_size);
+        throw std::runtime_error("Failed to make generated code executable");
+    }
+#endif
+}
+
+ExecutableMemory::~ExecutableMemory() {
+#if defined(_WIN32)
+    VirtualFree(m_data, 0, MEM_RELEASE);
+#else
+    munmap(m_data, m_size);
+#endif
+}
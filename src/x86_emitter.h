@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <vector>
+
+// Minimal x86-64 machine code emitter for generating decoder kernels at runtime
+// Only covers the SSE2 and integer instructions the generated kernels use
+// Vector constants are pooled after the code and addressed rip relative so they need no registers
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define X86_EMITTER_SUPPORTED 1
+#else
+#define X86_EMITTER_SUPPORTED 0
+#endif
+
+enum class Gpr: uint8_t {
+    RAX=0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+// xmm registers are referred to by index
+using Xmm = uint8_t;
+
+// Either [base+disp] or a pooled constant
+struct X86Mem {
+    Gpr base = Gpr::RAX;
+    int32_t disp = 0;
+    int constant = -1;
+};
+
+inline X86Mem x86_mem(const Gpr base, const int32_t disp = 0) {
+    X86Mem mem;
+    mem.base = base;
+    mem.disp = disp;
+    return mem;
+}
+
+// Opcodes of SSE2 instructions of the form 66 0F op /r
+enum class SseOp: uint8_t {
+    PUNPCKLBW = 0x60,
+    PUNPCKLWD = 0x61,
+    PACKSSWB  = 0x63,
+    PCMPGTB   = 0x64,
+    PCMPGTW   = 0x65,
+    PUNPCKHBW = 0x68,
+    PUNPCKHWD = 0x69,
+    MOVDQA    = 0x6F,
+    PAND      = 0xDB,
+    PANDN     = 0xDF,
+    PAVGB     = 0xE0,
+    POR       = 0xEB,
+    PXOR      = 0xEF,
+    PSUBB     = 0xF8,
+    PSUBW     = 0xF9,
+    PADDB     = 0xFC,
+    PADDW     = 0xFD,
+};
+
+class X86Emitter
+{
+public:
+    using Constant = std::array<uint8_t, 16>;
+private:
+    struct Fixup {
+        size_t offset;          // position of the rel32 field
+        int constant;
+    };
+    std::vector<uint8_t> m_code;
+    std::vector<Constant> m_constants;
+    std::vector<Fixup> m_fixups;
+public:
+    // Identical constants share a pool slot
+    X86Mem constant(const Constant& value);
+    size_t get_position() const { return m_code.size(); }
+
+    // SSE2
+    void sse(const SseOp op, const Xmm dst, const Xmm src);
+    void sse(const SseOp op, const Xmm dst, const X86Mem& src);
+    void movdqa(const Xmm dst, const Xmm src) { sse(SseOp::MOVDQA, dst, src); }
+    void movdqa(const Xmm dst, const X86Mem& src) { sse(SseOp::MOVDQA, dst, src); }
+    void movdqa(const X86Mem& dst, const Xmm src);
+    void psrlw(const Xmm dst, const uint8_t shift);
+    void pshufd(const Xmm dst, const Xmm src, const uint8_t order);
+    void movd(const Xmm dst, const Gpr src);
+    void pmovmskb(const Gpr dst, const Xmm src);
+
+    // Integer
+    void mov(const Gpr dst, const X86Mem& src);                 // 64bit load
+    void mov16(const X86Mem& dst, const Gpr src);               // 16bit store
+    void movzx8(const Gpr dst, const X86Mem& src);              // zero extended byte load into 32bits
+    void imul(const Gpr dst, const Gpr src, const int32_t imm); // 32bit
+    void add(const Gpr dst, const int32_t imm);                 // 64bit
+    void sub(const Gpr dst, const int32_t imm);                 // 64bit
+    void xchg(const Gpr a, const Gpr b);                        // 64bit
+    void dec(const Gpr dst);                                    // 64bit
+    void test(const Gpr a, const Gpr b);                        // 64bit
+    void jnz(const size_t target);
+    size_t jz_forward();                                        // returns the jump to give to bind()
+    void bind(const size_t jump);
+    void ret();
+
+    // Code followed by the constant pool with rip relative references resolved
+    // The pool is 16 byte aligned relative to the start so the buffer must be as well
+    std::vector<uint8_t> finalize() const;
+private:
+    void emit(const uint8_t x) { m_code.push_back(x); }
+    void emit32(const uint32_t x);
+    void rex(const bool w, const uint8_t reg, const uint8_t base, const bool is_forced=false);
+    void modrm_reg(const uint8_t reg, const uint8_t rm);
+    void modrm_mem(const uint8_t reg, const X86Mem& mem);
+    uint8_t get_base(const X86Mem& mem) const;
+};
+
+// Page aligned memory mapped read and execute only after the code is copied in
+class ExecutableMemory
+{
+private:
+    void* m_data;
+    size_t m_size;
+public:
+    // Throws std::runtime_error if the os refuses executable pages
+    explicit ExecutableMemory(const std::vector<uint8_t>& code);
+    ~ExecutableMemory();
+    ExecutableMemory(const ExecutableMemory&) = delete;
+    ExecutableMemory(ExecutableMemory&&) = delete;
+    ExecutableMemory& operator=(const ExecutableMemory&) = delete;
+    ExecutableMemory& operator=(ExecutableMemory&&) = delete;
+    const void* get() const { return m_data; }
+    size_t size() const { return m_size; }
+};